@@ -2,6 +2,8 @@ return Ship {
   model  = models.ship,
   mass   = 1,
   radius = models.ship.radius,
+  -- a slot may hold a part with slots of its own, named after the part model's slots:
+  --   pylon1 = parts.enginePylon { slots = { mount = parts.basicEngine } },
   slots = {
     engine1 = parts.basicEngine,
     engine2 = parts.basicEngine
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <immintrin.h>
+
+// Collision broadphase passes, header-only so collisions.c and tools/layout_bench.c (both layouts) run the same
+// loops. Positions are read through position_orientation_t, its stride says how the columns are tiled.
+
+#define BROADPHASE_REACH 1000.0f // camera reach, (-reach, -reach) to (reach, reach)
+
+// Writes the absolute indices of elements [first, active) within reach to idx and returns their count; first is a
+// multiple of 8
+static inline uint32_t broadphase_cull(const position_orientation_t* po, size_t first, size_t active, uint32_t* idx) {
+  const float* px = po->position_x + tiled_index(po->stride, (uint32_t)first);
+  const float* py = po->position_y + tiled_index(po->stride, (uint32_t)first);
+  const float* end_px = po->position_x + tiled_index(po->stride, (uint32_t)active);
+
+  uint32_t count = 0;
+  size_t remaining = active - first;
+
+  __m256 minx = _mm256_set1_ps(-BROADPHASE_REACH);
+  __m256 maxx = _mm256_set1_ps(BROADPHASE_REACH);
+  __m256 miny = _mm256_set1_ps(-BROADPHASE_REACH);
+  __m256 maxy = _mm256_set1_ps(BROADPHASE_REACH);
+
+  for (size_t base = first; px < end_px; px += po->stride, py += po->stride, base += 8, remaining -= 8) {
+    __m256 pxv = _mm256_load_ps(px);
+    __m256 pyv = _mm256_load_ps(py);
+
+    __m256 cmpx_min = _mm256_cmp_ps(pxv, minx, _CMP_GE_OQ);
+    __m256 cmpx_max = _mm256_cmp_ps(pxv, maxx, _CMP_LE_OQ);
+    __m256 cmpy_min = _mm256_cmp_ps(pyv, miny, _CMP_GE_OQ);
+    __m256 cmpy_max = _mm256_cmp_ps(pyv, maxy, _CMP_LE_OQ);
+
+    __m256 cmpx = _mm256_and_ps(cmpx_min, cmpx_max);
+    __m256 cmpy = _mm256_and_ps(cmpy_min, cmpy_max);
+    __m256 cmp = _mm256_and_ps(cmpx, cmpy);
+
+    int mask = _mm256_movemask_ps(cmp);
+    for (size_t i = 0; i < (remaining < 8 ? remaining : 8); i++) {
+      if (mask & (1 << i)) {
+        idx[count++] = (uint32_t)(base + i);
+      }
+    }
+  }
+  return count;
+}
+
+// Lane mask of the elements idx[0..7] of pb whose circle overlaps the source one (px, py, pr broadcast)
+static inline int broadphase_overlaps(__m256 px, __m256 py, __m256 pr, const position_orientation_t* pb,
+                                      const uint32_t* idx) {
+  // dense indices -> element offsets in tiled storage
+  __m256i offsets = _mm256_loadu_si256((const __m256i*)idx);
+  if (pb->stride != 8) {
+    __m256i stride = _mm256_set1_epi32((int)pb->stride);
+    __m256i lane_mask = _mm256_set1_epi32(7);
+    offsets = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(offsets, 3), stride),
+                               _mm256_and_si256(offsets, lane_mask));
+  }
+
+  __m256 pxj = _mm256_i32gather_ps(pb->position_x, offsets, 4);
+  __m256 pyj = _mm256_i32gather_ps(pb->position_y, offsets, 4);
+
+  __m256 dx = _mm256_sub_ps(px, pxj);
+  __m256 dy = _mm256_sub_ps(py, pyj);
+
+  __m256 d = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+  __m256 r = _mm256_add_ps(pr, _mm256_i32gather_ps(pb->radius, offsets, 4));
+
+  __m256 cmp = _mm256_cmp_ps(d, _mm256_mul_ps(r, r), _CMP_LE_OQ);
+  return _mm256_movemask_ps(cmp);
+}
@@ -1,21 +1,28 @@
 #include "collisions.h"
+#include "broadphase.h"
 #include "debug/profiler.h"
 #include "entity/entity.h"
 #include "platform/platform.h"
 #include "messaging/messaging.h"
+#include "scheduler/scheduler.h"
+#include "core/columns.h"
 
 #include <immintrin.h>
 
 struct collisions_engine_data {
   uint32_t active;
-  uint32_t capacity;
 
   uint32_t* idx;
 };
 
+// pairs are bounded by objects x targets, not by either storage, so the buffers grow on their own while they
+// fill up; past COLLISIONS_MAX_PAIRS the remaining pairs of the tick are dropped
+#define COLLISIONS_MAX_PAIRS (1 << 21)
+
 struct collision_buffer {
   uint32_t active;
   uint32_t capacity;
+  column_set_t columns;
 
   struct {
     uint32_t idxa;
@@ -29,66 +36,55 @@ static struct collisions_engine_data culled_particles_;
 static struct collision_buffer collision_buffer_objects_;
 static struct collision_buffer collision_buffer_particles_;
 
-#define MIN(x, y) (((x) < (y)) ? (x) : (y))
-
-void _cull_visible_objects(position_orientation_t* po, size_t active, struct collisions_engine_data* target) {
-  float* px = po->position_x;
-  float* py = po->position_y;
-  float* end_px = po->position_x + active;
-
-  target->active = 0;
-  size_t remaining = active;
-
-  // cull objects that are within camera reach (-1000, -1000) to (1000, 1000)
-  __m256 minx = _mm256_set1_ps(-1000.0f);
-  __m256 maxx = _mm256_set1_ps(1000.0f);
-  __m256 miny = _mm256_set1_ps(-1000.0f);
-  __m256 maxy = _mm256_set1_ps(1000.0f);
+// culled indices grow with the entity storage they are computed from
+static column_set_t objects_columns_;
+static column_set_t particles_columns_;
+static bool reserved_ = false;
 
-  for (; px < end_px; px += 8, py += 8, remaining -= 8) {
-    __m256 pxv = _mm256_load_ps(px);
-    __m256 pyv = _mm256_load_ps(py);
-
-    __m256 cmpx_min = _mm256_cmp_ps(pxv, minx, _CMP_GE_OQ);
-    __m256 cmpx_max = _mm256_cmp_ps(pxv, maxx, _CMP_LE_OQ);
-    __m256 cmpy_min = _mm256_cmp_ps(pyv, miny, _CMP_GE_OQ);
-    __m256 cmpy_max = _mm256_cmp_ps(pyv, maxy, _CMP_LE_OQ);
-
-    __m256 cmpx = _mm256_and_ps(cmpx_min, cmpx_max);
-    __m256 cmpy = _mm256_and_ps(cmpy_min, cmpy_max);
-    __m256 cmp = _mm256_and_ps(cmpx, cmpy);
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
-    int mask = _mm256_movemask_ps(cmp);
-    for (size_t i = 0; i < MIN(remaining, 8); i++) {
-      if (mask & (1 << i)) {
-        size_t obj_idx = (px - po->position_x) + i;
-        target->idx[target->active++] = (uint32_t)obj_idx;
-      }
-    }
-  }
+// [first, active), first a multiple of 8; the indices written are absolute
+void _cull_visible_objects(position_orientation_t* po, size_t first, size_t active,
+                           struct collisions_engine_data* target) {
+  target->active = broadphase_cull(po, first, active, target->idx);
 }
 
-void _collision_buffer_initialize(struct collision_buffer* buffer, size_t capacity) {
-  buffer->capacity = (uint32_t)capacity;
+void _collision_buffer_initialize(struct collision_buffer* buffer) {
   buffer->active = 0;
-  buffer->idx = platform_retrieve_memory(sizeof(uint32_t) * 2 * buffer->capacity);
+  column_set_initialize(&buffer->columns, COLLISIONS_MAX_PAIRS);
+  column_set_add(&buffer->columns, (void**)&buffer->idx, sizeof(*buffer->idx));
+  buffer->capacity = buffer->columns.capacity;
 }
 
-void _collisions_engine_data_initialize(struct collisions_engine_data* data, size_t capacity) {
-  data->capacity = (uint32_t)capacity;
+void _collisions_engine_data_initialize(column_set_t* set, struct collisions_engine_data* data) {
   data->active = 0;
-  data->idx = platform_retrieve_memory(sizeof(uint32_t) * data->capacity);
+  column_set_add(set, (void**)&data->idx, sizeof(*data->idx));
 }
 
-void collisions_engine_initialize(void) {
-  struct objects_data* od = entity_manager_get_objects();
-  struct particles_data* pd = entity_manager_get_particles();
-
-  _collision_buffer_initialize(&collision_buffer_objects_, od->capacity);
-  _collision_buffer_initialize(&collision_buffer_particles_, pd->capacity);
+static void _collisions_reserve(void) {
+  column_set_reserve(&objects_columns_, entity_manager_get_objects()->capacity);
+  column_set_reserve(&particles_columns_, entity_manager_get_particles()->capacity);
+}
 
-  _collisions_engine_data_initialize(&culled_objects_, od->capacity);
-  _collisions_engine_data_initialize(&culled_particles_, pd->capacity);
+void collisions_engine_initialize(void) {
+  if (!reserved_) {
+    column_set_initialize(&objects_columns_, OBJECTS_MAX_CAPACITY);
+    column_set_initialize(&particles_columns_, PARTICLES_MAX_CAPACITY);
+
+    _collision_buffer_initialize(&collision_buffer_objects_);
+    _collisions_engine_data_initialize(&objects_columns_, &culled_objects_);
+    _collision_buffer_initialize(&collision_buffer_particles_);
+    _collisions_engine_data_initialize(&particles_columns_, &culled_particles_);
+    reserved_ = true;
+  }
+  _collisions_reserve();
+
+  system_t collisions = { .name = "collisions",
+                          .phase = SYSTEM_PHASE_COLLISION,
+                          .reads = COMPONENT_OBJECTS_TRANSFORM | COMPONENT_PARTICLES,
+                          .writes = COMPONENT_MESSAGES,
+                          .run = collisions_engine_tick };
+  scheduler_register(&collisions);
 }
 
 static void
@@ -97,35 +93,29 @@ _check_collisions_step(struct collision_buffer* collision_buffer, const position
                        // where to start. when doing particle<->object, from=0; when doing object<->object, from=idx+1
                        const size_t from) {
   uint32_t source_obj_idx = culled_objects_.idx[idx];
-  __m256 px = _mm256_set1_ps(pa->position_x[source_obj_idx]);
-  __m256 py = _mm256_set1_ps(pa->position_y[source_obj_idx]);
-  __m256 pr = _mm256_set1_ps(pa->radius[source_obj_idx]);
-
+  uint32_t source_tile_idx = tiled_index(pa->stride, source_obj_idx);
+  __m256 px = _mm256_set1_ps(pa->position_x[source_tile_idx]);
+  __m256 py = _mm256_set1_ps(pa->position_y[source_tile_idx]);
+  __m256 pr = _mm256_set1_ps(pa->radius[source_tile_idx]);
 
   size_t remaining = target->active - from;
   // start aligned to 8
   // we will remove j<=idx in postprocessing
   for (size_t j =  (from + 1) & ~(size_t)0x7; j < target->active; j += 8, remaining -= 8) {
 
-    __m256i offsets = _mm256_loadu_si256((__m256i*)&target->idx[j]);
-
-    __m256 pxj = _mm256_i32gather_ps(pb->position_x, offsets, 4);
-    __m256 pyj = _mm256_i32gather_ps(pb->position_y, offsets, 4);
-
-    __m256 dx = _mm256_sub_ps(px, pxj);
-    __m256 dy = _mm256_sub_ps(py, pyj);
-
-    __m256 d = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
-    __m256 r = _mm256_add_ps(pr, _mm256_i32gather_ps(pb->radius, offsets, 4));
-
-    __m256 cmp = _mm256_cmp_ps(d, _mm256_mul_ps(r, r), _CMP_LE_OQ);
-
-    int mask = _mm256_movemask_ps(cmp);
+    int mask = broadphase_overlaps(px, py, pr, pb, &target->idx[j]);
     for (size_t i = 0; i < MIN(remaining, 8); i++) {
 
       if (mask & (1 << i) && (j + i) > from) {
         size_t target_obj_idx = target->idx[j + i];
 
+        if (collision_buffer->active == collision_buffer->capacity) {
+          collision_buffer->capacity = column_set_reserve(&collision_buffer->columns, collision_buffer->active + 1);
+          if (collision_buffer->active == collision_buffer->capacity) {
+            return; // full
+          }
+        }
+
         collision_buffer->idx[collision_buffer->active].idxa = (uint32_t)source_obj_idx;
         collision_buffer->idx[collision_buffer->active].idxb = (uint32_t)target_obj_idx;
         collision_buffer->active++;
@@ -147,10 +137,13 @@ void collisions_engine_tick(void) {
 
   PROFILE_ZONE("collisions_engine_tick");
 
+  _collisions_reserve();
+
   {
     PROFILE_ZONE("culling");
-    _cull_visible_objects(&od->position_orientation, od->active, &culled_objects_);
-    _cull_visible_objects(&pd->position_orientation, pd->active, &culled_particles_);
+    _cull_visible_objects(&od->position_orientation, 0, od->active, &culled_objects_);
+    // retired particle storage is skipped, the tombstones in between are parked out of reach
+    _cull_visible_objects(&pd->position_orientation, pd->first, pd->active, &culled_particles_);
     PROFILE_ZONE_END();
   }
 
@@ -191,7 +184,14 @@ void collisions_engine_tick(void) {
 
 #ifdef UNIT_TESTS
 #include "../test/unity.h"
-#include <string.h>
+
+// Helper to zero the positions of the first count objects, through HOT_IDX as the columns can be tiled
+static void _clear_positions(struct objects_data* od, int count) {
+  for (int i = 0; i < count; i++) {
+    od->position_orientation.position_x[HOT_IDX(i)] = 0.0f;
+    od->position_orientation.position_y[HOT_IDX(i)] = 0.0f;
+  }
+}
 
 // Helper to check if a collision pair exists in the buffer (order-independent)
 static int _collision_exists(struct collision_buffer* buf, uint32_t a, uint32_t b) {
@@ -222,10 +222,9 @@ void collision_test__no_duplicates(void) {
   struct objects_data* od = entity_manager_get_objects();
 
   // Clear and setup positions - all at (0,0) so they all collide
-  memset(od->position_orientation.position_x, 0, sizeof(float) * 32);
-  memset(od->position_orientation.position_y, 0, sizeof(float) * 32);
+  _clear_positions(od, 32);
   for (int i = 0; i < 16; i++) {
-    od->position_orientation.radius[i] = 10.0f;
+    od->position_orientation.radius[HOT_IDX(i)] = 10.0f;
   }
   od->active = 16;
 
@@ -269,24 +268,23 @@ void collision_test__scattered_indices(void) {
   // Object 5: (1, 0)   <- close to 0, should collide
   // Object 10: (100, 100) <- far away
   // Object 15: (2, 0)  <- close to 0 and 5, should collide with both
-  memset(od->position_orientation.position_x, 0, sizeof(float) * 64);
-  memset(od->position_orientation.position_y, 0, sizeof(float) * 64);
+  _clear_positions(od, 64);
 
-  od->position_orientation.position_x[0] = 0.0f;
-  od->position_orientation.position_y[0] = 0.0f;
-  od->position_orientation.radius[0] = 5.0f;
+  od->position_orientation.position_x[HOT_IDX(0)] = 0.0f;
+  od->position_orientation.position_y[HOT_IDX(0)] = 0.0f;
+  od->position_orientation.radius[HOT_IDX(0)] = 5.0f;
 
-  od->position_orientation.position_x[5] = 1.0f;
-  od->position_orientation.position_y[5] = 0.0f;
-  od->position_orientation.radius[5] = 5.0f;
+  od->position_orientation.position_x[HOT_IDX(5)] = 1.0f;
+  od->position_orientation.position_y[HOT_IDX(5)] = 0.0f;
+  od->position_orientation.radius[HOT_IDX(5)] = 5.0f;
 
-  od->position_orientation.position_x[10] = 100.0f;
-  od->position_orientation.position_y[10] = 100.0f;
-  od->position_orientation.radius[10] = 5.0f;
+  od->position_orientation.position_x[HOT_IDX(10)] = 100.0f;
+  od->position_orientation.position_y[HOT_IDX(10)] = 100.0f;
+  od->position_orientation.radius[HOT_IDX(10)] = 5.0f;
 
-  od->position_orientation.position_x[15] = 2.0f;
-  od->position_orientation.position_y[15] = 0.0f;
-  od->position_orientation.radius[15] = 5.0f;
+  od->position_orientation.position_x[HOT_IDX(15)] = 2.0f;
+  od->position_orientation.position_y[HOT_IDX(15)] = 0.0f;
+  od->position_orientation.radius[HOT_IDX(15)] = 5.0f;
 
   od->active = 24;  // Must be multiple of 8
 
@@ -329,22 +327,21 @@ void collision_test__respects_active_count(void) {
 
   // Setup: Put colliding objects beyond the active count
   // These should NOT be detected
-  memset(od->position_orientation.position_x, 0, sizeof(float) * 64);
-  memset(od->position_orientation.position_y, 0, sizeof(float) * 64);
+  _clear_positions(od, 64);
 
   // Object 0 and 1: both at origin, will collide
-  od->position_orientation.position_x[0] = 0.0f;
-  od->position_orientation.position_y[0] = 0.0f;
-  od->position_orientation.radius[0] = 10.0f;
+  od->position_orientation.position_x[HOT_IDX(0)] = 0.0f;
+  od->position_orientation.position_y[HOT_IDX(0)] = 0.0f;
+  od->position_orientation.radius[HOT_IDX(0)] = 10.0f;
 
-  od->position_orientation.position_x[1] = 0.0f;
-  od->position_orientation.position_y[1] = 0.0f;
-  od->position_orientation.radius[1] = 10.0f;
+  od->position_orientation.position_x[HOT_IDX(1)] = 0.0f;
+  od->position_orientation.position_y[HOT_IDX(1)] = 0.0f;
+  od->position_orientation.radius[HOT_IDX(1)] = 10.0f;
 
   // Object 2: also at origin (would collide if included)
-  od->position_orientation.position_x[2] = 0.0f;
-  od->position_orientation.position_y[2] = 0.0f;
-  od->position_orientation.radius[2] = 10.0f;
+  od->position_orientation.position_x[HOT_IDX(2)] = 0.0f;
+  od->position_orientation.position_y[HOT_IDX(2)] = 0.0f;
+  od->position_orientation.radius[HOT_IDX(2)] = 10.0f;
 
   od->active = 24;
 
@@ -380,9 +377,9 @@ void collision_test__aligned_8_objects(void) {
 
   // All 8 objects at origin - all collide
   for (int i = 0; i < 8; i++) {
-    od->position_orientation.position_x[i] = 0.0f;
-    od->position_orientation.position_y[i] = 0.0f;
-    od->position_orientation.radius[i] = 10.0f;
+    od->position_orientation.position_x[HOT_IDX(i)] = 0.0f;
+    od->position_orientation.position_y[HOT_IDX(i)] = 0.0f;
+    od->position_orientation.radius[HOT_IDX(i)] = 10.0f;
     culled_objects_.idx[i] = i;
   }
   od->active = 8;
@@ -407,9 +404,9 @@ void collision_test__unaligned_9_objects(void) {
 
   // 9 objects at origin - all collide
   for (int i = 0; i < 16; i++) {
-    od->position_orientation.position_x[i] = 0.0f;
-    od->position_orientation.position_y[i] = 0.0f;
-    od->position_orientation.radius[i] = 10.0f;
+    od->position_orientation.position_x[HOT_IDX(i)] = 0.0f;
+    od->position_orientation.position_y[HOT_IDX(i)] = 0.0f;
+    od->position_orientation.radius[HOT_IDX(i)] = 10.0f;
     culled_objects_.idx[i] = i;
   }
   od->active = 16;
@@ -423,4 +420,40 @@ void collision_test__unaligned_9_objects(void) {
   TEST_ASSERT_EQUAL_UINT32(36, collision_buffer_objects_.active);
 }
 
+// Test: a cloud of particles over a few objects makes more pairs than there are particles, the buffer grows
+void collision_test__more_pairs_than_particles(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  struct particles_data* pd = entity_manager_get_particles();
+  const uint32_t particles = 2 * COLUMN_SET_GRANULARITY;
+
+  _clear_positions(od, 8);
+  for (uint32_t i = 0; i < 8; i++) {
+    od->position_orientation.radius[HOT_IDX(i)] = 10.0f;
+    culled_objects_.idx[i] = i;
+  }
+  od->active = 4;
+  culled_objects_.active = 4;
+
+  entity_manager_reserve_particles(particles);
+  _collisions_reserve();
+  for (uint32_t i = 0; i < particles; i++) {
+    pd->position_orientation.position_x[i] = 0.0f;
+    pd->position_orientation.position_y[i] = 0.0f;
+    pd->position_orientation.radius[i] = 1.0f;
+    culled_particles_.idx[i] = i;
+  }
+  pd->active = particles;
+  culled_particles_.active = particles;
+
+  collision_buffer_objects_.active = 0;
+  collision_buffer_particles_.active = 0;
+
+  _check_collisions(&od->position_orientation, &pd->position_orientation);
+
+  // every object overlaps the whole cloud
+  TEST_ASSERT_TRUE(collision_buffer_particles_.active > 3 * particles);
+  TEST_ASSERT_TRUE(collision_buffer_particles_.capacity >= collision_buffer_particles_.active);
+  TEST_ASSERT_EQUAL_INT(1, _collision_count(&collision_buffer_particles_, 3, particles - 1));
+}
+
 #endif
@@ -0,0 +1,146 @@
+#include "columns.h"
+#include "platform/platform.h"
+
+static uint32_t _round_capacity(uint32_t capacity) {
+  return (capacity + COLUMN_SET_GRANULARITY - 1) & ~(uint32_t)(COLUMN_SET_GRANULARITY - 1);
+}
+
+void column_set_initialize(column_set_t* set, uint32_t max_capacity) {
+  set->count = 0;
+  set->max_capacity = _round_capacity(max_capacity);
+  set->capacity = max_capacity < COLUMN_SET_GRANULARITY ? set->max_capacity : COLUMN_SET_GRANULARITY;
+  set->tiles = NULL;
+}
+
+void column_set_initialize_tiled(column_set_t* set, uint32_t max_capacity, uint32_t columns, uint32_t element_size) {
+  column_set_initialize(set, max_capacity);
+  set->tile_columns = columns;
+  set->tile_element_size = element_size;
+
+  size_t row_size = (size_t)columns * element_size;
+  set->tiles = platform_reserve_memory(set->max_capacity * row_size);
+  platform_commit_memory(set->tiles, set->capacity * row_size);
+}
+
+void column_set_add(column_set_t* set, void** column, uint32_t element_size) {
+  _ASSERT(set->count < COLUMN_SET_MAX_COLUMNS);
+
+  if (set->tiles != NULL) {
+    _ASSERT(set->count < set->tile_columns && element_size == set->tile_element_size);
+
+    // column k starts in the k-th lane group of the first tile
+    *column = set->tiles + (size_t)set->count * 8 * element_size;
+    set->column[set->count] = column;
+    set->element_size[set->count] = element_size;
+    set->count++;
+    return;
+  }
+
+  void* base = platform_reserve_memory((size_t)set->max_capacity * element_size);
+  platform_commit_memory(base, (size_t)set->capacity * element_size);
+
+  *column = base;
+  set->column[set->count] = column;
+  set->element_size[set->count] = element_size;
+  set->count++;
+}
+
+uint32_t column_set_reserve(column_set_t* set, uint32_t capacity) {
+  if (capacity <= set->capacity) {
+    return set->capacity;
+  }
+
+  // double to keep the number of commits logarithmic
+  uint32_t new_capacity = set->capacity * 2 > capacity ? set->capacity * 2 : capacity;
+  new_capacity = _round_capacity(new_capacity);
+  if (new_capacity > set->max_capacity) {
+    new_capacity = set->max_capacity;
+  }
+
+  if (set->tiles != NULL) {
+    size_t row_size = (size_t)set->tile_columns * set->tile_element_size;
+    platform_commit_memory(set->tiles + set->capacity * row_size, (new_capacity - set->capacity) * row_size);
+  } else {
+    for (uint32_t i = 0; i < set->count; i++) {
+      uint8_t* base = *set->column[i];
+      size_t size = set->element_size[i];
+      platform_commit_memory(base + set->capacity * size, (new_capacity - set->capacity) * size);
+    }
+  }
+
+  set->capacity = new_capacity;
+  return new_capacity;
+}
+
+void column_set_clear(column_set_t* set) {
+  if (set->tiles != NULL) {
+    platform_clear_memory(set->tiles, (size_t)set->capacity * set->tile_columns * set->tile_element_size);
+    return;
+  }
+
+  for (uint32_t i = 0; i < set->count; i++) {
+    platform_clear_memory(*set->column[i], (size_t)set->capacity * set->element_size[i]);
+  }
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+// Test: growing a set keeps the column pointers and the stored data, new elements start zeroed
+void columns_test__growth_keeps_pointers(void) {
+  static column_set_t set;
+  static struct {
+    float* a;
+    uint16_t* b;
+  } data;
+
+  column_set_initialize(&set, 4 * COLUMN_SET_GRANULARITY);
+  column_set_add(&set, (void**)&data.a, sizeof(float));
+  column_set_add(&set, (void**)&data.b, sizeof(uint16_t));
+  TEST_ASSERT_EQUAL_UINT32(COLUMN_SET_GRANULARITY, set.capacity);
+
+  float* a = data.a;
+  uint16_t* b = data.b;
+  a[COLUMN_SET_GRANULARITY - 1] = 1.0f;
+  b[COLUMN_SET_GRANULARITY - 1] = 7;
+
+  TEST_ASSERT_EQUAL_UINT32(COLUMN_SET_GRANULARITY, column_set_reserve(&set, COLUMN_SET_GRANULARITY));
+  TEST_ASSERT_EQUAL_UINT32(3 * COLUMN_SET_GRANULARITY, column_set_reserve(&set, 2 * COLUMN_SET_GRANULARITY + 1));
+  TEST_ASSERT_EQUAL_UINT32(4 * COLUMN_SET_GRANULARITY, column_set_reserve(&set, 3 * COLUMN_SET_GRANULARITY + 1));
+  TEST_ASSERT_EQUAL_UINT32(4 * COLUMN_SET_GRANULARITY, column_set_reserve(&set, 5 * COLUMN_SET_GRANULARITY)); // capped
+
+  TEST_ASSERT_TRUE(a == data.a && b == data.b);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, a[COLUMN_SET_GRANULARITY - 1]);
+  TEST_ASSERT_EQUAL_UINT16(7, b[COLUMN_SET_GRANULARITY - 1]);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, a[4 * COLUMN_SET_GRANULARITY - 1]);
+  TEST_ASSERT_EQUAL_UINT16(0, b[4 * COLUMN_SET_GRANULARITY - 1]);
+}
+
+// Test: a tiled set interleaves its columns in tiles of 8 and keeps them stable when it grows
+void columns_test__tiled_set_interleaves(void) {
+  static column_set_t set;
+  static struct {
+    float* a;
+    float* b;
+  } data;
+
+  column_set_initialize_tiled(&set, 4 * COLUMN_SET_GRANULARITY, 2, sizeof(float));
+  column_set_add(&set, (void**)&data.a, sizeof(float));
+  column_set_add(&set, (void**)&data.b, sizeof(float));
+  TEST_ASSERT_TRUE(data.b == data.a + 8);
+
+  for (uint32_t i = 0; i < 16; i++) {
+    data.a[tiled_index(16, i)] = (float)i;
+    data.b[tiled_index(16, i)] = -(float)i;
+  }
+  TEST_ASSERT_EQUAL_FLOAT(8.0f, data.a[16]); // second tile starts after both columns of the first
+  TEST_ASSERT_EQUAL_FLOAT(-7.0f, data.a[15]);
+
+  float* a = data.a;
+  TEST_ASSERT_EQUAL_UINT32(2 * COLUMN_SET_GRANULARITY, column_set_reserve(&set, COLUMN_SET_GRANULARITY + 1));
+  TEST_ASSERT_TRUE(a == data.a);
+  data.b[tiled_index(16, 2 * COLUMN_SET_GRANULARITY - 1)] = 1.0f;
+  TEST_ASSERT_EQUAL_FLOAT(-15.0f, data.b[tiled_index(16, 15)]);
+}
+
+#endif
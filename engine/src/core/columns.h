@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core.h"
+
+//
+// Growable SoA storage
+//
+// Every column of a set reserves address space for max_capacity elements up front and commits pages only as
+// the set grows, so column pointers never move and nothing has to be copied on growth.
+// Capacity grows in COLUMN_SET_GRANULARITY steps (multiple of 8), SIMD loops may read up to the next
+// multiple of 8 past active. Freshly committed memory is zeroed.
+//
+// A tiled set (column_set_initialize_tiled) shares one reservation between all of its columns and interleaves
+// them in tiles of 8 elements (AoSoA): element i of a column lives at column[tiled_index(stride, i)] with
+// stride = 8 * columns. All columns of a tiled set have the same element size.
+//
+
+#define COLUMN_SET_MAX_COLUMNS 24
+#define COLUMN_SET_GRANULARITY 1024
+
+typedef struct {
+  void** column[COLUMN_SET_MAX_COLUMNS]; // where the column pointer lives (usually a field of the data struct)
+  uint32_t element_size[COLUMN_SET_MAX_COLUMNS];
+  uint32_t count;
+
+  uint32_t capacity;     // committed elements
+  uint32_t max_capacity; // reserved elements
+
+  // tiled sets only
+  uint8_t* tiles;
+  uint32_t tile_columns;
+  uint32_t tile_element_size;
+} column_set_t;
+
+void column_set_initialize(column_set_t* set, uint32_t max_capacity);
+void column_set_initialize_tiled(column_set_t* set, uint32_t max_capacity, uint32_t columns, uint32_t element_size);
+// reserves the column and commits the current capacity, *column receives the (stable) base pointer
+void column_set_add(column_set_t* set, void** column, uint32_t element_size);
+// grows every column to hold at least `capacity` elements, returns the new capacity; it never goes past
+// max_capacity, so callers check it and refuse or clip whatever does not fit
+uint32_t column_set_reserve(column_set_t* set, uint32_t capacity);
+// zeroes the committed part of every column (re-initialization keeps the reservations)
+void column_set_clear(column_set_t* set);
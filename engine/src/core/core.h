@@ -39,8 +39,15 @@ typedef struct {
   float* __restrict orientation_y;
 
   float* __restrict radius;
+
+  uint32_t stride; // elements from one 8-lane tile of a column to the next, 8 unless the storage is tiled (AoSoA)
 } position_orientation_t;
 
+// element i of a column stored in 8-lane tiles, identity for stride 8
+static inline uint32_t tiled_index(uint32_t stride, uint32_t i) {
+  return (i >> 3) * stride + (i & 7);
+}
+
 typedef struct {
   uint8_t r, g, b, a;
 } color_t;
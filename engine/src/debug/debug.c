@@ -66,19 +66,19 @@ void debug_watch_draw(void) {
   struct objects_data* od = entity_manager_get_objects();
   struct parts_data* pd = entity_manager_get_parts();
 
-  uint32_t idx = GET_ORDINAL(watch_target_);
-  if (idx >= od->active)
+  if (!entity_manager_is_alive(watch_target_))
     return;
-
-  float px = od->position_orientation.position_x[idx];
-  float py = od->position_orientation.position_y[idx];
-  float vx = od->velocity_x[idx];
-  float vy = od->velocity_y[idx];
-  float ox = od->position_orientation.orientation_x[idx];
-  float oy = od->position_orientation.orientation_y[idx];
-  float ax = od->acceleration_x[idx];
-  float ay = od->acceleration_y[idx];
-  float thrust = od->thrust[idx];
+  uint32_t idx = entity_manager_object_index(watch_target_);
+
+  float px = od->position_orientation.position_x[HOT_IDX(idx)];
+  float py = od->position_orientation.position_y[HOT_IDX(idx)];
+  float vx = od->velocity_x[HOT_IDX(idx)];
+  float vy = od->velocity_y[HOT_IDX(idx)];
+  float ox = od->position_orientation.orientation_x[HOT_IDX(idx)];
+  float oy = od->position_orientation.orientation_y[HOT_IDX(idx)];
+  float ax = od->acceleration_x[HOT_IDX(idx)];
+  float ay = od->acceleration_y[HOT_IDX(idx)];
+  float thrust = od->thrust[HOT_IDX(idx)];
 
   draw_vector(px, py, vx, vy, 1.0f, COLOR_GREEN);
   draw_vector(px, py, ox, oy, VECTOR_SCALE, COLOR_WHITE);
@@ -0,0 +1,123 @@
+#include "dispatch_stats.h"
+#include "debug/profiler.h"
+
+#include <stdio.h>
+
+static struct dispatch_stats stats_ = { 0 };
+
+// plot names must outlive the profiler, one per entity type
+static const char* const TYPE_NAMES[ENTITY_TYPE_COUNT] = {
+  "any", "controller", "camera", "particles", "ship", "engine", "planet",
+};
+static const char* const TYPE_PLOT_CYCLES[ENTITY_TYPE_COUNT] = {
+  "dispatch_cycles_any",       "dispatch_cycles_controller", "dispatch_cycles_camera", "dispatch_cycles_particles",
+  "dispatch_cycles_ship",      "dispatch_cycles_engine",     "dispatch_cycles_planet",
+};
+static const char* const TYPE_PLOT_CALLS[ENTITY_TYPE_COUNT] = {
+  "dispatch_calls_any",  "dispatch_calls_controller", "dispatch_calls_camera", "dispatch_calls_particles",
+  "dispatch_calls_ship", "dispatch_calls_engine",     "dispatch_calls_planet",
+};
+
+void dispatch_stats_record(uint8_t type, uint16_t code, uint64_t cycles) {
+  _ASSERT(type < ENTITY_TYPE_COUNT);
+
+  struct dispatch_stats_entry* handler = &stats_.handler[type][code & (DISPATCH_STATS_MAX_CODES - 1)];
+  handler->count++;
+  handler->cycles += cycles;
+
+  stats_.frame[type].count++;
+  stats_.frame[type].cycles += cycles;
+}
+
+void dispatch_stats_record_pump(uint32_t messages, uint64_t cycles) {
+  stats_.pump.count += messages;
+  stats_.pump.cycles += cycles;
+  stats_.pump_frame_cycles += cycles;
+}
+
+void dispatch_stats_frame(void) {
+  for (uint32_t type = 0; type < ENTITY_TYPE_COUNT; type++) {
+    PROFILE_PLOT(TYPE_PLOT_CYCLES[type], stats_.frame[type].cycles);
+    PROFILE_PLOT_I(TYPE_PLOT_CALLS[type], stats_.frame[type].count);
+
+    stats_.frame[type].count = 0;
+    stats_.frame[type].cycles = 0;
+  }
+  PROFILE_PLOT("dispatch_cycles_pump", stats_.pump_frame_cycles);
+
+  stats_.pump_frame_cycles = 0;
+  stats_.frames++;
+}
+
+void dispatch_stats_write_text(const char* path) {
+  FILE* f = fopen(path, "w");
+  if (f == NULL) {
+    return;
+  }
+
+  uint64_t handler_cycles = 0;
+  fprintf(f, "%-12s %6s %12s %16s %10s %10s\n", "type", "code", "calls", "cycles", "avg", "per frame");
+  for (uint32_t type = 0; type < ENTITY_TYPE_COUNT; type++) {
+    for (uint32_t code = 0; code < DISPATCH_STATS_MAX_CODES; code++) {
+      const struct dispatch_stats_entry* e = &stats_.handler[type][code];
+      if (e->count == 0) {
+        continue;
+      }
+      handler_cycles += e->cycles;
+      fprintf(f, "%-12s 0x%04X %12llu %16llu %10llu %10llu\n", TYPE_NAMES[type], code, (unsigned long long)e->count,
+              (unsigned long long)e->cycles, (unsigned long long)(e->cycles / e->count),
+              (unsigned long long)(stats_.frames ? e->cycles / stats_.frames : 0));
+    }
+  }
+
+  fprintf(f, "\nframes %u, messages %llu, pump cycles %llu, of which handlers %llu\n", stats_.frames,
+          (unsigned long long)stats_.pump.count, (unsigned long long)stats_.pump.cycles,
+          (unsigned long long)handler_cycles);
+  fclose(f);
+}
+
+void dispatch_stats_write_csv(const char* path) {
+  FILE* f = fopen(path, "w");
+  if (f == NULL) {
+    return;
+  }
+
+  fprintf(f, "type,code,calls,cycles\n");
+  for (uint32_t type = 0; type < ENTITY_TYPE_COUNT; type++) {
+    for (uint32_t code = 0; code < DISPATCH_STATS_MAX_CODES; code++) {
+      const struct dispatch_stats_entry* e = &stats_.handler[type][code];
+      if (e->count != 0) {
+        fprintf(f, "%s,%u,%llu,%llu\n", TYPE_NAMES[type], code, (unsigned long long)e->count,
+                (unsigned long long)e->cycles);
+      }
+    }
+  }
+  fclose(f);
+}
+
+const struct dispatch_stats* dispatch_stats_get(void) {
+  return &stats_;
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+#include "entity/entity.h"
+
+// Test: typed and broadcast dispatches are accounted per (type, code) and per frame
+void dispatch_stats_test__counts_per_type_and_code(void) {
+  uint64_t planet_before = stats_.handler[ENTITY_TYPE_PLANET][MESSAGE_SHIP_ROTATE_BY].count;
+  uint64_t ship_before = stats_.handler[ENTITY_TYPE_SHIP][MESSAGE_BROADCAST_SYSTEM_INITIALIZED].count;
+  dispatch_stats_frame();
+
+  entity_manager_dispatch_message(TYPE_BROADCAST(ENTITY_TYPEREF_PLANET), CREATE_MESSAGE(MESSAGE_SHIP_ROTATE_BY, 0, 0));
+  entity_manager_dispatch_message(RECIPIENT_ID_BROADCAST, CREATE_MESSAGE(MESSAGE_BROADCAST_SYSTEM_INITIALIZED, 0, 0));
+
+  TEST_ASSERT_EQUAL_UINT32(
+      1, (uint32_t)(stats_.handler[ENTITY_TYPE_PLANET][MESSAGE_SHIP_ROTATE_BY].count - planet_before));
+  TEST_ASSERT_EQUAL_UINT32(
+      1, (uint32_t)(stats_.handler[ENTITY_TYPE_SHIP][MESSAGE_BROADCAST_SYSTEM_INITIALIZED].count - ship_before));
+  TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)stats_.frame[ENTITY_TYPE_PLANET].count);
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)stats_.frame[ENTITY_TYPE_ANY].count);
+}
+
+#endif
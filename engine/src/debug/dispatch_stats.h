@@ -0,0 +1,64 @@
+#pragma once
+
+//
+// Per-handler dispatch timing
+//
+// Usage (entity_manager_dispatch_message and messaging_pump are already instrumented):
+//   DISPATCH_STATS_BEGIN()             - start timing a handler / pump (declares a local)
+//   DISPATCH_STATS_END(type, code)     - account the handler call to (entity type, message code)
+//   DISPATCH_STATS_PUMP_END(messages)  - account one messaging_pump, including queue overhead
+//   DISPATCH_STATS_FRAME()             - plots the last frame per entity type and starts a new frame
+//   DISPATCH_STATS_DUMP()              - writes cumulative tables to DISPATCH_STATS_FILE(.txt|.csv)
+//
+// Enabled in builds without NDEBUG (Debug, Tests), all macros expand to nothing in release builds.
+//
+
+#include "core/core.h"
+#include "entity/types.h"
+
+#define DISPATCH_STATS_FILE "raketic.dispatch"
+#define DISPATCH_STATS_MAX_CODES 256
+
+struct dispatch_stats_entry {
+  uint64_t count;
+  uint64_t cycles;
+};
+
+struct dispatch_stats {
+  struct dispatch_stats_entry handler[ENTITY_TYPE_COUNT][DISPATCH_STATS_MAX_CODES]; // cumulative
+  struct dispatch_stats_entry frame[ENTITY_TYPE_COUNT];                              // current frame, by type
+  struct dispatch_stats_entry pump;                                                  // cumulative, count = messages
+  uint64_t pump_frame_cycles;
+  uint32_t frames;
+};
+
+void dispatch_stats_record(uint8_t type, uint16_t code, uint64_t cycles);
+void dispatch_stats_record_pump(uint32_t messages, uint64_t cycles);
+void dispatch_stats_frame(void);
+void dispatch_stats_write_text(const char* path);
+void dispatch_stats_write_csv(const char* path);
+const struct dispatch_stats* dispatch_stats_get(void);
+
+#ifndef NDEBUG
+
+#include <intrin.h>
+
+#define DISPATCH_STATS_BEGIN() uint64_t __dispatch_start = __rdtsc()
+#define DISPATCH_STATS_END(type, code) dispatch_stats_record((type), (code), __rdtsc() - __dispatch_start)
+#define DISPATCH_STATS_PUMP_END(messages) dispatch_stats_record_pump((messages), __rdtsc() - __dispatch_start)
+#define DISPATCH_STATS_FRAME() dispatch_stats_frame()
+#define DISPATCH_STATS_DUMP()                                                                                          \
+  do {                                                                                                                 \
+    dispatch_stats_write_text(DISPATCH_STATS_FILE ".txt");                                                             \
+    dispatch_stats_write_csv(DISPATCH_STATS_FILE ".csv");                                                              \
+  } while (0)
+
+#else
+
+#define DISPATCH_STATS_BEGIN()
+#define DISPATCH_STATS_END(type, code)
+#define DISPATCH_STATS_PUMP_END(messages)
+#define DISPATCH_STATS_FRAME()
+#define DISPATCH_STATS_DUMP()
+
+#endif
@@ -1,7 +1,9 @@
 #include "camera.h"
 #include "entity.h"
+#include "debris.h"
 #include "platform/platform.h"
 #include "debug/profiler.h"
+#include "scheduler/scheduler.h"
 
 #include <immintrin.h>
 
@@ -25,22 +27,31 @@ void camera_get_absolute_position(double* out_x, double* out_y) {
   *out_y = _absolute_y;
 }
 
+entity_id_t camera_get_entity(void) {
+  return _target_entity;
+}
+
+void camera_set_absolute_position(double x, double y) {
+  _absolute_x = x;
+  _absolute_y = y;
+  _smooth_offset_x = 0.0f;
+  _smooth_offset_y = 0.0f;
+}
+
 static void _camera_relocate_world(void) {
-  if (!is_valid_id(_target_entity)) {
+  if (!entity_manager_is_alive(_target_entity)) {
     return;
   }
 
   PROFILE_ZONE("camera_relocate_world");
 
   struct objects_data* od = entity_manager_get_objects();
-  uint32_t target_idx = GET_ORDINAL(_target_entity);
-
-  _ASSERT(target_idx < od->active);
+  uint32_t target_idx = entity_manager_object_index(_target_entity);
 
-  float target_x = od->position_orientation.position_x[target_idx];
-  float target_y = od->position_orientation.position_y[target_idx];
-  float vel_x = od->velocity_x[target_idx];
-  float vel_y = od->velocity_y[target_idx];
+  float target_x = od->position_orientation.position_x[HOT_IDX(target_idx)];
+  float target_y = od->position_orientation.position_y[HOT_IDX(target_idx)];
+  float vel_x = od->velocity_x[HOT_IDX(target_idx)];
+  float vel_y = od->velocity_y[HOT_IDX(target_idx)];
 
   float desired_offset_x = vel_x * CAMERA_LOOKAHEAD_TIME;
   float desired_offset_y = vel_y * CAMERA_LOOKAHEAD_TIME;
@@ -60,9 +71,9 @@ static void _camera_relocate_world(void) {
   {
     float* px = od->position_orientation.position_x;
     float* py = od->position_orientation.position_y;
-    float* end_px = px + od->active;
+    float* end_px = px + HOT_IDX(od->active);
 
-    for (; px < end_px; px += 8, py += 8) {
+    for (; px < end_px; px += OBJECTS_HOT_STRIDE, py += OBJECTS_HOT_STRIDE) {
       __m256 pos_x = _mm256_load_ps(px);
       __m256 pos_y = _mm256_load_ps(py);
       _mm256_store_ps(px, _mm256_sub_ps(pos_x, voffset_x));
@@ -98,21 +109,75 @@ static void _camera_relocate_world(void) {
     }
   }
 
+  {
+    struct debris_data* dd = debris_get();
+    float* px = dd->position_orientation.position_x;
+    float* py = dd->position_orientation.position_y;
+    float* end_px = px + dd->active;
+
+    for (; px < end_px; px += 8, py += 8) {
+      __m256 pos_x = _mm256_load_ps(px);
+      __m256 pos_y = _mm256_load_ps(py);
+      _mm256_store_ps(px, _mm256_sub_ps(pos_x, voffset_x));
+      _mm256_store_ps(py, _mm256_sub_ps(pos_y, voffset_y));
+    }
+  }
+
   PROFILE_ZONE_END();
 }
 
 static void _camera_dispatch(entity_id_t id, message_t msg) {
   (void)id;
-
-  switch (msg.message) {
-  case MESSAGE_BROADCAST_120HZ_AFTER_PHYSICS:
-    _camera_relocate_world();
-    break;
-  }
+  (void)msg;
 }
 
 void camera_entity_initialize(void) {
   entity_manager_vtables[ENTITY_TYPE_CAMERA].dispatch_message = _camera_dispatch;
+
+  // shifts everything simulated this tick, so it goes after the other post-physics writers
+  system_t relocate = { .name = "camera_relocate_world",
+                        .phase = SYSTEM_PHASE_POST_PHYSICS,
+                        .reads = 0,
+                        .writes = COMPONENT_OBJECTS_TRANSFORM | COMPONENT_PARTS_TRANSFORM | COMPONENT_PARTICLES |
+                                  COMPONENT_DEBRIS | COMPONENT_CAMERA,
+                        .run = _camera_relocate_world };
+  scheduler_register(&relocate);
 }
 
 
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+// Test: relocating shifts objects and debris by the same offset
+void camera_test__relocate_moves_debris(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  entity_id_t ship = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 0);
+  uint32_t s = HOT_IDX(entity_manager_object_index(ship));
+  od->position_orientation.position_x[s] = SCREEN_CENTER_X + 100.0f;
+  od->position_orientation.position_y[s] = SCREEN_CENTER_Y - 40.0f;
+
+  __declspec(align(32)) float px[8] = { 10.0f };
+  __declspec(align(32)) float py[8] = { 20.0f };
+  __declspec(align(32)) float zero[8] = { 0.0f };
+  __declspec(align(32)) float ox[8] = { 1.0f };
+  __declspec(align(32)) uint16_t models[8] = { 0 };
+  debris_batch_t batch = { .count = 1, .x = px, .y = py, .vx = zero, .vy = zero, .ox = ox, .oy = zero,
+                           .model_idx = models, .radius = 2.0f, .ttl_min = 100 };
+  debris_emit(&batch);
+
+  entity_id_t previous = camera_get_entity();
+  camera_set_absolute_position(0.0, 0.0);
+  camera_set_entity(ship);
+  _camera_relocate_world();
+  camera_set_entity(previous);
+
+  struct debris_data* dd = debris_get();
+  TEST_ASSERT_EQUAL_UINT32(1, dd->active);
+  TEST_ASSERT_EQUAL_FLOAT(SCREEN_CENTER_X, od->position_orientation.position_x[s]);
+  TEST_ASSERT_EQUAL_FLOAT(SCREEN_CENTER_Y, od->position_orientation.position_y[s]);
+  TEST_ASSERT_EQUAL_FLOAT(10.0f - 100.0f, dd->position_orientation.position_x[0]);
+  TEST_ASSERT_EQUAL_FLOAT(20.0f + 40.0f, dd->position_orientation.position_y[0]);
+}
+
+#endif
@@ -5,5 +5,7 @@
 void camera_entity_initialize(void);
 void camera_set_entity(entity_id_t entity_id);
 void camera_get_absolute_position(double* out_x, double* out_y);
+entity_id_t camera_get_entity(void);
+void camera_set_absolute_position(double x, double y); // world origin in absolute coordinates, for restoring
 
 
@@ -1,5 +1,6 @@
 #include "platform/platform.h"
 #include "controller.h"
+#include "scheduler/scheduler.h"
 
 static entity_id_t _controlled_entity = INVALID_ENTITY;
 static int _last_rot = 0;
@@ -33,24 +34,34 @@ static void _process_keyboard() {
   }
 }
 
+static void _controller_tick(void) {
+  if (entity_manager_is_alive(_controlled_entity)) {
+    _process_mouse();
+    _process_keyboard();
+  }
+}
+
 static void _controller_dispatch(entity_id_t id, message_t msg) {
   (void)id;
-
-  switch (msg.message) {
-  case MESSAGE_BROADCAST_FRAME_TICK:
-    if (is_valid_id(_controlled_entity)) {
-      _process_mouse();
-      _process_keyboard();
-    }
-    break;
-  }
+  (void)msg;
 }
 
 void controller_set_entity(entity_id_t entity_id) {
   _controlled_entity = entity_id;
 }
 
+entity_id_t controller_get_entity(void) {
+  return _controlled_entity;
+}
+
 void controller_entity_initialize(void) {
   // we accept only broadcast for controller, no instances
   entity_manager_vtables[ENTITY_TYPE_CONTROLLER].dispatch_message = _controller_dispatch;
+
+  system_t input = { .name = "controller",
+                     .phase = SYSTEM_PHASE_INPUT,
+                     .reads = COMPONENT_INPUT | COMPONENT_OBJECTS_TRANSFORM,
+                     .writes = COMPONENT_MESSAGES,
+                     .run = _controller_tick };
+  scheduler_register(&input);
 }
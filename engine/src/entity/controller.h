@@ -4,3 +4,4 @@
 
 void controller_entity_initialize(void);
 void controller_set_entity(entity_id_t entity_id);
+entity_id_t controller_get_entity(void);
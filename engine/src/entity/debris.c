@@ -0,0 +1,392 @@
+#include "debris.h"
+#include "fracture.h"
+#include "platform/platform.h"
+#include "platform/math.h"
+#include "physics/physics.h"
+#include "scheduler/scheduler.h"
+#include "debug/profiler.h"
+#include "core/columns.h"
+#include "snapshot/snapshot.h"
+
+#include <immintrin.h>
+
+#define DEBRIS_MAX_BREAKS 256 // pieces breaking up in one tick, the rest just bounce
+
+static struct debris_data debris_ = { 0 };
+static column_set_t debris_columns_;
+static bool debris_reserved_ = false;
+
+// planets pulling this tick, GM premultiplied
+static struct {
+  uint32_t count;
+  float x[DEBRIS_MAX_ATTRACTORS];
+  float y[DEBRIS_MAX_ATTRACTORS];
+  float gm[DEBRIS_MAX_ATTRACTORS];
+} attractors_;
+
+static uint32_t breaking_[DEBRIS_MAX_BREAKS];
+static uint32_t breaking_count_ = 0;
+
+struct debris_data* debris_get(void) {
+  return &debris_;
+}
+
+void debris_emit(const debris_batch_t* batch) {
+  PROFILE_ZONE("debris_emit");
+
+  // whole groups of 8 get written, the lanes past count stay dead; the padded groups have to fit the reservation
+  uint32_t room = (DEBRIS_MAX_CAPACITY - debris_.active) & ~7u;
+  uint32_t count = batch->count < room ? batch->count : room;
+  uint32_t padded = (count + 7) & ~7u;
+  if (debris_.active + padded > debris_.capacity) {
+    debris_.capacity = column_set_reserve(&debris_columns_, debris_.active + padded);
+  }
+
+  position_orientation_t* po = &debris_.position_orientation;
+  __m256 radius = _mm256_set1_ps(batch->radius);
+  __m256 spin = _mm256_set1_ps(batch->spin);
+  __m256 ttl_min = _mm256_set1_ps((float)batch->ttl_min);
+  __m256 ttl_range = _mm256_set1_ps((float)batch->ttl_range);
+  __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  for (uint32_t i = 0; i < count; i += 8) {
+    uint32_t target = debris_.active + i;
+
+    _mm256_storeu_ps(po->position_x + target, _mm256_loadu_ps(batch->x + i));
+    _mm256_storeu_ps(po->position_y + target, _mm256_loadu_ps(batch->y + i));
+    _mm256_storeu_ps(po->orientation_x + target, _mm256_loadu_ps(batch->ox + i));
+    _mm256_storeu_ps(po->orientation_y + target, _mm256_loadu_ps(batch->oy + i));
+    _mm256_storeu_ps(po->radius + target, radius);
+    _mm256_storeu_ps(debris_.velocity_x + target, _mm256_loadu_ps(batch->vx + i));
+    _mm256_storeu_ps(debris_.velocity_y + target, _mm256_loadu_ps(batch->vy + i));
+    _mm256_storeu_ps(debris_.angular_velocity + target, _mm256_mul_ps(randf_symmetric_8(), spin));
+
+    // padding lanes get no lifetime, the next pack drops them
+    __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)(count - i)), lane);
+    __m256i ttl = _mm256_cvttps_epi32(_mm256_add_ps(ttl_min, _mm256_mul_ps(randf_8(), ttl_range)));
+    ttl = _mm256_and_si256(ttl, valid);
+    __m128i ttl16 = _mm_packus_epi32(_mm256_castsi256_si128(ttl), _mm256_extracti128_si256(ttl, 1));
+    _mm_storeu_si128((__m128i*)(debris_.lifetime_ticks + target), ttl16);
+    _mm_storeu_si128((__m128i*)(debris_.lifetime_max + target), ttl16);
+    _mm_storeu_si128((__m128i*)(debris_.model_idx + target), _mm_loadu_si128((const __m128i*)(batch->model_idx + i)));
+  }
+
+  debris_.active += count;
+  PROFILE_ZONE_END();
+}
+
+static void _debris_move(uint32_t target, uint32_t source) {
+  position_orientation_t* po = &debris_.position_orientation;
+  po->position_x[target] = po->position_x[source];
+  po->position_y[target] = po->position_y[source];
+  po->orientation_x[target] = po->orientation_x[source];
+  po->orientation_y[target] = po->orientation_y[source];
+  po->radius[target] = po->radius[source];
+  debris_.velocity_x[target] = debris_.velocity_x[source];
+  debris_.velocity_y[target] = debris_.velocity_y[source];
+  debris_.angular_velocity[target] = debris_.angular_velocity[source];
+  debris_.lifetime_ticks[target] = debris_.lifetime_ticks[source];
+  debris_.lifetime_max[target] = debris_.lifetime_max[source];
+  debris_.model_idx[target] = debris_.model_idx[source];
+}
+
+void debris_pack(void) {
+  PROFILE_ZONE("debris_pack");
+
+  // back to front: everything behind the group at hand is alive already, so the last piece can always
+  // fill a hole
+  __m128i zero = _mm_setzero_si128();
+  for (uint32_t group = (debris_.active + 7) & ~7u; group > 0;) {
+    group -= 8;
+
+    __m128i ttl = _mm_loadu_si128((const __m128i*)(debris_.lifetime_ticks + group));
+    uint32_t dead = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(ttl, zero), zero));
+    uint32_t remaining = debris_.active - group;
+    dead &= remaining >= 8 ? 0xFFu : (1u << remaining) - 1;
+
+    while (dead != 0) {
+      uint32_t lane = 31 - _lzcnt_u32(dead);
+      uint32_t idx = group + lane;
+
+      uint16_t model = debris_.model_idx[idx];
+      if (model >= FRAGMENT_MODEL_BASE && model < FRACTURE_CACHE_MODEL_BASE) {
+        fragment_pool_free(model - FRAGMENT_MODEL_BASE);
+      }
+
+      uint32_t last = --debris_.active;
+      if (idx != last) {
+        _debris_move(idx, last);
+      }
+      debris_.lifetime_ticks[last] = 0;
+      dead &= ~(1u << lane);
+    }
+  }
+
+  PROFILE_ZONE_END();
+}
+
+static void _debris_attractors(const struct objects_data* od) {
+  uint32_t first = od->type_start[ENTITY_TYPE_PLANET];
+  uint32_t count = od->type_count[ENTITY_TYPE_PLANET];
+  if (count > DEBRIS_MAX_ATTRACTORS) {
+    count = DEBRIS_MAX_ATTRACTORS;
+  }
+
+  for (uint32_t a = 0; a < count; a++) {
+    uint32_t hot = HOT_IDX(first + a);
+    attractors_.x[a] = od->position_orientation.position_x[hot];
+    attractors_.y[a] = od->position_orientation.position_y[hot];
+    attractors_.gm[a] = GRAVITATIONAL_CONSTANT * od->mass[hot];
+  }
+  attractors_.count = count;
+}
+
+// gravity, semi-implicit euler, spin and ttl, 8 pieces at a time
+static void _debris_integrate(void) {
+  position_orientation_t* po = &debris_.position_orientation;
+  __m256 dt = _mm256_set1_ps(TICK_S);
+  __m256 epsilon = _mm256_set1_ps(100.0f); // same softening as the objects' gravity
+  __m256 tiny = _mm256_set1_ps(1.0e-6f);
+  __m128i one = _mm_set1_epi16(1);
+
+  for (uint32_t i = 0; i < debris_.active; i += 8) {
+    __m256 px = _mm256_load_ps(po->position_x + i);
+    __m256 py = _mm256_load_ps(po->position_y + i);
+    __m256 vx = _mm256_load_ps(debris_.velocity_x + i);
+    __m256 vy = _mm256_load_ps(debris_.velocity_y + i);
+
+    __m256 ax = _mm256_setzero_ps();
+    __m256 ay = _mm256_setzero_ps();
+    for (uint32_t a = 0; a < attractors_.count; a++) {
+      __m256 dx = _mm256_sub_ps(_mm256_set1_ps(attractors_.x[a]), px);
+      __m256 dy = _mm256_sub_ps(_mm256_set1_ps(attractors_.y[a]), py);
+      __m256 dist_sq = _mm256_max_ps(_mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy)), epsilon);
+      __m256 inv_r = _mm256_rsqrt_ps(dist_sq);
+      __m256 pull = _mm256_mul_ps(_mm256_set1_ps(attractors_.gm[a]), _mm256_mul_ps(inv_r, _mm256_mul_ps(inv_r, inv_r)));
+      ax = _mm256_fmadd_ps(pull, dx, ax);
+      ay = _mm256_fmadd_ps(pull, dy, ay);
+    }
+
+    vx = _mm256_fmadd_ps(ax, dt, vx);
+    vy = _mm256_fmadd_ps(ay, dt, vy);
+    _mm256_store_ps(debris_.velocity_x + i, vx);
+    _mm256_store_ps(debris_.velocity_y + i, vy);
+    _mm256_store_ps(po->position_x + i, _mm256_fmadd_ps(vx, dt, px));
+    _mm256_store_ps(po->position_y + i, _mm256_fmadd_ps(vy, dt, py));
+
+    // turn by w * dt (small angle), renormalize
+    __m256 ox = _mm256_load_ps(po->orientation_x + i);
+    __m256 oy = _mm256_load_ps(po->orientation_y + i);
+    __m256 theta = _mm256_mul_ps(_mm256_load_ps(debris_.angular_velocity + i), dt);
+    __m256 turned_x = _mm256_fnmadd_ps(oy, theta, ox);
+    __m256 turned_y = _mm256_fmadd_ps(ox, theta, oy);
+    __m256 inv_len = _mm256_rsqrt_ps(
+        _mm256_max_ps(_mm256_fmadd_ps(turned_x, turned_x, _mm256_mul_ps(turned_y, turned_y)), tiny));
+    _mm256_store_ps(po->orientation_x + i, _mm256_mul_ps(turned_x, inv_len));
+    _mm256_store_ps(po->orientation_y + i, _mm256_mul_ps(turned_y, inv_len));
+
+    __m128i ttl = _mm_loadu_si128((const __m128i*)(debris_.lifetime_ticks + i));
+    _mm_storeu_si128((__m128i*)(debris_.lifetime_ticks + i), _mm_subs_epu16(ttl, one));
+  }
+}
+
+// circle against every object: pieces inside get pushed out to the surface, approaching ones bounce off
+// (and pick up spin from the sliding part), the ones coming in too fast are queued to break
+static void _debris_contacts(const struct objects_data* od) {
+  position_orientation_t* po = &debris_.position_orientation;
+  __m256 tiny = _mm256_set1_ps(1.0e-6f);
+  __m256 bounce = _mm256_set1_ps(1.0f + DEBRIS_RESTITUTION);
+  __m256 break_speed = _mm256_set1_ps(-DEBRIS_BREAK_SPEED);
+  __m256 zero = _mm256_setzero_ps();
+  __m256 half = _mm256_set1_ps(0.5f);
+  __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  breaking_count_ = 0;
+
+  for (uint32_t o = 0; o < od->active; o++) {
+    uint32_t hot = HOT_IDX(o);
+    __m256 cx = _mm256_set1_ps(od->position_orientation.position_x[hot]);
+    __m256 cy = _mm256_set1_ps(od->position_orientation.position_y[hot]);
+    __m256 cr = _mm256_set1_ps(od->position_orientation.radius[hot]);
+    __m256 cvx = _mm256_set1_ps(od->velocity_x[hot]);
+    __m256 cvy = _mm256_set1_ps(od->velocity_y[hot]);
+
+    for (uint32_t i = 0; i < debris_.active; i += 8) {
+      __m256 px = _mm256_load_ps(po->position_x + i);
+      __m256 py = _mm256_load_ps(po->position_y + i);
+      __m256 r = _mm256_add_ps(cr, _mm256_load_ps(po->radius + i));
+
+      __m256 dx = _mm256_sub_ps(px, cx);
+      __m256 dy = _mm256_sub_ps(py, cy);
+      __m256 dist_sq = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+
+      __m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32((int)(debris_.active - i)), lane));
+      __m256 touching = _mm256_and_ps(_mm256_cmp_ps(dist_sq, _mm256_mul_ps(r, r), _CMP_LT_OQ), valid);
+      if (_mm256_movemask_ps(touching) == 0) {
+        continue;
+      }
+
+      __m256 inv_dist = _mm256_rsqrt_ps(_mm256_max_ps(dist_sq, tiny));
+      __m256 nx = _mm256_mul_ps(dx, inv_dist);
+      __m256 ny = _mm256_mul_ps(dy, inv_dist);
+
+      // relative velocity, its normal part is negative when closing in
+      __m256 vx = _mm256_load_ps(debris_.velocity_x + i);
+      __m256 vy = _mm256_load_ps(debris_.velocity_y + i);
+      __m256 rvx = _mm256_sub_ps(vx, cvx);
+      __m256 rvy = _mm256_sub_ps(vy, cvy);
+      __m256 vn = _mm256_fmadd_ps(rvx, nx, _mm256_mul_ps(rvy, ny));
+      __m256 approaching = _mm256_and_ps(touching, _mm256_cmp_ps(vn, zero, _CMP_LT_OQ));
+
+      _mm256_store_ps(po->position_x + i, _mm256_blendv_ps(px, _mm256_fmadd_ps(nx, r, cx), touching));
+      _mm256_store_ps(po->position_y + i, _mm256_blendv_ps(py, _mm256_fmadd_ps(ny, r, cy), touching));
+
+      __m256 impulse = _mm256_and_ps(_mm256_mul_ps(bounce, vn), approaching);
+      _mm256_store_ps(debris_.velocity_x + i, _mm256_fnmadd_ps(impulse, nx, vx));
+      _mm256_store_ps(debris_.velocity_y + i, _mm256_fnmadd_ps(impulse, ny, vy));
+
+      // tangential speed over the piece's radius, halved
+      __m256 tangential = _mm256_fmsub_ps(nx, rvy, _mm256_mul_ps(ny, rvx));
+      __m256 spin = _mm256_div_ps(_mm256_mul_ps(tangential, half),
+                                  _mm256_max_ps(_mm256_load_ps(po->radius + i), _mm256_set1_ps(1.0f)));
+      __m256 w = _mm256_load_ps(debris_.angular_velocity + i);
+      _mm256_store_ps(debris_.angular_velocity + i, _mm256_add_ps(w, _mm256_and_ps(spin, approaching)));
+
+      uint32_t breaks =
+          (uint32_t)_mm256_movemask_ps(_mm256_and_ps(approaching, _mm256_cmp_ps(vn, break_speed, _CMP_LT_OQ)));
+      for (; breaks != 0 && breaking_count_ < DEBRIS_MAX_BREAKS; breaks &= breaks - 1) {
+        breaking_[breaking_count_++] = i + _tzcnt_u32(breaks);
+      }
+    }
+  }
+}
+
+static void _debris_tick(void) {
+  PROFILE_ZONE("debris_tick");
+  PROFILE_PLOT_I("debris", debris_.active);
+  struct objects_data* od = entity_manager_get_objects();
+
+  _debris_attractors(od);
+  _debris_integrate();
+  _debris_contacts(od);
+
+  if (breaking_count_ > 0) {
+    fracture_debris(breaking_, breaking_count_);
+  }
+  debris_pack();
+
+  PROFILE_ZONE_END();
+}
+
+void debris_snapshot_save(struct snapshot* snapshot) {
+  snapshot_write_columns(snapshot, SNAPSHOT_SECTION_DEBRIS, &debris_columns_, debris_.active);
+}
+
+bool debris_snapshot_load(struct snapshot* snapshot) {
+  bool loaded = snapshot_read_columns(snapshot, SNAPSHOT_SECTION_DEBRIS, &debris_columns_, &debris_.active);
+  debris_.capacity = debris_columns_.capacity;
+  return loaded;
+}
+
+void debris_clear(void) {
+  column_set_clear(&debris_columns_);
+  debris_.active = 0;
+  debris_.capacity = debris_columns_.capacity;
+}
+
+void debris_initialize(void) {
+  if (!debris_reserved_) {
+    column_set_t* set = &debris_columns_;
+    column_set_initialize(set, DEBRIS_MAX_CAPACITY);
+    column_set_add(set, (void**)&debris_.position_orientation.position_x, sizeof(float));
+    column_set_add(set, (void**)&debris_.position_orientation.position_y, sizeof(float));
+    column_set_add(set, (void**)&debris_.position_orientation.orientation_x, sizeof(float));
+    column_set_add(set, (void**)&debris_.position_orientation.orientation_y, sizeof(float));
+    column_set_add(set, (void**)&debris_.position_orientation.radius, sizeof(float));
+    column_set_add(set, (void**)&debris_.velocity_x, sizeof(float));
+    column_set_add(set, (void**)&debris_.velocity_y, sizeof(float));
+    column_set_add(set, (void**)&debris_.angular_velocity, sizeof(float));
+    column_set_add(set, (void**)&debris_.lifetime_ticks, sizeof(uint16_t));
+    column_set_add(set, (void**)&debris_.lifetime_max, sizeof(uint16_t));
+    column_set_add(set, (void**)&debris_.model_idx, sizeof(uint16_t));
+    column_set_add(set, (void**)&debris_.temporary, sizeof(struct _128bytes));
+    debris_.position_orientation.stride = 8;
+    debris_reserved_ = true;
+  }
+  debris_clear();
+
+  // after the objects moved, contacts see this tick's poses
+  system_t debris = { .name = "debris_physics",
+                      .phase = SYSTEM_PHASE_POST_PHYSICS,
+                      .reads = COMPONENT_OBJECTS_TRANSFORM,
+                      .writes = COMPONENT_DEBRIS | COMPONENT_FRAGMENTS | COMPONENT_RANDOM,
+                      .run = _debris_tick };
+  scheduler_register(&debris);
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+#include <string.h>
+
+static void _test_emit_piece(float x, float y, float vx, float vy, uint16_t model) {
+  __declspec(align(32)) float px[8] = { x };
+  __declspec(align(32)) float py[8] = { y };
+  __declspec(align(32)) float pvx[8] = { vx };
+  __declspec(align(32)) float pvy[8] = { vy };
+  __declspec(align(32)) float ox[8] = { 1.0f };
+  __declspec(align(32)) float oy[8] = { 0.0f };
+  __declspec(align(32)) uint16_t models[8] = { model };
+  debris_batch_t batch = { .count = 1, .x = px, .y = py, .vx = pvx, .vy = pvy, .ox = ox, .oy = oy,
+                           .model_idx = models, .radius = 2.0f, .spin = 0.0f, .ttl_min = 100 };
+  debris_emit(&batch);
+}
+
+// Test: a planet pulls, an object in the way bounces a piece back, a hard hit breaks it, dead pieces swap out
+void debris_test__gravity_contacts_and_pack(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  fracture_cache_initialize();
+
+  entity_id_t planet = entity_manager_spawn_object(ENTITY_TYPEREF_PLANET, 0);
+  uint32_t p = HOT_IDX(entity_manager_object_index(planet));
+  od->position_orientation.position_x[p] = 1000.0f;
+  od->position_orientation.radius[p] = 10.0f;
+  od->mass[p] = 1000.0f;
+
+  entity_id_t ship = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 0);
+  uint32_t s = HOT_IDX(entity_manager_object_index(ship));
+  od->position_orientation.position_x[s] = -100.0f;
+  od->position_orientation.radius[s] = 10.0f;
+
+  // a 20 x 20 square, big enough to break
+  int square = fragment_pool_alloc();
+  static const int8_t outline[16] = { -10, -10, 10, -10, 10, -10, 10, 10, 10, 10, -10, 10, -10, 10, -10, -10 };
+  memcpy(fragment_reserve_vertices(square, 8), outline, sizeof(outline));
+  int pooled = fragment_pool_alloc();
+
+  uint16_t cached = (uint16_t)FRACTURE_CACHE_MODEL_BASE;
+  _test_emit_piece(0.0f, 0.0f, 0.0f, 0.0f, cached);      // drifts towards the planet
+  _test_emit_piece(-89.0f, 0.0f, -10.0f, 0.0f, cached);  // slow into the ship: bounces
+  _test_emit_piece(-89.0f, 3.0f, -200.0f, 0.0f, (uint16_t)(FRAGMENT_MODEL_BASE + square)); // fast: breaks
+  _test_emit_piece(500.0f, 500.0f, 0.0f, 0.0f, (uint16_t)(FRAGMENT_MODEL_BASE + pooled));
+
+  struct debris_data* dd = debris_get();
+  TEST_ASSERT_EQUAL_UINT32(4, dd->active);
+  dd->lifetime_ticks[3] = 1; // dies this tick, its slot goes back
+
+  _debris_tick();
+
+  TEST_ASSERT_TRUE(dd->velocity_x[0] > 0.0f);
+  TEST_ASSERT_TRUE(dd->velocity_x[1] > 0.0f);
+  TEST_ASSERT_TRUE(dd->position_orientation.position_x[1] >= -100.0f + 12.0f - 0.01f); // pushed out
+
+  // the broken piece is gone, its pieces came in behind, both dead pieces gave their slots back
+  TEST_ASSERT_TRUE(dd->active > 2);
+  for (uint32_t i = 2; i < dd->active; i++) {
+    TEST_ASSERT_TRUE(dd->model_idx[i] >= FRAGMENT_MODEL_BASE && dd->model_idx[i] < FRACTURE_CACHE_MODEL_BASE);
+    TEST_ASSERT_TRUE(dd->lifetime_ticks[i] > 0);
+  }
+  TEST_ASSERT_EQUAL_INT(square, fragment_pool_alloc());
+  TEST_ASSERT_EQUAL_INT(pooled, fragment_pool_alloc());
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "entity_internal.h"
+
+// Debris: fracture pieces with more physics than particles and far less bookkeeping than objects - gravity
+// from the planets, circle contacts with objects and spin, no handles, parts or messages. Pieces live in one
+// column set in no particular order (dead ones are swap-removed), every pass works on 8 pieces at a time.
+//
+// A piece bounces off the objects it touches; one hitting an object faster than DEBRIS_BREAK_SPEED breaks
+// further (fracture_debris) instead.
+
+#define DEBRIS_MAX_CAPACITY (1 << 16)
+#define DEBRIS_MAX_ATTRACTORS 16 // planets pulling on debris, the first ones of the type range
+#define DEBRIS_RESTITUTION 0.4f
+#define DEBRIS_BREAK_SPEED 60.0f
+
+struct debris_data {
+  uint32_t active;
+  uint32_t capacity;
+
+  position_orientation_t position_orientation;
+
+  float* velocity_x;
+  float* velocity_y;
+  float* angular_velocity; // radians per second
+
+  uint16_t* lifetime_ticks;
+  uint16_t* lifetime_max;
+  uint16_t* model_idx; // fragment model, its arena slot is freed when the piece dies
+
+  struct _128bytes* temporary; // reserved memory for intermediate computations
+};
+
+// Emission, every piece has its own pose, velocity and model (arrays of count, padded to a multiple of 8),
+// the rest is shared: spin = [-spin, spin) radians per second, ttl = ttl_min + [0, ttl_range)
+typedef struct {
+  uint32_t count;
+
+  const float* x;
+  const float* y;
+  const float* vx;
+  const float* vy;
+  const float* ox;
+  const float* oy;
+  const uint16_t* model_idx;
+
+  float radius;
+  float spin;
+  uint16_t ttl_min;
+  uint16_t ttl_range;
+} debris_batch_t;
+
+void debris_initialize(void); // clears the pieces and registers the debris system
+void debris_clear(void);      // clears the pieces only
+struct debris_data* debris_get(void);
+
+void debris_emit(const debris_batch_t* batch);
+
+// drops the pieces whose lifetime ran out (or was zeroed) and gives their fragment slots back
+void debris_pack(void);
+
+struct snapshot;
+void debris_snapshot_save(struct snapshot* snapshot);
+bool debris_snapshot_load(struct snapshot* snapshot);
@@ -3,16 +3,175 @@
 #include "engine.h"
 
 #include "particles.h"
+#include "scheduler/scheduler.h"
+#include "core/columns.h"
+#include "debug/profiler.h"
+#include "snapshot/snapshot.h"
 #include "../generated/renderer.gen.h"
 
 #define THRUST_COEF 15
 #define THRUST_PARTICLE_COEF (1/15.0f)
 
-static void _set_part_thrust(uint32_t idx, float percentage) {
+static struct engine_components engines_ = { 0 };
+static column_set_t engines_columns_;
+static bool engines_reserved_ = false;
+static bool engines_grouped_ = false;
+
+struct engine_components* engine_get_components(void) {
+  return &engines_;
+}
+
+void engine_attach(uint32_t part_idx, float power, uint16_t particle_model) {
+  struct parts_data* pd = entity_manager_get_parts();
+  _ASSERT(pd->type[part_idx]._ == ENTITY_TYPE_PART_ENGINE);
+  _ASSERT(pd->component_idx[part_idx] == PART_NO_COMPONENT);
+
+  engines_.capacity = column_set_reserve(&engines_columns_, engines_.active + 1);
+  if (engines_.active >= engines_.capacity) {
+    return; // full: the part stays without a component
+  }
+
+  uint32_t idx = engines_.active++;
+  engines_.thrust[idx] = 0.0f;
+  engines_.power[idx] = power;
+  engines_.particle_model[idx] = particle_model;
+  engines_.part_idx[idx] = part_idx;
+
+  pd->component_idx[part_idx] = idx;
+  engines_grouped_ = false;
+}
+
+static void _engine_row_copy(uint32_t target, uint32_t source) {
+  engines_.thrust[target] = engines_.thrust[source];
+  engines_.power[target] = engines_.power[source];
+  engines_.particle_model[target] = engines_.particle_model[source];
+  engines_.part_idx[target] = engines_.part_idx[source];
+}
+
+// restores the part order and rebuilds the segments, rows are nearly sorted (only moved blocks and swapped-in
+// rows are out of place), so an insertion sort is linear in practice
+static void _engine_regroup(void) {
+  if (engines_grouped_) {
+    return;
+  }
+
+  PROFILE_ZONE("engine_regroup");
   struct parts_data* pd = entity_manager_get_parts();
 
-  struct engine_data* ed = (struct engine_data*)(pd->data[idx].data);
-  ed->thrust = percentage * THRUST_COEF * ed->power;
+  for (uint32_t i = 1; i < engines_.active; i++) {
+    uint32_t key = engines_.part_idx[i];
+    if (engines_.part_idx[i - 1] <= key) {
+      continue;
+    }
+
+    float thrust = engines_.thrust[i];
+    float power = engines_.power[i];
+    uint16_t particle_model = engines_.particle_model[i];
+
+    uint32_t j = i;
+    for (; j > 0 && engines_.part_idx[j - 1] > key; j--) {
+      _engine_row_copy(j, j - 1);
+    }
+    engines_.thrust[j] = thrust;
+    engines_.power[j] = power;
+    engines_.particle_model[j] = particle_model;
+    engines_.part_idx[j] = key;
+  }
+
+  uint32_t segments = 0;
+  for (uint32_t i = 0; i < engines_.active; i++) {
+    entity_id_t parent = pd->parent_id[engines_.part_idx[i]];
+    bool head = i == 0 || pd->parent_id[engines_.part_idx[i - 1]]._ != parent._;
+
+    pd->component_idx[engines_.part_idx[i]] = i;
+    engines_.segment_head[i] = head ? ~0u : 0u;
+    if (head) {
+      if (segments > 0) {
+        engines_.segment_last[segments - 1] = i - 1;
+      }
+      engines_.segment_parent[segments++] = parent;
+    }
+  }
+  if (segments > 0) {
+    engines_.segment_last[segments - 1] = engines_.active - 1;
+  }
+
+  engines_.segments = segments;
+  engines_grouped_ = true;
+  PROFILE_ZONE_END();
+}
+
+// shifts lanes up by `lanes`, the vacated low lanes read zero
+static inline __m256 _shift_up(__m256 v, __m256i permute, __m256 keep) {
+  return _mm256_and_ps(_mm256_permutevar8x32_ps(v, permute), keep);
+}
+
+struct engine_components* engine_sum_thrust_by_parent(void) {
+  _engine_regroup();
+
+  PROFILE_ZONE("engine_sum_thrust");
+  const __m256i permute_1 = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+  const __m256i permute_2 = _mm256_setr_epi32(0, 0, 0, 1, 2, 3, 4, 5);
+  const __m256i permute_4 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 2, 3);
+  const __m256 keep_1 = _mm256_castsi256_ps(_mm256_setr_epi32(0, -1, -1, -1, -1, -1, -1, -1));
+  const __m256 keep_2 = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, -1, -1, -1, -1, -1, -1));
+  const __m256 keep_4 = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, 0, -1, -1, -1, -1));
+  const __m256i last_lane = _mm256_set1_epi32(7);
+
+  // Hillis-Steele scan where a head stops the sum from crossing into the previous segment, lanes without a
+  // head at or below them continue the previous vector's segment through the carry
+  __m256 carry = _mm256_setzero_ps();
+  for (uint32_t base = 0; base < engines_.active; base += 8) {
+    __m256 sum = _mm256_load_ps(&engines_.thrust[base]);
+    __m256 head = _mm256_load_ps((const float*)&engines_.segment_head[base]);
+
+    sum = _mm256_add_ps(sum, _mm256_andnot_ps(head, _shift_up(sum, permute_1, keep_1)));
+    head = _mm256_or_ps(head, _shift_up(head, permute_1, keep_1));
+    sum = _mm256_add_ps(sum, _mm256_andnot_ps(head, _shift_up(sum, permute_2, keep_2)));
+    head = _mm256_or_ps(head, _shift_up(head, permute_2, keep_2));
+    sum = _mm256_add_ps(sum, _mm256_andnot_ps(head, _shift_up(sum, permute_4, keep_4)));
+    head = _mm256_or_ps(head, _shift_up(head, permute_4, keep_4));
+
+    sum = _mm256_add_ps(sum, _mm256_andnot_ps(head, carry));
+    _mm256_store_ps(&engines_.segment_sum[base], sum);
+    carry = _mm256_permutevar8x32_ps(sum, last_lane);
+  }
+
+  PROFILE_ZONE_END();
+  return &engines_;
+}
+
+void engine_snapshot_save(struct snapshot* snapshot) {
+  snapshot_write_columns(snapshot, SNAPSHOT_SECTION_ENGINES, &engines_columns_, engines_.active);
+}
+
+bool engine_snapshot_load(struct snapshot* snapshot) {
+  bool loaded = snapshot_read_columns(snapshot, SNAPSHOT_SECTION_ENGINES, &engines_columns_, &engines_.active);
+  engines_.capacity = engines_columns_.capacity;
+  engines_grouped_ = false;
+  return loaded;
+}
+
+static void _engine_part_moved(uint32_t component_idx, uint32_t part_idx) {
+  engines_.part_idx[component_idx] = part_idx;
+  engines_grouped_ = false;
+}
+
+static void _engine_part_released(uint32_t component_idx) {
+  uint32_t last = --engines_.active;
+  if (component_idx != last) {
+    _engine_row_copy(component_idx, last);
+
+    entity_manager_get_parts()->component_idx[engines_.part_idx[component_idx]] = component_idx;
+  }
+  engines_grouped_ = false;
+}
+
+static void _set_part_thrust(uint32_t part_idx, float percentage) {
+  struct parts_data* pd = entity_manager_get_parts();
+
+  uint32_t idx = pd->component_idx[part_idx];
+  engines_.thrust[idx] = percentage * THRUST_COEF * engines_.power[idx];
 }
 
 static void _engine_set_thrust_percentage(entity_id_t id, float percentage) {
@@ -21,81 +180,104 @@ static void _engine_set_thrust_percentage(entity_id_t id, float percentage) {
   if (IS_PART(id)) {
     _set_part_thrust(GET_ORDINAL(id), percentage);
   } else {
-    uint32_t object_idx = GET_ORDINAL(id);
-
+    uint32_t object_idx = entity_manager_object_index(id);
     struct objects_data* od = entity_manager_get_objects();
-    struct parts_data* pd = entity_manager_get_parts();
 
+    uint32_t first = od->parts_start_idx[object_idx];
+    uint32_t end = first + od->parts_count[object_idx];
 
-    for (uint32_t i = od->parts_start_idx[object_idx];
-         i < od->parts_start_idx[object_idx] + od->parts_count[object_idx]; ++i) {
-      if (pd->type[i]._ == ENTITY_TYPE_PART_ENGINE) {
-        _set_part_thrust(i, percentage);
+    // the object's engines are one run of rows, find its start by part index
+    _engine_regroup();
+    uint32_t lo = 0;
+    uint32_t hi = engines_.active;
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) / 2;
+      if (engines_.part_idx[mid] < first) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
       }
     }
+
+    float coef = percentage * THRUST_COEF;
+    for (uint32_t e = lo; e < engines_.active && engines_.part_idx[e] < end; e++) {
+      engines_.thrust[e] = coef * engines_.power[e];
+    }
+  }
+}
+
+#define EXHAUST_BATCH 64
+
+static void _engine_emit(particle_batch_t* batch) {
+  if (batch->count > 0) {
+    particles_emit(batch);
+    batch->count = 0;
   }
 }
 
-static void _engine_tick() {
+static void _engine_tick(void) {
   struct parts_data* pd = entity_manager_get_parts();
   struct objects_data* od = entity_manager_get_objects();
 
-  for (size_t i = 0; i < pd->active; i++) {
-    if (pd->type[i]._ == ENTITY_TYPE_PART_ENGINE) {
-      struct engine_data* ed = (struct engine_data*)(pd->data[i].data);
-
-      if (ed->thrust > 0.0f) {
-        // spawn probability based on thrust (higher thrust = more particles)
-        // at full thrust ~40% chance per tick, gives nice density without overwhelming
-        float spawn_chance = ed->thrust * 0.4f;
-        if (randf() > spawn_chance) {
-          continue;
-        }
-
-        float ox = od->position_orientation.orientation_x[GET_ORDINAL(pd->parent_id[i])];
-        float oy = od->position_orientation.orientation_y[GET_ORDINAL(pd->parent_id[i])];
-
-        float pvx = od->velocity_x[GET_ORDINAL(pd->parent_id[i])];
-        float pvy = od->velocity_y[GET_ORDINAL(pd->parent_id[i])];
-
-        // perpendicular vector for spread
-        float perp_x = -oy;
-        float perp_y = ox;
-
-        // velocity spread: cone angle ~15-20 degrees
-        float spread = randf_symmetric() * 0.3f;
-        float speed_variance = 0.7f + randf() * 0.6f;  // 70-130% speed
-
-        float base_speed = ed->thrust * 100.0f * THRUST_PARTICLE_COEF;
-        float vx = (-ox + perp_x * spread) * base_speed * speed_variance + pvx;
-        float vy = (-oy + perp_y * spread) * base_speed * speed_variance + pvy;
-
-        // position: spawn behind engine to avoid ship collision
-        float backward_offset = 8.0f;  // offset behind the ship
-        float pos_jitter = 2.0f;
-        float px = pd->world_position_orientation.position_x[i] - ox * backward_offset + perp_x * randf_symmetric() * pos_jitter;
-        float py = pd->world_position_orientation.position_y[i] - oy * backward_offset + perp_y * randf_symmetric() * pos_jitter;
-
-        // TTL variance: 0.5 - 1.5 seconds
-        uint16_t ttl = (uint16_t)((0.5f + randf() * 1.0f) * TICKS_IN_SECOND);
-
-        // random orientation (full 360°)
-        float rot_ox = randf_symmetric();
-        float rot_oy = randf_symmetric();
-
-        particle_create_t pcm = { .x = px,
-                                  .y = py,
-                                  .vx = vx,
-                                  .vy = vy,
-                                  .ox = rot_ox,
-                                  .oy = rot_oy,
-                                  .ttl = ttl,
-                                  .model_idx = ed->particle_model };
-
-        particles_create_particle(&pcm);
+  __declspec(align(32)) float x[EXHAUST_BATCH];
+  __declspec(align(32)) float y[EXHAUST_BATCH];
+  __declspec(align(32)) float vx[EXHAUST_BATCH];
+  __declspec(align(32)) float vy[EXHAUST_BATCH];
+  __declspec(align(32)) float dir_x[EXHAUST_BATCH];
+  __declspec(align(32)) float dir_y[EXHAUST_BATCH];
+  __declspec(align(32)) uint16_t models[EXHAUST_BATCH];
+
+  // cone of ~15-20 degrees, 70-130% speed, 0.5 - 1.5 s, random orientation
+  particle_batch_t batch = { .x = x,
+                             .y = y,
+                             .vx = vx,
+                             .vy = vy,
+                             .dir_x = dir_x,
+                             .dir_y = dir_y,
+                             .model_idx = models,
+                             .ttl_min = TICKS_IN_SECOND / 2,
+                             .ttl_range = TICKS_IN_SECOND,
+                             .speed_variance = 0.3f,
+                             .spread = 0.3f,
+                             .jitter = 2.0f };
+
+  __m256 zero = _mm256_setzero_ps();
+  __m256 chance_coef = _mm256_set1_ps(0.4f);
+
+  for (uint32_t base = 0; base < engines_.active; base += 8) {
+    // spawn probability based on thrust (higher thrust = more particles)
+    // at full thrust ~40% chance per tick, gives nice density without overwhelming
+    __m256 thrust = _mm256_load_ps(&engines_.thrust[base]);
+    __m256 spawn = _mm256_and_ps(_mm256_cmp_ps(thrust, zero, _CMP_GT_OQ),
+                                 _mm256_cmp_ps(randf_8(), _mm256_mul_ps(thrust, chance_coef), _CMP_LE_OQ));
+    uint32_t remaining = engines_.active - base;
+    uint32_t mask = (uint32_t)_mm256_movemask_ps(spawn) & (remaining >= 8 ? 0xFFu : (1u << remaining) - 1);
+
+    for (; mask != 0; mask &= mask - 1) {
+      uint32_t e = base + _tzcnt_u32(mask);
+      uint32_t i = engines_.part_idx[e];
+      uint32_t parent_idx = entity_manager_object_index(pd->parent_id[i]);
+      float ox = od->position_orientation.orientation_x[HOT_IDX(parent_idx)];
+      float oy = od->position_orientation.orientation_y[HOT_IDX(parent_idx)];
+      float base_speed = engines_.thrust[e] * 100.0f * THRUST_PARTICLE_COEF;
+
+      // spawn behind engine to avoid ship collision, exhaust goes backwards and inherits the ship's velocity
+      uint32_t n = batch.count++;
+      x[n] = pd->world_position_orientation.position_x[i] - ox * 8.0f;
+      y[n] = pd->world_position_orientation.position_y[i] - oy * 8.0f;
+      vx[n] = od->velocity_x[HOT_IDX(parent_idx)];
+      vy[n] = od->velocity_y[HOT_IDX(parent_idx)];
+      dir_x[n] = -ox * base_speed;
+      dir_y[n] = -oy * base_speed;
+      models[n] = engines_.particle_model[e];
+
+      if (batch.count == EXHAUST_BATCH) {
+        _engine_emit(&batch);
       }
     }
   }
+
+  _engine_emit(&batch);
 }
 
 static void _engine_part_dispatch(entity_id_t id, message_t msg) {
@@ -110,12 +292,127 @@ static void _engine_part_dispatch(entity_id_t id, message_t msg) {
       _engine_set_thrust_percentage(id, 0.0f);
     }
     break;
-
-  case MESSAGE_BROADCAST_120HZ_AFTER_PHYSICS:
-    _engine_tick();
   }
 }
 
+void engine_clear(void) {
+  engines_.active = 0;
+  engines_.segments = 0;
+  engines_grouped_ = false;
+  engines_.capacity = engines_columns_.capacity;
+}
+
 void engine_part_entity_initialize(void) {
   entity_manager_vtables[ENTITY_TYPE_PART_ENGINE].dispatch_message = _engine_part_dispatch;
+  entity_manager_vtables[ENTITY_TYPE_PART_ENGINE].part_moved = _engine_part_moved;
+  entity_manager_vtables[ENTITY_TYPE_PART_ENGINE].part_released = _engine_part_released;
+
+  if (!engines_reserved_) {
+    column_set_initialize(&engines_columns_, PARTS_MAX_CAPACITY);
+    column_set_add(&engines_columns_, (void**)&engines_.thrust, sizeof(float));
+    column_set_add(&engines_columns_, (void**)&engines_.power, sizeof(float));
+    column_set_add(&engines_columns_, (void**)&engines_.particle_model, sizeof(uint16_t));
+    column_set_add(&engines_columns_, (void**)&engines_.part_idx, sizeof(uint32_t));
+    column_set_add(&engines_columns_, (void**)&engines_.segment_head, sizeof(uint32_t));
+    column_set_add(&engines_columns_, (void**)&engines_.segment_sum, sizeof(float));
+    column_set_add(&engines_columns_, (void**)&engines_.segment_last, sizeof(uint32_t));
+    column_set_add(&engines_columns_, (void**)&engines_.segment_parent, sizeof(entity_id_t));
+    engines_reserved_ = true;
+  }
+  engine_clear();
+
+  system_t exhaust = { .name = "engine_exhaust",
+                       .phase = SYSTEM_PHASE_POST_PHYSICS,
+                       .reads = COMPONENT_OBJECTS_TRANSFORM | COMPONENT_PARTS_TRANSFORM | COMPONENT_PARTS_DATA,
+                       .writes = COMPONENT_PARTICLES | COMPONENT_RANDOM,
+                       .run = _engine_tick };
+  scheduler_register(&exhaust);
 }
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+// Test: engine rows follow their parts when blocks move and go away with a despawned object
+void engine_test__components_follow_parts(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  struct parts_data* pd = entity_manager_get_parts();
+
+  entity_id_t a = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 2);
+  entity_id_t b = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 1);
+
+  uint32_t a_part = od->parts_start_idx[entity_manager_object_index(a)] + 1;
+  uint32_t b_part = od->parts_start_idx[entity_manager_object_index(b)];
+  pd->type[a_part]._ = ENTITY_TYPE_PART_ENGINE;
+  pd->type[b_part]._ = ENTITY_TYPE_PART_ENGINE;
+  engine_attach(a_part, 1.0f, 1);
+  engine_attach(b_part, 0.5f, 2);
+  TEST_ASSERT_EQUAL_UINT32(2, engines_.active);
+  TEST_ASSERT_EQUAL_UINT32(PART_NO_COMPONENT, pd->component_idx[a_part - 1]);
+
+  _engine_set_thrust_percentage(b, 1.0f);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, engines_.thrust[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f * THRUST_COEF, engines_.thrust[1]);
+
+  // b's block moves into a's place, a's engine row is swapped out
+  entity_manager_despawn_object(a);
+
+  TEST_ASSERT_EQUAL_UINT32(1, engines_.active);
+  b_part = od->parts_start_idx[entity_manager_object_index(b)];
+  TEST_ASSERT_EQUAL_UINT32(0, b_part);
+  TEST_ASSERT_EQUAL_UINT32(0, pd->component_idx[b_part]);
+  TEST_ASSERT_EQUAL_UINT32(b_part, engines_.part_idx[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, engines_.power[0]);
+  TEST_ASSERT_EQUAL_UINT16(2, engines_.particle_model[0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f * THRUST_COEF, engines_.thrust[0]);
+}
+
+// Test: thrust sums per parent across vector boundaries, also after attaching out of order and despawning
+void engine_test__thrust_sums_per_parent(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  struct parts_data* pd = entity_manager_get_parts();
+
+  entity_id_t ships[3];
+  uint32_t engines[3] = { 3, 11, 5 };
+  for (uint32_t s = 0; s < 3; s++) {
+    ships[s] = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, engines[s] + 1);
+  }
+  // last ship first, so the rows start out grouped the wrong way round
+  for (uint32_t s = 3; s-- > 0;) {
+    uint32_t start = od->parts_start_idx[entity_manager_object_index(ships[s])];
+    for (uint32_t p = 1; p <= engines[s]; p++) {
+      pd->type[start + p]._ = ENTITY_TYPE_PART_ENGINE;
+      engine_attach(start + p, (float)p, 1);
+    }
+  }
+
+  _engine_set_thrust_percentage(ships[0], 1.0f);
+  _engine_set_thrust_percentage(ships[1], 0.5f);
+  _engine_set_thrust_percentage(ships[2], 0.1f);
+
+  struct engine_components* ec = engine_sum_thrust_by_parent();
+  TEST_ASSERT_EQUAL_UINT32(3, ec->segments);
+  for (uint32_t s = 0; s < 3; s++) {
+    float pct = s == 0 ? 1.0f : s == 1 ? 0.5f : 0.1f;
+    float expected = 0.0f;
+    for (uint32_t p = 1; p <= engines[s]; p++) {
+      expected += pct * THRUST_COEF * (float)p;
+    }
+    TEST_ASSERT_EQUAL_UINT32(ships[s]._, ec->segment_parent[s]._);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, expected, ec->segment_sum[ec->segment_last[s]]);
+  }
+
+  // the last block fills the middle hole, its rows get regrouped
+  entity_manager_despawn_object(ships[1]);
+  ec = engine_sum_thrust_by_parent();
+  TEST_ASSERT_EQUAL_UINT32(2, ec->segments);
+  TEST_ASSERT_EQUAL_UINT32(8, ec->active);
+  TEST_ASSERT_EQUAL_UINT32(ships[0]._, ec->segment_parent[0]._);
+  TEST_ASSERT_EQUAL_UINT32(ships[2]._, ec->segment_parent[1]._);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 6.0f * THRUST_COEF, ec->segment_sum[ec->segment_last[0]]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.5f * THRUST_COEF, ec->segment_sum[ec->segment_last[1]]);
+  for (uint32_t e = 0; e < ec->active; e++) {
+    TEST_ASSERT_EQUAL_UINT32(e, pd->component_idx[ec->part_idx[e]]);
+  }
+}
+
+#endif
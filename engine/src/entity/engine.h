@@ -2,10 +2,40 @@
 
 #include "entity_internal.h"
 
-struct engine_data {
-  float thrust;
-  float power;
-  uint16_t particle_model;
+// engine component table, one row per engine part
+// rows are kept ordered by part index (regrouped lazily after parts move), so the engines of one parent
+// object are always one contiguous run - a segment
+struct engine_components {
+  uint32_t active;
+  uint32_t capacity;
+  uint32_t segments;
+
+  float* __restrict thrust;
+  float* __restrict power;
+  uint16_t* __restrict particle_model;
+
+  uint32_t* __restrict part_idx; // owning part, kept up to date by the entity manager
+
+  uint32_t* __restrict segment_head; // ~0u on the first row of every segment, 0 elsewhere
+  float* __restrict segment_sum;     // running thrust within the segment, complete at its last row
+
+  // per segment (first `segments` entries)
+  uint32_t* __restrict segment_last; // last row of the segment
+  entity_id_t* __restrict segment_parent;
 };
 
 void engine_part_entity_initialize(void);
+void engine_clear(void); // drops every component, the hooks and systems stay
+struct engine_components* engine_get_components(void);
+
+// gives an (already typed) engine part its component row, none once the engine storage is full
+void engine_attach(uint32_t part_idx, float power, uint16_t particle_model);
+
+// regroups the rows if needed and sums thrust per parent with a segmented scan,
+// parent s gets segment_sum[segment_last[s]]
+struct engine_components* engine_sum_thrust_by_parent(void);
+
+// the table is saved next to the parts, part_idx stays valid because parts are restored in place
+struct snapshot;
+void engine_snapshot_save(struct snapshot* snapshot);
+bool engine_snapshot_load(struct snapshot* snapshot);
@@ -8,80 +8,115 @@
 #include "engine.h"
 #include "particles.h"
 #include "fracture.h"
+#include "debris.h"
 #include "camera.h"
 #include "planet.h"
 #include "debug/debug.h"
 #include "debug/profiler.h"
+#include "debug/dispatch_stats.h"
+#include "core/columns.h"
+#include "snapshot/snapshot.h"
 
-#define MAXSIZE 65535
 #define NONEXISTENT ((size_t)(-1))
 
+// slot -> dense index table behind object handles
+struct object_handles {
+  uint32_t* dense;     // dense index while the slot is alive, next free slot while it's on the free list
+  uint8_t* generation; // generation of the current (or next) occupant
+  uint32_t free_head;
+  uint32_t used; // slots handed out so far, [used, capacity) are implicitly free
+};
+
 typedef struct {
   struct objects_data objects;
   struct particles_data particles;
   struct parts_data parts;
+  struct object_handles handles;
+
+  column_set_t objects_hot_columns;
+  column_set_t objects_columns; // cold
+  column_set_t particles_columns;
+  column_set_t parts_columns;
+  column_set_t handles_columns; // indexed by slot
+  bool reserved;
 } entity_manager_t;
 
 object_vtable_t entity_manager_vtables[ENTITY_TYPE_COUNT] = { 0 };
 
 static entity_manager_t manager_ = { 0 };
 
-static void _position_orientation_initialize(position_orientation_t* position_orientation) {
-  position_orientation->position_x = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  position_orientation->position_y = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  position_orientation->orientation_x = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  position_orientation->orientation_y = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  position_orientation->radius = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-}
+#define COLUMN(set, field, type) column_set_add((set), (void**)&(field), sizeof(type))
 
-static void _parts_data_initialize(struct parts_data* data) {
-  _position_orientation_initialize(&data->world_position_orientation);
-  data->parent_id = platform_retrieve_memory(sizeof(entity_id_t) * MAXSIZE);
-  data->type = platform_retrieve_memory(sizeof(entity_type_t) * MAXSIZE);
-  data->local_offset_x = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->local_offset_y = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->local_orientation_x = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->local_orientation_y = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->model_idx = platform_retrieve_memory(sizeof(uint16_t) * MAXSIZE);
-  data->data = platform_retrieve_memory(sizeof(struct _128bytes) * MAXSIZE);
-  data->active = 0;
-  data->capacity = MAXSIZE;
+static void _position_orientation_initialize(column_set_t* set, position_orientation_t* position_orientation) {
+  COLUMN(set, position_orientation->position_x, float);
+  COLUMN(set, position_orientation->position_y, float);
+  COLUMN(set, position_orientation->orientation_x, float);
+  COLUMN(set, position_orientation->orientation_y, float);
+  COLUMN(set, position_orientation->radius, float);
 }
 
-static void _objects_data_initialize(struct objects_data* data) {
-  _position_orientation_initialize(&data->position_orientation);
-  data->velocity_x = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->velocity_y = platform_retrieve_memory(sizeof(float) * MAXSIZE);
+static void _parts_data_initialize(column_set_t* set, struct parts_data* data) {
+  column_set_initialize(set, PARTS_MAX_CAPACITY);
+
+  _position_orientation_initialize(set, &data->world_position_orientation);
+  data->world_position_orientation.stride = 8;
+  COLUMN(set, data->parent_id, entity_id_t);
+  COLUMN(set, data->parent_index, uint32_t);
+  COLUMN(set, data->parent_part_offset, uint32_t);
+  COLUMN(set, data->level, uint8_t);
+  COLUMN(set, data->type, entity_type_t);
+  COLUMN(set, data->local_offset_x, float);
+  COLUMN(set, data->local_offset_y, float);
+  COLUMN(set, data->local_orientation_x, float);
+  COLUMN(set, data->local_orientation_y, float);
+  COLUMN(set, data->model_idx, uint16_t);
+  COLUMN(set, data->component_idx, uint32_t);
+}
 
-  data->acceleration_x = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->acceleration_y = platform_retrieve_memory(sizeof(float) * MAXSIZE);
+static void _objects_data_initialize(column_set_t* hot, column_set_t* cold, struct objects_data* data) {
+#ifdef OBJECTS_AOSOA
+  column_set_initialize_tiled(hot, OBJECTS_MAX_CAPACITY, OBJECTS_HOT_COLUMNS, sizeof(float));
+#else
+  column_set_initialize(hot, OBJECTS_MAX_CAPACITY);
+#endif
+  column_set_initialize(cold, OBJECTS_MAX_CAPACITY);
 
-  data->thrust = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->model_idx = platform_retrieve_memory(sizeof(uint16_t) * MAXSIZE);
-  data->mass = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->type = platform_retrieve_memory(sizeof(entity_type_t) * MAXSIZE);
-  data->parts_start_idx = platform_retrieve_memory(sizeof(uint32_t) * MAXSIZE);
-  data->parts_count = platform_retrieve_memory(sizeof(uint32_t) * MAXSIZE);
+  _position_orientation_initialize(hot, &data->position_orientation);
+  data->position_orientation.stride = OBJECTS_HOT_STRIDE;
+  COLUMN(hot, data->velocity_x, float);
+  COLUMN(hot, data->velocity_y, float);
+  COLUMN(hot, data->acceleration_x, float);
+  COLUMN(hot, data->acceleration_y, float);
+  COLUMN(hot, data->thrust, float);
+  COLUMN(hot, data->mass, float);
+  _ASSERT(hot->count == OBJECTS_HOT_COLUMNS);
 
-  data->active = 0;
-  data->capacity = MAXSIZE;
+  COLUMN(cold, data->type, entity_type_t);
+  COLUMN(cold, data->parts_start_idx, uint32_t);
+  COLUMN(cold, data->parts_count, uint32_t);
+  COLUMN(cold, data->model_idx, uint16_t);
+  COLUMN(cold, data->handle, entity_id_t);
 }
 
-static void _particles_data_initialize(struct particles_data* data) {
-  _position_orientation_initialize(&data->position_orientation);
+static void _particles_data_initialize(column_set_t* set, struct particles_data* data) {
+  column_set_initialize(set, PARTICLES_MAX_CAPACITY);
 
-  data->velocity_x = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->velocity_y = platform_retrieve_memory(sizeof(float) * MAXSIZE);
-  data->lifetime_ticks = platform_retrieve_memory(sizeof(uint16_t) * MAXSIZE);
-  data->lifetime_max = platform_retrieve_memory(sizeof(uint16_t) * MAXSIZE);
-  data->model_idx = platform_retrieve_memory(sizeof(uint16_t) * MAXSIZE);
-  data->temporary = platform_retrieve_memory(sizeof(struct _128bytes) * MAXSIZE);
+  _position_orientation_initialize(set, &data->position_orientation);
+  data->position_orientation.stride = 8;
+
+  COLUMN(set, data->velocity_x, float);
+  COLUMN(set, data->velocity_y, float);
+  COLUMN(set, data->lifetime_ticks, uint16_t);
+  COLUMN(set, data->lifetime_max, uint16_t);
+  COLUMN(set, data->model_idx, uint16_t);
+  COLUMN(set, data->temporary, struct _128bytes);
+}
 
-  platform_clear_memory(data->lifetime_max, sizeof(uint16_t) * MAXSIZE);
-  platform_clear_memory(data->lifetime_ticks, sizeof(uint16_t) * MAXSIZE);
+static void _object_handles_initialize(column_set_t* set, struct object_handles* handles) {
+  column_set_initialize(set, OBJECTS_MAX_CAPACITY);
 
-  data->active = 0;
-  data->capacity = MAXSIZE;
+  COLUMN(set, handles->dense, uint32_t);
+  COLUMN(set, handles->generation, uint8_t);
 }
 
 static void _entity_manager_types_initialize(void) {
@@ -93,12 +128,42 @@ static void _entity_manager_types_initialize(void) {
   planet_entity_initialize();
 }
 
-void entity_manager_initialize(void) {
-  _objects_data_initialize(&manager_.objects);
-  _particles_data_initialize(&manager_.particles);
-  _parts_data_initialize(&manager_.parts);
+static void _entity_manager_storage_clear(void) {
+  // re-initialization keeps the address space and whatever got committed
+  column_set_clear(&manager_.objects_hot_columns);
+  column_set_clear(&manager_.objects_columns);
+  column_set_clear(&manager_.particles_columns);
+  column_set_clear(&manager_.parts_columns);
+  column_set_clear(&manager_.handles_columns);
+
+  manager_.objects.active = 0;
+  platform_clear_memory(manager_.objects.type_start, sizeof(manager_.objects.type_start));
+  platform_clear_memory(manager_.objects.type_count, sizeof(manager_.objects.type_count));
+  manager_.objects.capacity = manager_.objects_columns.capacity;
+  manager_.particles.active = 0;
+  manager_.particles.first = 0;
+  manager_.particles.capacity = manager_.particles_columns.capacity;
+  manager_.parts.active = 0;
+  manager_.parts.levels = 0;
+  manager_.parts.capacity = manager_.parts_columns.capacity;
+  manager_.handles.free_head = (uint32_t)NONEXISTENT;
+  manager_.handles.used = 0;
 
   fragment_pool_initialize();
+}
+
+void entity_manager_initialize(void) {
+  if (!manager_.reserved) {
+    _objects_data_initialize(&manager_.objects_hot_columns, &manager_.objects_columns, &manager_.objects);
+    _particles_data_initialize(&manager_.particles_columns, &manager_.particles);
+    _parts_data_initialize(&manager_.parts_columns, &manager_.parts);
+    _object_handles_initialize(&manager_.handles_columns, &manager_.handles);
+    manager_.reserved = true;
+  }
+
+  _entity_manager_storage_clear();
+  fracture_cache_initialize();
+  debris_initialize();
   _entity_manager_types_initialize();
 
 #ifndef UNIT_TESTS
@@ -106,6 +171,15 @@ void entity_manager_initialize(void) {
 #endif
 }
 
+void entity_manager_clear(void) {
+  _entity_manager_storage_clear();
+  debris_clear();
+  engine_clear();
+  particles_clear();
+  controller_set_entity((entity_id_t)INVALID_ENTITY);
+  camera_set_entity((entity_id_t)INVALID_ENTITY);
+}
+
 struct particles_data* entity_manager_get_particles(void) {
   return &manager_.particles;
 }
@@ -118,17 +192,21 @@ struct parts_data* entity_manager_get_parts(void) {
   return &manager_.parts;
 }
 
+void entity_manager_reserve_particles(uint32_t count) {
+  manager_.particles.capacity = column_set_reserve(&manager_.particles_columns, count);
+}
+
 void entity_manager_get_vectors(entity_id_t entity_id, float* pos, float* vel) {
   struct objects_data* od = &manager_.objects;
-  size_t idx = GET_ORDINAL(entity_id);
+  size_t idx = entity_manager_object_index(entity_id);
   if (pos != NULL) {
-    pos[0] = od->position_orientation.position_x[idx];
-    pos[1] = od->position_orientation.position_y[idx];
+    pos[0] = od->position_orientation.position_x[HOT_IDX(idx)];
+    pos[1] = od->position_orientation.position_y[HOT_IDX(idx)];
   }
 
   if (vel != NULL) {
-    vel[0] = od->velocity_x[idx];
-    vel[1] = od->velocity_y[idx];
+    vel[0] = od->velocity_x[HOT_IDX(idx)];
+    vel[1] = od->velocity_y[HOT_IDX(idx)];
   }
 }
 
@@ -136,23 +214,465 @@ entity_id_t entity_manager_resolve_object(uint32_t ordinal) {
   struct objects_data* od = &manager_.objects;
   _ASSERT(ordinal < od->active);
 
-  entity_type_t type = od->type[ordinal];
-  entity_id_t ret = OBJECT_ID_WITH_TYPE(ordinal, type._);
-  return ret;
+  return od->handle[ordinal];
+}
+
+bool entity_manager_is_alive(entity_id_t id) {
+  struct object_handles* handles = &manager_.handles;
+  uint32_t slot = GET_SLOT(id);
+
+  if (!is_valid_id(id) || IS_PART(id) || slot >= handles->used || handles->generation[slot] != GET_GENERATION(id)) {
+    return false;
+  }
+
+  // free slots keep the free list in dense, make sure it really points back to us
+  uint32_t idx = handles->dense[slot];
+  return idx < manager_.objects.active && GET_SLOT(manager_.objects.handle[idx]) == slot;
+}
+
+uint32_t entity_manager_object_index(entity_id_t id) {
+  _ASSERT(entity_manager_is_alive(id));
+  return manager_.handles.dense[GET_SLOT(id)];
+}
+
+// everything of the manager that doesn't live in a column set, plus who the controller and camera follow
+struct entity_snapshot_state {
+  uint32_t objects_active;
+  uint32_t type_start[ENTITY_TYPE_COUNT];
+  uint32_t type_count[ENTITY_TYPE_COUNT];
+  uint32_t parts_active;
+  uint32_t parts_levels;
+  uint32_t particles_active;
+  uint32_t particles_first;
+  uint32_t handles_free_head;
+  uint32_t handles_used;
+
+  entity_id_t controlled;
+  entity_id_t camera_target;
+  double camera_x;
+  double camera_y;
+};
+
+void entity_manager_snapshot_save(struct snapshot* snapshot) {
+  struct entity_snapshot_state state = { .objects_active = manager_.objects.active,
+                                         .parts_active = manager_.parts.active,
+                                         .parts_levels = manager_.parts.levels,
+                                         .particles_active = manager_.particles.active,
+                                         .particles_first = manager_.particles.first,
+                                         .handles_free_head = manager_.handles.free_head,
+                                         .handles_used = manager_.handles.used,
+                                         .controlled = controller_get_entity(),
+                                         .camera_target = camera_get_entity() };
+  platform_copy_memory(state.type_start, manager_.objects.type_start, sizeof(state.type_start));
+  platform_copy_memory(state.type_count, manager_.objects.type_count, sizeof(state.type_count));
+  camera_get_absolute_position(&state.camera_x, &state.camera_y);
+
+  snapshot_write(snapshot, SNAPSHOT_SECTION_ENTITY_STATE, &state, sizeof(state));
+  snapshot_write_columns(snapshot, SNAPSHOT_SECTION_OBJECTS_HOT, &manager_.objects_hot_columns,
+                         manager_.objects.active);
+  snapshot_write_columns(snapshot, SNAPSHOT_SECTION_OBJECTS_COLD, &manager_.objects_columns, manager_.objects.active);
+  snapshot_write_columns(snapshot, SNAPSHOT_SECTION_HANDLES, &manager_.handles_columns, manager_.handles.used);
+  snapshot_write_columns(snapshot, SNAPSHOT_SECTION_PARTS, &manager_.parts_columns, manager_.parts.active);
+  snapshot_write_columns(snapshot, SNAPSHOT_SECTION_PARTICLES, &manager_.particles_columns,
+                         manager_.particles.active);
+}
+
+bool entity_manager_snapshot_load(struct snapshot* snapshot) {
+  size_t size;
+  const struct entity_snapshot_state* state = snapshot_read(snapshot, SNAPSHOT_SECTION_ENTITY_STATE, &size);
+  if (state == NULL || size != sizeof(*state)) {
+    return false;
+  }
+
+  // the hot set is loaded with the cold count, both are indexed by the dense object index
+  uint32_t hot_active = manager_.objects.active;
+  bool loaded =
+      snapshot_read_columns(snapshot, SNAPSHOT_SECTION_OBJECTS_HOT, &manager_.objects_hot_columns, &hot_active) &&
+      snapshot_read_columns(snapshot, SNAPSHOT_SECTION_OBJECTS_COLD, &manager_.objects_columns,
+                            &manager_.objects.active) &&
+      snapshot_read_columns(snapshot, SNAPSHOT_SECTION_HANDLES, &manager_.handles_columns, &manager_.handles.used) &&
+      snapshot_read_columns(snapshot, SNAPSHOT_SECTION_PARTS, &manager_.parts_columns, &manager_.parts.active) &&
+      snapshot_read_columns(snapshot, SNAPSHOT_SECTION_PARTICLES, &manager_.particles_columns,
+                            &manager_.particles.active);
+  if (!loaded || hot_active != state->objects_active || manager_.objects.active != state->objects_active ||
+      manager_.parts.active != state->parts_active || manager_.particles.active != state->particles_active ||
+      manager_.handles.used != state->handles_used) {
+    return false;
+  }
+
+  platform_copy_memory(manager_.objects.type_start, state->type_start, sizeof(state->type_start));
+  platform_copy_memory(manager_.objects.type_count, state->type_count, sizeof(state->type_count));
+  manager_.objects.capacity = manager_.objects_columns.capacity;
+  manager_.parts.capacity = manager_.parts_columns.capacity;
+  manager_.parts.levels = state->parts_levels;
+  manager_.particles.capacity = manager_.particles_columns.capacity;
+  manager_.particles.first = state->particles_first;
+  manager_.handles.free_head = state->handles_free_head;
+
+  controller_set_entity(state->controlled);
+  camera_set_entity(state->camera_target);
+  camera_set_absolute_position(state->camera_x, state->camera_y);
+  return true;
+}
+
+static void _part_move(struct parts_data* pd, uint32_t target, uint32_t source) {
+  pd->parent_id[target] = pd->parent_id[source];
+  pd->parent_index[target] = pd->parent_index[source];
+  pd->parent_part_offset[target] = pd->parent_part_offset[source];
+  pd->level[target] = pd->level[source];
+  pd->type[target] = pd->type[source];
+  pd->local_offset_x[target] = pd->local_offset_x[source];
+  pd->local_offset_y[target] = pd->local_offset_y[source];
+  pd->local_orientation_x[target] = pd->local_orientation_x[source];
+  pd->local_orientation_y[target] = pd->local_orientation_y[source];
+  pd->component_idx[target] = pd->component_idx[source];
+  pd->world_position_orientation.position_x[target] = pd->world_position_orientation.position_x[source];
+  pd->world_position_orientation.position_y[target] = pd->world_position_orientation.position_y[source];
+  pd->world_position_orientation.orientation_x[target] = pd->world_position_orientation.orientation_x[source];
+  pd->world_position_orientation.orientation_y[target] = pd->world_position_orientation.orientation_y[source];
+  pd->world_position_orientation.radius[target] = pd->world_position_orientation.radius[source];
+  pd->model_idx[target] = pd->model_idx[source];
+
+  // the hooks are optional, only part types with a component table set them
+  void (*part_moved)(uint32_t, uint32_t) = entity_manager_vtables[pd->type[target]._].part_moved;
+  if (pd->component_idx[target] != PART_NO_COMPONENT && part_moved != NULL) {
+    part_moved(pd->component_idx[target], target);
+  }
+}
+
+static void _object_move(struct objects_data* od, uint32_t target, uint32_t source) {
+  uint32_t ht = HOT_IDX(target);
+  uint32_t hs = HOT_IDX(source);
+
+  od->velocity_x[ht] = od->velocity_x[hs];
+  od->velocity_y[ht] = od->velocity_y[hs];
+  od->acceleration_x[ht] = od->acceleration_x[hs];
+  od->acceleration_y[ht] = od->acceleration_y[hs];
+  od->thrust[ht] = od->thrust[hs];
+  od->type[target] = od->type[source];
+  od->position_orientation.position_x[ht] = od->position_orientation.position_x[hs];
+  od->position_orientation.position_y[ht] = od->position_orientation.position_y[hs];
+  od->position_orientation.orientation_x[ht] = od->position_orientation.orientation_x[hs];
+  od->position_orientation.orientation_y[ht] = od->position_orientation.orientation_y[hs];
+  od->position_orientation.radius[ht] = od->position_orientation.radius[hs];
+  od->parts_start_idx[target] = od->parts_start_idx[source];
+  od->parts_count[target] = od->parts_count[source];
+  od->model_idx[target] = od->model_idx[source];
+  od->mass[ht] = od->mass[hs];
+  od->handle[target] = od->handle[source];
+}
+
+// moves an object to another dense index, its handle and its parts' parent_index follow
+static void _object_relocate(struct objects_data* od, uint32_t target, uint32_t source) {
+  _object_move(od, target, source);
+  manager_.handles.dense[GET_SLOT(od->handle[target])] = target;
+
+  uint32_t* __restrict parent_index = manager_.parts.parent_index;
+  uint32_t parts_end = od->parts_start_idx[target] + od->parts_count[target];
+  for (uint32_t i = od->parts_start_idx[target]; i < parts_end; i++) {
+    parent_index[i] = target;
+  }
+}
+
+// closes the hole left by the parts block of a despawned object
+static void _parts_block_release(struct objects_data* od, struct parts_data* pd, uint32_t start, uint32_t count) {
+  uint32_t end = start + count;
+  _ASSERT(end <= pd->active);
+
+  for (uint32_t i = start; i < end; i++) {
+    void (*part_released)(uint32_t) = entity_manager_vtables[pd->type[i]._].part_released;
+    if (pd->component_idx[i] != PART_NO_COMPONENT && part_released != NULL) {
+      part_released(pd->component_idx[i]);
+    }
+  }
+
+  if (end < pd->active) {
+    uint32_t last_owner = pd->parent_index[pd->active - 1];
+    uint32_t last_count = od->parts_count[last_owner];
+
+    if (last_count == count) {
+      // same size, the last block fills the hole
+      uint32_t last_start = od->parts_start_idx[last_owner];
+      for (uint32_t i = 0; i < count; i++) {
+        _part_move(pd, start + i, last_start + i);
+      }
+      od->parts_start_idx[last_owner] = start;
+    } else {
+      // shift everything behind the hole down, blocks stay in storage order
+      for (uint32_t i = end; i < pd->active; i++) {
+        _part_move(pd, i - count, i);
+      }
+      for (uint32_t i = 0; i < od->active; i++) {
+        if (od->parts_count[i] > 0 && od->parts_start_idx[i] > start) {
+          od->parts_start_idx[i] -= count;
+        }
+      }
+    }
+  }
+
+  pd->active -= count;
+}
+
+entity_id_t entity_manager_spawn_object(entity_type_t type, uint32_t parts_count) {
+  struct objects_data* od = &manager_.objects;
+  struct parts_data* pd = &manager_.parts;
+  struct object_handles* handles = &manager_.handles;
+
+  column_set_reserve(&manager_.objects_hot_columns, od->active + 1);
+  od->capacity = column_set_reserve(&manager_.objects_columns, od->active + 1);
+  pd->capacity = column_set_reserve(&manager_.parts_columns, pd->active + parts_count);
+
+  // full: refuse the spawn (the last slot stays reserved for TYPE_BROADCAST)
+  if (od->active >= OBJECTS_MAX_CAPACITY || od->active >= od->capacity || pd->active + parts_count > pd->capacity) {
+    return (entity_id_t)INVALID_ENTITY;
+  }
+
+  uint32_t slot;
+  if (handles->free_head != (uint32_t)NONEXISTENT) {
+    slot = handles->free_head;
+    handles->free_head = handles->dense[slot];
+  } else {
+    _ASSERT(handles->used < ENTITY_SLOT_MASK);
+    column_set_reserve(&manager_.handles_columns, handles->used + 1);
+    slot = handles->used++;
+    handles->generation[slot] = 0;
+  }
+
+  // open a hole at the end of the type's range, every later range rotates by one (first object goes last)
+  uint32_t idx = od->active++;
+  for (uint32_t t = ENTITY_TYPE_COUNT - 1; t > type._; t--) {
+    if (od->type_count[t] > 0) {
+      _object_relocate(od, idx, od->type_start[t]);
+      idx = od->type_start[t];
+    }
+    od->type_start[t]++;
+  }
+  od->type_count[type._]++;
+
+  entity_id_t id = OBJECT_ID_WITH_TYPE(((uint32_t)handles->generation[slot] << ENTITY_SLOT_BITS) | slot, type._);
+  handles->dense[slot] = idx;
+
+  od->handle[idx] = id;
+  od->type[idx] = type;
+
+  uint32_t hot = HOT_IDX(idx);
+  od->velocity_x[hot] = 0.0f;
+  od->velocity_y[hot] = 0.0f;
+  od->acceleration_x[hot] = 0.0f;
+  od->acceleration_y[hot] = 0.0f;
+  od->thrust[hot] = 0.0f;
+  od->position_orientation.position_x[hot] = 0.0f;
+  od->position_orientation.position_y[hot] = 0.0f;
+  od->position_orientation.orientation_x[hot] = 1.0f;
+  od->position_orientation.orientation_y[hot] = 0.0f;
+  od->position_orientation.radius[hot] = 0.0f;
+  od->mass[hot] = 0.0f;
+  od->model_idx[idx] = 0;
+
+  od->parts_start_idx[idx] = pd->active;
+  od->parts_count[idx] = parts_count;
+
+  for (uint32_t i = pd->active; i < pd->active + parts_count; i++) {
+    pd->parent_id[i] = id;
+    pd->parent_index[i] = idx;
+    pd->parent_part_offset[i] = 0;
+    pd->level[i] = 0;
+    pd->type[i]._ = ENTITY_TYPE_ANY;
+    pd->local_offset_x[i] = 0.0f;
+    pd->local_offset_y[i] = 0.0f;
+    pd->local_orientation_x[i] = 1.0f;
+    pd->local_orientation_y[i] = 0.0f;
+    pd->model_idx[i] = 0xFFFF;
+    pd->component_idx[i] = PART_NO_COMPONENT;
+  }
+  pd->active += parts_count;
+
+  return id;
+}
+
+void entity_manager_mount_part(uint32_t part_idx, uint32_t parent_part_idx) {
+  struct parts_data* pd = &manager_.parts;
+  _ASSERT(parent_part_idx < part_idx && part_idx < pd->active);
+  _ASSERT(pd->parent_index[part_idx] == pd->parent_index[parent_part_idx]);
+  _ASSERT(pd->level[parent_part_idx] < 0xFF);
+
+  uint8_t level = (uint8_t)(pd->level[parent_part_idx] + 1);
+  pd->parent_part_offset[part_idx] = part_idx - parent_part_idx;
+  pd->level[part_idx] = level;
+
+  // levels only grow until the next initialize, a stale deeper level costs one empty pass
+  if (level > pd->levels) {
+    pd->levels = level;
+  }
+}
+
+void entity_manager_despawn_object(entity_id_t id) {
+  struct objects_data* od = &manager_.objects;
+  struct parts_data* pd = &manager_.parts;
+  struct object_handles* handles = &manager_.handles;
+
+  uint32_t slot = GET_SLOT(id);
+  uint32_t idx = entity_manager_object_index(id);
+
+  if (od->parts_count[idx] > 0) {
+    _parts_block_release(od, pd, od->parts_start_idx[idx], od->parts_count[idx]);
+  }
+
+  // swap-remove inside the type's range, then every later range rotates by one (last object goes first)
+  uint32_t type = od->type[idx]._;
+  uint32_t hole = idx;
+  uint32_t last = od->type_start[type] + --od->type_count[type];
+  if (hole != last) {
+    _object_relocate(od, hole, last);
+  }
+  hole = last;
+
+  for (uint32_t t = type + 1; t < ENTITY_TYPE_COUNT; t++) {
+    od->type_start[t]--;
+    if (od->type_count[t] > 0) {
+      last = od->type_start[t] + od->type_count[t];
+      _object_relocate(od, hole, last);
+      hole = last;
+    }
+  }
+  od->active--;
+
+  // rows past active still take part in the unmasked gravity loop, the vacated one must not pull anything
+  od->mass[HOT_IDX(od->active)] = 0.0f;
+  od->thrust[HOT_IDX(od->active)] = 0.0f;
+
+  handles->generation[slot] = (uint8_t)((handles->generation[slot] + 1) & ENTITY_GENERATION_MASK);
+  handles->dense[slot] = handles->free_head;
+  handles->free_head = slot;
 }
 
 void entity_manager_dispatch_message(entity_id_t recipient_id, message_t msg) {
   uint8_t entity_type = GET_TYPE(recipient_id);
 
+  // messages queued for an object that got despawned in the meantime are dropped
+  if (recipient_id._ != RECIPIENT_ID_BROADCAST._ && !IS_PART(recipient_id) &&
+      GET_SLOT(recipient_id) != ENTITY_SLOT_MASK && !entity_manager_is_alive(recipient_id)) {
+    return;
+  }
+
   if (recipient_id._ == RECIPIENT_ID_BROADCAST._) {
-    for (size_t i = 1; i < ENTITY_TYPE_COUNT; i++) {
+    for (uint8_t i = 1; i < ENTITY_TYPE_COUNT; i++) {
+      DISPATCH_STATS_BEGIN();
       entity_manager_vtables[i].dispatch_message(recipient_id, msg);
+      DISPATCH_STATS_END(i, msg.message);
     }
   } else if (entity_type != RECIPIENT_TYPE_ANY._) {
     _ASSERT(entity_type >= 0 && entity_type < ENTITY_TYPE_COUNT);
 
+    DISPATCH_STATS_BEGIN();
     entity_manager_vtables[entity_type].dispatch_message(recipient_id, msg);
+    DISPATCH_STATS_END(entity_type, msg.message);
   } else {
     _ASSERT(0 && "missing type in id");
   }
 }
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+// Test: despawn swap-removes, relocates the parts block and keeps the other handles valid
+void entity_test__despawn_keeps_handles_stable(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  struct parts_data* pd = entity_manager_get_parts();
+
+  entity_id_t a = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 2);
+  entity_id_t b = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 3);
+  entity_id_t c = entity_manager_spawn_object(ENTITY_TYPEREF_PLANET, 0);
+  entity_id_t d = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 1);
+
+  od->position_orientation.position_x[HOT_IDX(entity_manager_object_index(d))] = 4.0f;
+  pd->local_offset_x[od->parts_start_idx[entity_manager_object_index(d)]] = 42.0f;
+  TEST_ASSERT_EQUAL_UINT32(6, pd->active);
+
+  // a component on parts of a type without the hooks: releasing and moving them must skip the calls
+  pd->component_idx[od->parts_start_idx[entity_manager_object_index(b)]] = 0;
+  pd->component_idx[od->parts_start_idx[entity_manager_object_index(d)]] = 0;
+
+  entity_manager_despawn_object(b);
+
+  TEST_ASSERT_FALSE(entity_manager_is_alive(b));
+  TEST_ASSERT_TRUE(entity_manager_is_alive(a));
+  TEST_ASSERT_TRUE(entity_manager_is_alive(c));
+  TEST_ASSERT_TRUE(entity_manager_is_alive(d));
+  TEST_ASSERT_EQUAL_UINT32(3, od->active);
+  TEST_ASSERT_EQUAL_UINT32(3, pd->active);
+
+  // d took b's place in both arrays, its part shifted down behind a's
+  uint32_t d_idx = entity_manager_object_index(d);
+  TEST_ASSERT_EQUAL_UINT32(1, d_idx);
+  TEST_ASSERT_EQUAL_FLOAT(4.0f, od->position_orientation.position_x[HOT_IDX(d_idx)]);
+  TEST_ASSERT_EQUAL_UINT32(2, od->parts_start_idx[d_idx]);
+  TEST_ASSERT_EQUAL_FLOAT(42.0f, pd->local_offset_x[2]);
+  TEST_ASSERT_EQUAL_UINT32(d._, pd->parent_id[2]._);
+  TEST_ASSERT_EQUAL_UINT32(d_idx, pd->parent_index[2]);
+  TEST_ASSERT_EQUAL_UINT32(0, pd->parent_index[1]);
+
+  // the slot is reused with a new generation, the stale handle stays dead
+  entity_id_t e = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 0);
+  TEST_ASSERT_EQUAL_UINT32(GET_SLOT(b), GET_SLOT(e));
+  TEST_ASSERT_NOT_EQUAL(b._, e._);
+  TEST_ASSERT_FALSE(entity_manager_is_alive(b));
+  TEST_ASSERT_TRUE(entity_manager_is_alive(e));
+}
+
+// Test: spawn and despawn keep the objects grouped by type and the handles pointing at the right rows
+void entity_test__objects_grouped_by_type(void) {
+  struct objects_data* od = entity_manager_get_objects();
+
+  entity_id_t p0 = entity_manager_spawn_object(ENTITY_TYPEREF_PLANET, 0);
+  entity_id_t s0 = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 1);
+  entity_id_t p1 = entity_manager_spawn_object(ENTITY_TYPEREF_PLANET, 0);
+  entity_id_t s1 = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 1);
+  od->mass[HOT_IDX(entity_manager_object_index(p0))] = 10.0f;
+  od->mass[HOT_IDX(entity_manager_object_index(s1))] = 2.0f;
+
+  TEST_ASSERT_EQUAL_UINT32(0, od->type_start[ENTITY_TYPE_SHIP]);
+  TEST_ASSERT_EQUAL_UINT32(2, od->type_count[ENTITY_TYPE_SHIP]);
+  TEST_ASSERT_EQUAL_UINT32(2, od->type_start[ENTITY_TYPE_PLANET]);
+  TEST_ASSERT_EQUAL_UINT32(2, od->type_count[ENTITY_TYPE_PLANET]);
+
+  entity_id_t all[] = { p0, s0, p1, s1 };
+  for (uint32_t i = 0; i < 4; i++) {
+    uint32_t idx = entity_manager_object_index(all[i]);
+    TEST_ASSERT_EQUAL_UINT32(GET_TYPE(all[i]), od->type[idx]._);
+    TEST_ASSERT_EQUAL_UINT32(all[i]._, od->handle[idx]._);
+  }
+
+  entity_manager_despawn_object(s0);
+
+  TEST_ASSERT_EQUAL_UINT32(3, od->active);
+  TEST_ASSERT_EQUAL_UINT32(1, od->type_count[ENTITY_TYPE_SHIP]);
+  TEST_ASSERT_EQUAL_UINT32(1, od->type_start[ENTITY_TYPE_PLANET]);
+  TEST_ASSERT_EQUAL_UINT32(0, entity_manager_object_index(s1));
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, od->mass[HOT_IDX(0)]);
+  for (uint32_t i = od->type_start[ENTITY_TYPE_PLANET]; i < od->active; i++) {
+    TEST_ASSERT_EQUAL_UINT32(ENTITY_TYPE_PLANET, od->type[i]._);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(10.0f, od->mass[HOT_IDX(entity_manager_object_index(p0))]);
+  TEST_ASSERT_EQUAL_UINT32(p1._, od->handle[entity_manager_object_index(p1)]._);
+}
+
+// Test: spawning past the objects or parts reservation is refused and leaves the storage as it was
+void entity_test__spawn_refused_when_full(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  struct parts_data* pd = entity_manager_get_parts();
+
+  TEST_ASSERT_FALSE(is_valid_id(entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, PARTS_MAX_CAPACITY + 1)));
+  TEST_ASSERT_EQUAL_UINT32(0, od->active);
+  TEST_ASSERT_EQUAL_UINT32(0, pd->active);
+
+  uint32_t spawned = 0;
+  while (is_valid_id(entity_manager_spawn_object(ENTITY_TYPEREF_PLANET, 0))) {
+    spawned++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(OBJECTS_MAX_CAPACITY, spawned);
+  TEST_ASSERT_EQUAL_UINT32(OBJECTS_MAX_CAPACITY, od->active);
+  TEST_ASSERT_EQUAL_UINT32(OBJECTS_MAX_CAPACITY, od->type_count[ENTITY_TYPE_PLANET]);
+}
+
+#endif
@@ -6,10 +6,32 @@
 #include "core/core.h"
 #include "messaging/messaging.h"
 
+// address space reserved per storage, pages are committed as the storage grows (see core/columns.h)
+#define OBJECTS_MAX_CAPACITY ENTITY_SLOT_MASK // slot 0xFFFF is reserved for TYPE_BROADCAST
+#define PARTS_MAX_CAPACITY (1 << 18)
+#define PARTICLES_MAX_CAPACITY (1 << 20)
+
+// Objects keep the columns touched every tick (transform, velocity, acceleration, thrust, mass) in a hot block and
+// the rest in a cold one. By default the hot block is plain SoA; build with OBJECTS_AOSOA to interleave the hot
+// columns in tiles of 8 objects (AoSoA). Hot columns are always indexed through HOT_IDX, SIMD loops over them
+// step by OBJECTS_HOT_STRIDE from one tile to the next.
+#define OBJECTS_HOT_COLUMNS 11
+
+#ifdef OBJECTS_AOSOA
+#define OBJECTS_HOT_STRIDE (8 * OBJECTS_HOT_COLUMNS)
+#else
+#define OBJECTS_HOT_STRIDE 8
+#endif
+
+#define HOT_IDX(i) tiled_index(OBJECTS_HOT_STRIDE, (uint32_t)(i))
+
 struct objects_data {
   uint32_t active;
   uint32_t capacity;
 
+  // hot
+  position_orientation_t position_orientation;
+
   float* __restrict velocity_x;
   float* __restrict velocity_y;
 
@@ -17,23 +39,35 @@ struct objects_data {
   float* __restrict acceleration_y;
 
   float* __restrict thrust;
-  entity_type_t* __restrict type;
+  float* __restrict mass;
 
-  position_orientation_t position_orientation;
+  // cold
+  entity_type_t* __restrict type;
 
   uint32_t* __restrict parts_start_idx;
   uint32_t* __restrict parts_count;
 
   uint16_t* __restrict model_idx;
 
-  float* __restrict mass;
+  entity_id_t* __restrict handle; // dense index -> handle, follows the object when it moves
+
+  // objects are kept grouped by type, [type_start[t], type_start[t] + type_count[t]) holds the objects of type t
+  uint32_t type_start[ENTITY_TYPE_COUNT];
+  uint32_t type_count[ENTITY_TYPE_COUNT];
 };
 
 struct parts_data {
   uint32_t active;
   uint32_t capacity;
+  uint32_t levels; // deepest mount level in use, 0 while every part sits directly on its object
 
   entity_id_t* parent_id;
+  uint32_t* parent_index; // dense index of the parent object, follows it when it relocates
+
+  // parts mounted on parts: level n hangs on part (i - parent_part_offset[i]) of level n - 1 in the same block,
+  // offsets are relative to the block so they survive block moves; level 0 parts have offset 0
+  uint32_t* parent_part_offset;
+  uint8_t* level;
   entity_type_t* type;
 
   float* local_offset_x;
@@ -41,13 +75,15 @@ struct parts_data {
   float* local_orientation_x;
   float* local_orientation_y;
 
-  struct _128bytes* data;
+  uint32_t* component_idx; // row in the component table of the part's type, PART_NO_COMPONENT if it has none
 
   position_orientation_t world_position_orientation;
 
   uint16_t* model_idx;
 };
 
+#define PART_NO_COMPONENT ((uint32_t)-1)
+
 struct _128bytes {
   uint8_t data[128];
 };
@@ -55,6 +91,7 @@ struct _128bytes {
 struct particles_data {
   uint32_t active;
   uint32_t capacity;
+  uint32_t first; // [0, first) is retired storage (multiple of 16), always 0 unless built with PARTICLES_AGE_RING
 
   float* velocity_x;
   float* velocity_y;
@@ -69,13 +106,47 @@ struct particles_data {
 };
 
 void entity_manager_initialize(void);
+// empties the world (objects, parts, particles, fragments, debris, engine components) without registering systems
+// again or loading a map
+void entity_manager_clear(void);
 struct particles_data* entity_manager_get_particles(void);
 struct objects_data* entity_manager_get_objects(void);
 struct parts_data* entity_manager_get_parts(void);
 
+// capacity is what is committed right now, objects & parts grow in spawn; particles stop growing at
+// PARTICLES_MAX_CAPACITY, so check the capacity after reserving
+void entity_manager_reserve_particles(uint32_t count);
+
 void entity_manager_get_vectors(entity_id_t entity_id, float* pos, float* vel);
 
-void entity_manager_pack_particles(void);
+// removes dead particles keeping the survivors in order, alive_masks holds one bit per particle (8 per byte,
+// bit i of byte k = particle 8k + i) as left in particles_data.temporary by the ttl pass
+void entity_manager_pack_particles(const uint8_t* alive_masks);
+
+// PARTICLES_AGE_RING builds don't pack: particles stay in spawn order, grouped into age buckets that retire as a
+// whole once their longest-lived particle expired. Particles dying before that (shorter ttl, collisions) become
+// tombstones: lifetime_max = 0, model 0xFFFF, parked outside the world, fragment slot returned. Takes the same
+// masks as the pack.
+void entity_manager_retire_particles(const uint8_t* alive_masks);
 
 void entity_manager_dispatch_message(entity_id_t recipient_id, message_t msg);
-entity_id_t entity_manager_resolve_object(uint32_t ordinal);
+entity_id_t entity_manager_resolve_object(uint32_t ordinal); // dense index -> handle
+
+// Objects are addressed by generational handles, the dense index may change on every despawn.
+// spawn reserves a parts block (packed, no padding) and fills defaults, the caller sets model, mass, transform & parts.
+// despawn swap-removes the object and closes the hole in the parts storage; part ids (PART_ID_WITH_TYPE)
+// are dense part indices and don't survive a despawn. Spawn returns INVALID_ENTITY once the objects or parts
+// storage is full.
+entity_id_t entity_manager_spawn_object(entity_type_t type, uint32_t parts_count);
+// mounts a part on an earlier part of the same block (blocks are filled parents first), its local offset and
+// orientation become relative to that part
+void entity_manager_mount_part(uint32_t part_idx, uint32_t parent_part_idx);
+void entity_manager_despawn_object(entity_id_t id);
+bool entity_manager_is_alive(entity_id_t id);
+uint32_t entity_manager_object_index(entity_id_t id); // handle -> dense index, the object must be alive
+
+// World snapshots (snapshot/snapshot.h), objects, parts, particles and handles are restored at the same dense
+// indices and slots, so handles, part ids and component part_idx saved elsewhere stay valid.
+struct snapshot;
+void entity_manager_snapshot_save(struct snapshot* snapshot);
+bool entity_manager_snapshot_load(struct snapshot* snapshot);
@@ -5,6 +5,10 @@
 typedef struct {
   // dispatch requires type already known
   void (*dispatch_message)(entity_id_t id, message_t msg);
+
+  // part types with a component table, called by the entity manager when parts move or go away; NULL for the rest
+  void (*part_moved)(uint32_t component_idx, uint32_t part_idx);
+  void (*part_released)(uint32_t component_idx);
 } object_vtable_t;
 
 extern object_vtable_t entity_manager_vtables[];
@@ -1,9 +1,10 @@
 #include "fracture.h"
 #include "entity.h"
-#include "particles.h"
+#include "debris.h"
 #include "platform/platform.h"
 #include "platform/math.h"
 #include "debug/profiler.h"
+#include "snapshot/snapshot.h"
 
 #include <Windows.h>
 #include <gl/GL.h>
@@ -14,8 +15,8 @@
 // Include generated metadata
 #include "../generated/models_meta.gen.h"
 
-// Static fragment pool - no malloc
-static FragmentPool _fragment_pool;
+// Static fragment arena - no malloc
+static FragmentArena _fragment_arena;
 
 // Temp buffer for expanded segments during fracture (SoA for SIMD)
 typedef struct {
@@ -31,51 +32,149 @@ typedef struct {
 
 static SegmentBuffer _segment_buffer;
 
+// One precomputed way to break a model, fragment vertices in model space like the pool's
+typedef struct {
+    __declspec(align(32)) int8_t vertices[8][FRAGMENT_MAX_VERTICES * 2];
+    uint8_t vertex_counts[8];
+    float centroid_x[8];
+    float centroid_y[8];
+    uint8_t count;
+} FractureVariant;
+
+static FractureVariant _fracture_cache[MODEL_COUNT][FRACTURE_VARIANTS];
+static bool _fracture_cache_built = false;
+
 // ============================================================================
 // Fragment Pool Management
 // ============================================================================
 
 void fragment_pool_initialize(void) {
-    memset(&_fragment_pool, 0, sizeof(_fragment_pool));
+    memset(&_fragment_arena, 0, sizeof(_fragment_arena));
+}
+
+void fragment_pool_snapshot_save(struct snapshot* snapshot) {
+    snapshot_write(snapshot, SNAPSHOT_SECTION_FRAGMENTS, &_fragment_arena, sizeof(_fragment_arena));
+}
+
+bool fragment_pool_snapshot_load(struct snapshot* snapshot) {
+    size_t size;
+    const void* arena = snapshot_read(snapshot, SNAPSHOT_SECTION_FRAGMENTS, &size);
+    if (arena == NULL || size != sizeof(_fragment_arena)) return false;
+
+    platform_copy_memory(&_fragment_arena, arena, sizeof(_fragment_arena));
+    return true;
+}
+
+// The target is 32-bit, no _tzcnt_u64
+static uint32_t _tzcnt64(uint64_t value) {
+    uint32_t low = (uint32_t)value;
+    return low != 0 ? _tzcnt_u32(low) : 32 + _tzcnt_u32((uint32_t)(value >> 32));
+}
+
+static bool _slot_used(int pool_idx) {
+    return (_fragment_arena.slots_used[pool_idx >> 6] >> (pool_idx & 63)) & 1;
+}
+
+static uint32_t _run_chunks(uint32_t vertex_count) {
+    return (vertex_count + FRAGMENT_CHUNK_VERTICES - 1) / FRAGMENT_CHUNK_VERTICES;
 }
 
 int fragment_pool_alloc(void) {
-    // Find first free slot using trailing zero count
-    uint32_t free_mask = ~_fragment_pool.active_mask;
-    if (free_mask == 0) return -1;  // Pool is full
+    // First word with a free slot from the summary, first free slot in it
+    uint64_t open_words = ~_fragment_arena.slots_full;
+    if (open_words == 0) return -1;  // Arena is full
+
+    uint32_t word = _tzcnt64(open_words);
+    uint32_t bit = _tzcnt64(~_fragment_arena.slots_used[word]);
 
-    int idx = (int)_tzcnt_u32(free_mask);
-    if (idx >= FRAGMENT_POOL_SIZE) return -1;
+    _fragment_arena.slots_used[word] |= 1ull << bit;
+    if (_fragment_arena.slots_used[word] == ~0ull) {
+        _fragment_arena.slots_full |= 1ull << word;
+    }
 
-    _fragment_pool.active_mask |= (1u << idx);
-    _fragment_pool.vertex_counts[idx] = 0;
+    int idx = (int)(word * 64 + bit);
+    _fragment_arena.vertex_counts[idx] = 0;
+    _fragment_arena.depth[idx] = 1;
     return idx;
 }
 
 void fragment_pool_free(int pool_idx) {
-    if (pool_idx < 0 || pool_idx >= FRAGMENT_POOL_SIZE) return;
-    _fragment_pool.active_mask &= ~(1u << pool_idx);
-}
+    if (pool_idx < 0 || pool_idx >= FRAGMENT_POOL_SIZE || !_slot_used(pool_idx)) return;
 
-int8_t* fragment_get_vertices(int pool_idx) {
-    if (pool_idx < 0 || pool_idx >= FRAGMENT_POOL_SIZE) return NULL;
-    return _fragment_pool.vertices[pool_idx];
+    uint32_t word = (uint32_t)pool_idx >> 6;
+    _fragment_arena.slots_used[word] &= ~(1ull << (pool_idx & 63));
+    _fragment_arena.slots_full &= ~(1ull << word);
+
+    uint32_t chunks = _run_chunks(_fragment_arena.vertex_counts[pool_idx]);
+    if (chunks == 0) return;
+
+    // runs never straddle a word
+    uint32_t first = _fragment_arena.first_chunk[pool_idx];
+    uint32_t chunk_word = first >> 6;
+    _fragment_arena.chunks_used[chunk_word] &= ~(((1ull << chunks) - 1) << (first & 63));
+    _fragment_arena.chunks_full &= ~(1ull << chunk_word);
+    _fragment_arena.vertex_counts[pool_idx] = 0;
 }
 
-void fragment_set_vertex_count(int pool_idx, uint8_t count) {
-    if (pool_idx < 0 || pool_idx >= FRAGMENT_POOL_SIZE) return;
-    _fragment_pool.vertex_counts[pool_idx] = count;
+int8_t* fragment_reserve_vertices(int pool_idx, uint32_t vertex_count) {
+    if (pool_idx < 0 || pool_idx >= FRAGMENT_POOL_SIZE || !_slot_used(pool_idx)) return NULL;
+    if (_fragment_arena.vertex_counts[pool_idx] != 0) return NULL;
+    if (vertex_count == 0 || vertex_count > FRAGMENT_MAX_VERTICES) return NULL;
+
+    uint32_t chunks = _run_chunks(vertex_count);
+
+    // Words that aren't full from the summary; in each, bit p of starts survives only if chunks p..p+chunks-1
+    // are all free
+    uint64_t open_words = ~_fragment_arena.chunks_full;
+    while (open_words != 0) {
+        uint32_t word = _tzcnt64(open_words);
+        open_words &= open_words - 1;
+
+        uint64_t free_chunks = ~_fragment_arena.chunks_used[word];
+        uint64_t starts = free_chunks;
+        for (uint32_t i = 1; i < chunks; i++) {
+            starts &= free_chunks >> i;
+        }
+        if (starts == 0) continue;
+
+        uint32_t bit = _tzcnt64(starts);
+        _fragment_arena.chunks_used[word] |= ((1ull << chunks) - 1) << bit;
+        if (_fragment_arena.chunks_used[word] == ~0ull) {
+            _fragment_arena.chunks_full |= 1ull << word;
+        }
+
+        uint32_t first = word * 64 + bit;
+        _fragment_arena.first_chunk[pool_idx] = (uint16_t)first;
+        _fragment_arena.vertex_counts[pool_idx] = (uint8_t)vertex_count;
+        return _fragment_arena.vertices[first];
+    }
+
+    return NULL;  // fragmented or full
 }
 
 void fragment_draw(color_t color, int pool_idx) {
-    if (pool_idx < 0 || pool_idx >= FRAGMENT_POOL_SIZE) return;
-    if (!(_fragment_pool.active_mask & (1u << pool_idx))) return;
-
-    uint8_t vertex_count = _fragment_pool.vertex_counts[pool_idx];
+    const int8_t* vertices;
+    uint8_t vertex_count;
+
+    if (pool_idx >= FRAGMENT_POOL_SIZE) {
+        // cached pattern: variant block of 8 fragments
+        int cached = pool_idx - FRAGMENT_POOL_SIZE;
+        if (cached >= MODEL_COUNT * FRACTURE_VARIANTS * 8) return;
+
+        const FractureVariant* variant = &(&_fracture_cache[0][0])[cached >> 3];
+        vertices = variant->vertices[cached & 7];
+        vertex_count = variant->vertex_counts[cached & 7];
+    } else {
+        if (pool_idx < 0) return;
+        if (!_slot_used(pool_idx)) return;
+
+        vertices = _fragment_arena.vertices[_fragment_arena.first_chunk[pool_idx]];
+        vertex_count = _fragment_arena.vertex_counts[pool_idx];
+    }
     if (vertex_count == 0) return;
 
     glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(2, GL_BYTE, 0, _fragment_pool.vertices[pool_idx]);
+    glVertexPointer(2, GL_BYTE, 0, vertices);
     glColor4ubv((GLubyte*)&color);
     glLineWidth(2.0f);
     glDrawArrays(GL_LINES, 0, vertex_count);
@@ -91,11 +190,23 @@ typedef struct {
     float a, b, c;
 } CutLine;
 
+// xorshift on a caller-owned state, the cache builds reproducible patterns without touching the game's rng
+static float _cut_randf(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return (float)(*state % 10000) / 10000.0f;
+}
+
+static float _cut_randf_symmetric(uint32_t* state) {
+    return _cut_randf(state) * 2.0f - 1.0f;
+}
+
 // Generate random cut lines through bounding box
 static int _generate_cut_lines(float min_x, float min_y, float max_x, float max_y,
-                               CutLine* cuts, int max_cuts) {
-    // Use randf() for random count (2-4 cuts)
-    int num_cuts = 2 + (int)(randf() * 3.0f);
+                               CutLine* cuts, int max_cuts, uint32_t* random) {
+    // Random count (2-4 cuts)
+    int num_cuts = 2 + (int)(_cut_randf(random) * 3.0f);
     if (num_cuts > max_cuts) num_cuts = max_cuts;
 
     float cx = (min_x + max_x) * 0.5f;
@@ -103,17 +214,17 @@ static int _generate_cut_lines(float min_x, float min_y, float max_x, float max_
 
     // Spread cuts evenly around the circle with some randomness
     // Use degrees for LUT functions (0-360)
-    int base_angle_deg = (int)(randf() * 360.0f);
+    int base_angle_deg = (int)(_cut_randf(random) * 360.0f);
     int angle_step_deg = 360 / num_cuts;
 
     for (int i = 0; i < num_cuts; i++) {
         // Angle with jitter for variation
-        int angle_deg = base_angle_deg + angle_step_deg * i + (int)(randf_symmetric() * 17.0f);
+        int angle_deg = base_angle_deg + angle_step_deg * i + (int)(_cut_randf_symmetric(random) * 17.0f);
         float a = lut_cos(angle_deg);
         float b = lut_sin(angle_deg);
 
         // Small offset from center to ensure cuts go through the model
-        float offset = randf_symmetric() * 5.0f;
+        float offset = _cut_randf_symmetric(random) * 5.0f;
         float c = -(a * cx + b * cy + offset);
 
         cuts[i].a = a;
@@ -168,6 +279,23 @@ static void _expand_to_segments(const int8_t* vertices, const DrawCommand* comma
     }
 }
 
+// Expand GL_LINES pairs (fragment geometry) into individual segments
+static void _expand_lines_to_segments(const int8_t* vertices, int vertex_count, SegmentBuffer* buf) {
+    buf->count = 0;
+
+    for (int i = 0; i + 1 < vertex_count && buf->count < 256; i += 2) {
+        int idx = buf->count;
+        buf->x1[idx] = (float)vertices[i * 2];
+        buf->y1[idx] = (float)vertices[i * 2 + 1];
+        buf->x2[idx] = (float)vertices[i * 2 + 2];
+        buf->y2[idx] = (float)vertices[i * 2 + 3];
+        buf->region[idx] = 0;
+        buf->cut_at_p1[idx] = 0;  // earlier break lines are plain segments now
+        buf->cut_at_p2[idx] = 0;
+        buf->count++;
+    }
+}
+
 // SIMD: Test 8 segments against 1 cut line, split intersecting segments
 // Returns number of new segments added
 static int _simd_cut_segments(SegmentBuffer* buf, const CutLine* cut, int start_idx, int count) {
@@ -306,13 +434,87 @@ static void _simd_classify_regions(SegmentBuffer* buf, const CutLine* cuts, int
     }
 }
 
-// Pack segments by region into fragment pool slots
-static int _pack_fragments(SegmentBuffer* buf, FractureResult* result) {
-    // Count unique regions
+// Regions present in the buffer (bit r = region r)
+static uint32_t _region_mask(const SegmentBuffer* buf) {
     uint32_t region_mask = 0;
     for (int i = 0; i < buf->count; i++) {
         region_mask |= (1u << buf->region[i]);
     }
+    return region_mask;
+}
+
+// Pack the segments of one region as GL_LINES pairs into verts, returns the vertex count (0 = empty region)
+static int _pack_region(const SegmentBuffer* buf, int r, int8_t* verts, float* centroid_x, float* centroid_y) {
+    int vert_count = 0;
+    float sum_x = 0, sum_y = 0;
+    int point_count = 0;
+
+    // Pack all segments in this region as GL_LINES pairs
+    // Also add short perpendicular "break" lines at cut points
+    for (int i = 0; i < buf->count && vert_count < FRAGMENT_MAX_VERTICES - 6; i++) {
+        if (buf->region[i] != r) continue;
+
+        float fx1 = buf->x1[i];
+        float fy1 = buf->y1[i];
+        float fx2 = buf->x2[i];
+        float fy2 = buf->y2[i];
+
+        int8_t x1 = (int8_t)fx1;
+        int8_t y1 = (int8_t)fy1;
+        int8_t x2 = (int8_t)fx2;
+        int8_t y2 = (int8_t)fy2;
+
+        // Add the main segment
+        verts[vert_count * 2] = x1;
+        verts[vert_count * 2 + 1] = y1;
+        verts[vert_count * 2 + 2] = x2;
+        verts[vert_count * 2 + 3] = y2;
+        vert_count += 2;
+
+        // Compute perpendicular direction for break lines
+        float dx = fx2 - fx1;
+        float dy = fy2 - fy1;
+        float len = dx * dx + dy * dy;
+        if (len > 0.1f) {
+            len = 1.0f / (len > 1.0f ? len : 1.0f);  // approx normalize
+            float px = -dy * 3.0f * len;  // perpendicular, length ~3
+            float py = dx * 3.0f * len;
+
+            // Add break line at p1 if it was cut
+            if (buf->cut_at_p1[i] && vert_count < FRAGMENT_MAX_VERTICES - 2) {
+                verts[vert_count * 2] = (int8_t)(fx1 - px);
+                verts[vert_count * 2 + 1] = (int8_t)(fy1 - py);
+                verts[vert_count * 2 + 2] = (int8_t)(fx1 + px);
+                verts[vert_count * 2 + 3] = (int8_t)(fy1 + py);
+                vert_count += 2;
+            }
+
+            // Add break line at p2 if it was cut
+            if (buf->cut_at_p2[i] && vert_count < FRAGMENT_MAX_VERTICES - 2) {
+                verts[vert_count * 2] = (int8_t)(fx2 - px);
+                verts[vert_count * 2 + 1] = (int8_t)(fy2 - py);
+                verts[vert_count * 2 + 2] = (int8_t)(fx2 + px);
+                verts[vert_count * 2 + 3] = (int8_t)(fy2 + py);
+                vert_count += 2;
+            }
+        }
+
+        // Accumulate for centroid
+        sum_x += fx1 + fx2;
+        sum_y += fy1 + fy2;
+        point_count += 2;
+    }
+
+    // Compute centroid
+    *centroid_x = (point_count > 0) ? sum_x / (float)point_count : 0;
+    *centroid_y = (point_count > 0) ? sum_y / (float)point_count : 0;
+    return vert_count;
+}
+
+// Pack segments by region into fragment arena slots, each with a vertex run of its own length
+static int _pack_fragments(SegmentBuffer* buf, uint8_t depth, FractureResult* result) {
+    uint32_t region_mask = _region_mask(buf);
+    __declspec(align(32)) int8_t packed[FRAGMENT_MAX_VERTICES * 2];
 
     result->count = 0;
 
@@ -320,128 +522,72 @@ static int _pack_fragments(SegmentBuffer* buf, FractureResult* result) {
     for (int r = 0; r < 16 && result->count < 8; r++) {
         if (!(region_mask & (1u << r))) continue;
 
-        // Allocate pool slot
+        int idx = result->count;
+        int vert_count = _pack_region(buf, r, packed, &result->centroid_x[idx], &result->centroid_y[idx]);
+        if (vert_count == 0) continue;
+
+        // Allocate a slot and its run
         int pool_idx = fragment_pool_alloc();
         if (pool_idx < 0) break;
 
-        int8_t* verts = _fragment_pool.vertices[pool_idx];
-        int vert_count = 0;
-        float sum_x = 0, sum_y = 0;
-        int point_count = 0;
-
-        // Pack all segments in this region as GL_LINES pairs
-        // Also add short perpendicular "break" lines at cut points
-        for (int i = 0; i < buf->count && vert_count < FRAGMENT_MAX_VERTICES - 6; i++) {
-            if (buf->region[i] != r) continue;
-
-            float fx1 = buf->x1[i];
-            float fy1 = buf->y1[i];
-            float fx2 = buf->x2[i];
-            float fy2 = buf->y2[i];
-
-            int8_t x1 = (int8_t)fx1;
-            int8_t y1 = (int8_t)fy1;
-            int8_t x2 = (int8_t)fx2;
-            int8_t y2 = (int8_t)fy2;
-
-            // Add the main segment
-            verts[vert_count * 2] = x1;
-            verts[vert_count * 2 + 1] = y1;
-            verts[vert_count * 2 + 2] = x2;
-            verts[vert_count * 2 + 3] = y2;
-            vert_count += 2;
-
-            // Compute perpendicular direction for break lines
-            float dx = fx2 - fx1;
-            float dy = fy2 - fy1;
-            float len = dx * dx + dy * dy;
-            if (len > 0.1f) {
-                len = 1.0f / (len > 1.0f ? len : 1.0f);  // approx normalize
-                float px = -dy * 3.0f * len;  // perpendicular, length ~3
-                float py = dx * 3.0f * len;
-
-                // Add break line at p1 if it was cut
-                if (buf->cut_at_p1[i] && vert_count < FRAGMENT_MAX_VERTICES - 2) {
-                    verts[vert_count * 2] = (int8_t)(fx1 - px);
-                    verts[vert_count * 2 + 1] = (int8_t)(fy1 - py);
-                    verts[vert_count * 2 + 2] = (int8_t)(fx1 + px);
-                    verts[vert_count * 2 + 3] = (int8_t)(fy1 + py);
-                    vert_count += 2;
-                }
-
-                // Add break line at p2 if it was cut
-                if (buf->cut_at_p2[i] && vert_count < FRAGMENT_MAX_VERTICES - 2) {
-                    verts[vert_count * 2] = (int8_t)(fx2 - px);
-                    verts[vert_count * 2 + 1] = (int8_t)(fy2 - py);
-                    verts[vert_count * 2 + 2] = (int8_t)(fx2 + px);
-                    verts[vert_count * 2 + 3] = (int8_t)(fy2 + py);
-                    vert_count += 2;
-                }
-            }
-
-            // Accumulate for centroid
-            sum_x += fx1 + fx2;
-            sum_y += fy1 + fy2;
-            point_count += 2;
-        }
-
-        if (vert_count == 0) {
+        int8_t* verts = fragment_reserve_vertices(pool_idx, (uint32_t)vert_count);
+        if (verts == NULL) {
             fragment_pool_free(pool_idx);
-            continue;
+            break;
         }
-
-        _fragment_pool.vertex_counts[pool_idx] = (uint8_t)vert_count;
-
-        // Compute centroid
-        float centroid_x = (point_count > 0) ? sum_x / point_count : 0;
-        float centroid_y = (point_count > 0) ? sum_y / point_count : 0;
+        platform_copy_memory(verts, packed, (size_t)vert_count * 2);
+        _fragment_arena.depth[pool_idx] = depth;
 
         // Store result
-        int idx = result->count;
-        result->pool_indices[idx] = (uint8_t)pool_idx;
-        result->centroid_x[idx] = centroid_x;
-        result->centroid_y[idx] = centroid_y;
+        result->pool_indices[idx] = (uint16_t)pool_idx;
         result->count++;
     }
 
     return result->count;
 }
 
-int fracture_model(uint16_t model_idx, FractureResult* result) {
-    PROFILE_ZONE("fracture_model");
-
-    result->count = 0;
+// Pack segments by region into a cache variant, same layout as the pool minus the slot allocation
+static void _pack_variant(const SegmentBuffer* buf, FractureVariant* variant) {
+    uint32_t region_mask = _region_mask(buf);
 
-    // Get model data from generated metadata
-    const int8_t* vertices = _model_vertices[model_idx];
-    const DrawCommand* commands = _model_commands[model_idx];
-    int command_count = _model_command_counts[model_idx];
+    variant->count = 0;
+    for (int r = 0; r < 16 && variant->count < 8; r++) {
+        if (!(region_mask & (1u << r))) continue;
 
-    // Expand all line strips/loops to individual segments
-    _expand_to_segments(vertices, commands, command_count, &_segment_buffer);
+        int idx = variant->count;
+        int vert_count = _pack_region(buf, r, variant->vertices[idx], &variant->centroid_x[idx],
+                                      &variant->centroid_y[idx]);
+        if (vert_count == 0) continue;
 
-    if (_segment_buffer.count == 0) {
-        PROFILE_ZONE_END();
-        return 0;
+        variant->vertex_counts[idx] = (uint8_t)vert_count;
+        variant->count++;
     }
+}
 
-    // Compute bounding box
-    float min_x = _segment_buffer.x1[0], max_x = _segment_buffer.x1[0];
-    float min_y = _segment_buffer.y1[0], max_y = _segment_buffer.y1[0];
-    for (int i = 0; i < _segment_buffer.count; i++) {
-        if (_segment_buffer.x1[i] < min_x) min_x = _segment_buffer.x1[i];
-        if (_segment_buffer.x2[i] < min_x) min_x = _segment_buffer.x2[i];
-        if (_segment_buffer.x1[i] > max_x) max_x = _segment_buffer.x1[i];
-        if (_segment_buffer.x2[i] > max_x) max_x = _segment_buffer.x2[i];
-        if (_segment_buffer.y1[i] < min_y) min_y = _segment_buffer.y1[i];
-        if (_segment_buffer.y2[i] < min_y) min_y = _segment_buffer.y2[i];
-        if (_segment_buffer.y1[i] > max_y) max_y = _segment_buffer.y1[i];
-        if (_segment_buffer.y2[i] > max_y) max_y = _segment_buffer.y2[i];
+// Bounding box of the expanded segments
+static void _segment_bounds(const SegmentBuffer* buf, float* min_x, float* min_y, float* max_x, float* max_y) {
+    *min_x = *max_x = buf->x1[0];
+    *min_y = *max_y = buf->y1[0];
+    for (int i = 0; i < buf->count; i++) {
+        if (buf->x1[i] < *min_x) *min_x = buf->x1[i];
+        if (buf->x2[i] < *min_x) *min_x = buf->x2[i];
+        if (buf->x1[i] > *max_x) *max_x = buf->x1[i];
+        if (buf->x2[i] > *max_x) *max_x = buf->x2[i];
+        if (buf->y1[i] < *min_y) *min_y = buf->y1[i];
+        if (buf->y2[i] < *min_y) *min_y = buf->y2[i];
+        if (buf->y1[i] > *max_y) *max_y = buf->y1[i];
+        if (buf->y2[i] > *max_y) *max_y = buf->y2[i];
     }
+}
+
+// Cut and classify the expanded segments in _segment_buffer, returns the segment count
+static int _cut_segments(uint32_t* random) {
+    float min_x, min_y, max_x, max_y;
+    _segment_bounds(&_segment_buffer, &min_x, &min_y, &max_x, &max_y);
 
     // Generate random cut lines
     CutLine cuts[4];
-    int num_cuts = _generate_cut_lines(min_x, min_y, max_x, max_y, cuts, 4);
+    int num_cuts = _generate_cut_lines(min_x, min_y, max_x, max_y, cuts, 4, random);
 
     // Apply each cut line, splitting segments that cross it
     for (int c = 0; c < num_cuts; c++) {
@@ -453,126 +599,542 @@ int fracture_model(uint16_t model_idx, FractureResult* result) {
     // Classify all segments by region (which side of each cut line)
     _simd_classify_regions(&_segment_buffer, cuts, num_cuts);
 
+    return _segment_buffer.count;
+}
+
+// Expand, cut and classify a model into _segment_buffer, returns the segment count (0 = nothing to break)
+static int _fracture_segments(uint16_t model_idx, uint32_t* random) {
+    // Get model data from generated metadata
+    const int8_t* vertices = _model_vertices[model_idx];
+    const DrawCommand* commands = _model_commands[model_idx];
+    int command_count = _model_command_counts[model_idx];
+
+    // Expand all line strips/loops to individual segments
+    _expand_to_segments(vertices, commands, command_count, &_segment_buffer);
+
+    if (_segment_buffer.count == 0) {
+        return 0;
+    }
+
+    return _cut_segments(random);
+}
+
+int fracture_model(uint16_t model_idx, FractureResult* result) {
+    PROFILE_ZONE("fracture_model");
+
+    result->count = 0;
+
+    uint32_t random = rand32() | 1u;
+    if (_fracture_segments(model_idx, &random) == 0) {
+        PROFILE_ZONE_END();
+        return 0;
+    }
+
     // Pack segments into fragment pool slots
-    int fragments = _pack_fragments(&_segment_buffer, result);
+    int fragments = _pack_fragments(&_segment_buffer, 1, result);
 
     PROFILE_ZONE_END();
     return fragments;
 }
 
+// Geometry of a fragment model index, NULL for static models and free slots
+static const int8_t* _fragment_geometry(uint16_t model_idx, uint32_t* vertex_count, uint32_t* depth) {
+    if (model_idx < FRAGMENT_MODEL_BASE) return NULL;
+
+    int pool_idx = model_idx - FRAGMENT_MODEL_BASE;
+    if (pool_idx >= FRAGMENT_POOL_SIZE) {
+        int cached = pool_idx - FRAGMENT_POOL_SIZE;
+        if (cached >= MODEL_COUNT * FRACTURE_VARIANTS * 8) return NULL;
+
+        const FractureVariant* variant = &(&_fracture_cache[0][0])[cached >> 3];
+        *vertex_count = variant->vertex_counts[cached & 7];
+        *depth = 1;
+        return variant->vertices[cached & 7];
+    }
+
+    if (!_slot_used(pool_idx)) return NULL;
+    *vertex_count = _fragment_arena.vertex_counts[pool_idx];
+    *depth = _fragment_arena.depth[pool_idx];
+    return _fragment_arena.vertices[_fragment_arena.first_chunk[pool_idx]];
+}
+
+const int8_t* fragment_lines(uint16_t model_idx, uint32_t* vertex_count) {
+    uint32_t depth;
+    return _fragment_geometry(model_idx, vertex_count, &depth);
+}
+
+const int8_t* fragment_arena_vertices(uint32_t* size) {
+    *size = (uint32_t)sizeof(_fragment_arena.vertices);
+    return &_fragment_arena.vertices[0][0];
+}
+
+const int8_t* fracture_cache_vertices(uint32_t* size) {
+    *size = (uint32_t)sizeof(_fracture_cache);
+    return (const int8_t*)_fracture_cache;
+}
+
+// Fracture debris geometry again into arena slots, the pieces stay in the parent's model space
+// Returns 0 when the fragment is too deep or too small to break (or the arena is out of room)
+static int _fracture_fragment(uint16_t model_idx, FractureResult* result, float* parent_cx, float* parent_cy) {
+    result->count = 0;
+
+    uint32_t vertex_count, depth;
+    const int8_t* vertices = _fragment_geometry(model_idx, &vertex_count, &depth);
+    if (vertices == NULL || depth >= FRACTURE_MAX_DEPTH) return 0;
+
+    _expand_lines_to_segments(vertices, (int)vertex_count, &_segment_buffer);
+    if (_segment_buffer.count == 0) return 0;
+
+    float min_x, min_y, max_x, max_y;
+    _segment_bounds(&_segment_buffer, &min_x, &min_y, &max_x, &max_y);
+    if (max_x - min_x < FRACTURE_MIN_SIZE && max_y - min_y < FRACTURE_MIN_SIZE) return 0;
+
+    // Centroid the same way _pack_region computes the pieces'
+    float sum_x = 0, sum_y = 0;
+    for (int i = 0; i < _segment_buffer.count; i++) {
+        sum_x += _segment_buffer.x1[i] + _segment_buffer.x2[i];
+        sum_y += _segment_buffer.y1[i] + _segment_buffer.y2[i];
+    }
+    *parent_cx = sum_x / (float)(_segment_buffer.count * 2);
+    *parent_cy = sum_y / (float)(_segment_buffer.count * 2);
+
+    uint32_t random = rand32() | 1u;
+    _cut_segments(&random);
+    return _pack_fragments(&_segment_buffer, (uint8_t)(depth + 1), result);
+}
+
+// ============================================================================
+// Fracture Pattern Cache
+// ============================================================================
+
+void fracture_cache_initialize(void) {
+    if (_fracture_cache_built) return;
+    PROFILE_ZONE("fracture_cache_initialize");
+
+    for (uint16_t model = 0; model < MODEL_COUNT; model++) {
+        for (uint32_t variant = 0; variant < FRACTURE_VARIANTS; variant++) {
+            // fixed per pattern, the same build always produces the same cache (snapshots rely on it)
+            uint32_t random = 0x9E3779B9u * (model * FRACTURE_VARIANTS + variant + 1);
+            FractureVariant* target = &_fracture_cache[model][variant];
+
+            if (_fracture_segments(model, &random) == 0) {
+                target->count = 0;
+                continue;
+            }
+            _pack_variant(&_segment_buffer, target);
+        }
+    }
+
+    _fracture_cache_built = true;
+    PROFILE_ZONE_END();
+}
+
 // ============================================================================
 // Explode Entity API
 // ============================================================================
 
-int explode_entity(uint32_t object_idx) {
-    PROFILE_ZONE("explode_entity");
+// Debris of several entities staged one lane per fragment, groups of 8 lanes mix entities
+#define EXPLODE_BATCH_LANES 256
 
-    struct objects_data* od = entity_manager_get_objects();
+typedef struct {
+    __declspec(align(32)) float centroid_x[EXPLODE_BATCH_LANES];  // pattern space, radial direction after the pass
+    __declspec(align(32)) float centroid_y[EXPLODE_BATCH_LANES];
+    __declspec(align(32)) float ox[EXPLODE_BATCH_LANES];          // turned entity orientation
+    __declspec(align(32)) float oy[EXPLODE_BATCH_LANES];
+    __declspec(align(32)) float x[EXPLODE_BATCH_LANES];           // entity position, world position after the pass
+    __declspec(align(32)) float y[EXPLODE_BATCH_LANES];
+    __declspec(align(32)) float vx[EXPLODE_BATCH_LANES];          // entity velocity, debris velocity after the pass
+    __declspec(align(32)) float vy[EXPLODE_BATCH_LANES];
+    __declspec(align(32)) uint16_t models[EXPLODE_BATCH_LANES];
+    uint32_t count;
+
+    // launch, shared by everything staged: speed + [0, speed_range) outwards, [-spread, spread) sideways
+    float speed;
+    float speed_range;
+    float spread;
+    float radius;
+    float spin;
+    uint16_t ttl_min;
+    uint16_t ttl_range;
+} ExplodeBatch;
+
+static ExplodeBatch _explode_batch;
+
+// Transform and launch everything staged, 8 lanes at a time whatever entity they came from
+static void _explode_flush(ExplodeBatch* batch) {
+    if (batch->count == 0) return;
+
+    // padding lanes are emitted dead, they only have to stay finite
+    uint32_t padded = (batch->count + 7) & ~7u;
+    for (uint32_t i = batch->count; i < padded; i++) {
+        batch->centroid_x[i] = batch->centroid_y[i] = 0.0f;
+        batch->ox[i] = 1.0f;
+        batch->oy[i] = 0.0f;
+        batch->x[i] = batch->y[i] = batch->vx[i] = batch->vy[i] = 0.0f;
+        batch->models[i] = 0;
+    }
 
-    if (object_idx >= od->active) {
-        PROFILE_ZONE_END();
-        return 0;
+    __m256 epsilon = _mm256_set1_ps(1.0e-6f);
+    __m256 base_speed = _mm256_set1_ps(batch->speed);
+    __m256 speed_range = _mm256_set1_ps(batch->speed_range);
+    __m256 spread = _mm256_set1_ps(batch->spread);
+
+    for (uint32_t i = 0; i < padded; i += 8) {
+        __m256 cx = _mm256_load_ps(&batch->centroid_x[i]);
+        __m256 cy = _mm256_load_ps(&batch->centroid_y[i]);
+        __m256 ox = _mm256_load_ps(&batch->ox[i]);
+        __m256 oy = _mm256_load_ps(&batch->oy[i]);
+
+        // Transform centroids: world = entity + rotate(centroid, orientation)
+        // rotate: wx = cx*ox - cy*oy, wy = cx*oy + cy*ox
+        __m256 rot_x = _mm256_sub_ps(_mm256_mul_ps(cx, ox), _mm256_mul_ps(cy, oy));
+        __m256 rot_y = _mm256_add_ps(_mm256_mul_ps(cx, oy), _mm256_mul_ps(cy, ox));
+
+        _mm256_store_ps(&batch->x[i], _mm256_add_ps(_mm256_load_ps(&batch->x[i]), rot_x));
+        _mm256_store_ps(&batch->y[i], _mm256_add_ps(_mm256_load_ps(&batch->y[i]), rot_y));
+
+        // Radial direction is the rotated centroid, normalized
+        __m256 len_sq = _mm256_add_ps(_mm256_mul_ps(rot_x, rot_x), _mm256_mul_ps(rot_y, rot_y));
+        __m256 inv_len = _mm256_rsqrt_ps(_mm256_max_ps(len_sq, epsilon));
+        __m256 rx = _mm256_mul_ps(rot_x, inv_len);
+        __m256 ry = _mm256_mul_ps(rot_y, inv_len);
+
+        // speeds = speed + rand * speed_range, spread = rand * spread
+        __m256 spd = _mm256_add_ps(base_speed, _mm256_mul_ps(randf_8(), speed_range));
+        __m256 sx = _mm256_mul_ps(randf_symmetric_8(), spread);
+        __m256 sy = _mm256_mul_ps(randf_symmetric_8(), spread);
+
+        // vx = entity_vx + radial_x * speed + spread_x
+        __m256 vx = _mm256_add_ps(_mm256_load_ps(&batch->vx[i]), _mm256_add_ps(_mm256_mul_ps(rx, spd), sx));
+        __m256 vy = _mm256_add_ps(_mm256_load_ps(&batch->vy[i]), _mm256_add_ps(_mm256_mul_ps(ry, spd), sy));
+        _mm256_store_ps(&batch->vx[i], vx);
+        _mm256_store_ps(&batch->vy[i], vy);
     }
 
-    // Get entity data
-    uint16_t model_idx = od->model_idx[object_idx];
-    float entity_x = od->position_orientation.position_x[object_idx];
-    float entity_y = od->position_orientation.position_y[object_idx];
-    float entity_vx = od->velocity_x[object_idx];
-    float entity_vy = od->velocity_y[object_idx];
-    float entity_ox = od->position_orientation.orientation_x[object_idx];
-    float entity_oy = od->position_orientation.orientation_y[object_idx];
+    // Spawn debris straight into its columns, orientation follows the turned pattern and starts spinning
+    debris_batch_t emit = {
+        .count = batch->count,
+        .x = batch->x,
+        .y = batch->y,
+        .vx = batch->vx,
+        .vy = batch->vy,
+        .ox = batch->ox,
+        .oy = batch->oy,
+        .model_idx = batch->models,
+        .radius = batch->radius,
+        .spin = batch->spin,
+        .ttl_min = batch->ttl_min,
+        .ttl_range = batch->ttl_range
+    };
+    debris_emit(&emit);
+
+    batch->count = 0;
+}
+
+// Stage the fragments of one entity's pattern, returns how many
+static int _explode_stage(ExplodeBatch* batch, const struct objects_data* od, uint32_t object_idx) {
+    if (object_idx >= od->active) return 0;
 
     // Can't fracture dynamic fragments
-    if (model_idx >= FRAGMENT_MODEL_BASE) {
-        PROFILE_ZONE_END();
-        return 0;
-    }
+    uint16_t model_idx = od->model_idx[object_idx];
+    if (model_idx >= FRAGMENT_MODEL_BASE) return 0;
 
-    // Fracture the model
-    FractureResult result;
-    int num_fragments = fracture_model(model_idx, &result);
+    _ASSERT(_fracture_cache_built && model_idx < MODEL_COUNT);
 
-    if (num_fragments == 0) {
-        PROFILE_ZONE_END();
-        return 0;
+    // Pick a precomputed pattern, no cutting at explosion time
+    uint32_t variant = rand32() % FRACTURE_VARIANTS;
+    const FractureVariant* pattern = &_fracture_cache[model_idx][variant];
+    int num_fragments = pattern->count;
+    if (num_fragments == 0) return 0;
+
+    if (batch->count + (uint32_t)num_fragments > EXPLODE_BATCH_LANES) {
+        _explode_flush(batch);
     }
 
-    // Batch compute world positions and velocities using SIMD
-    // Pad to 8 for SIMD alignment
-    __declspec(align(32)) float world_x[8];
-    __declspec(align(32)) float world_y[8];
-    __declspec(align(32)) float radial_x[8];
-    __declspec(align(32)) float radial_y[8];
-    __declspec(align(32)) float vx[8];
-    __declspec(align(32)) float vy[8];
-
-    // Load entity orientation into SIMD registers
-    __m256 ox = _mm256_set1_ps(entity_ox);
-    __m256 oy = _mm256_set1_ps(entity_oy);
-    __m256 ex = _mm256_set1_ps(entity_x);
-    __m256 ey = _mm256_set1_ps(entity_y);
-    __m256 evx = _mm256_set1_ps(entity_vx);
-    __m256 evy = _mm256_set1_ps(entity_vy);
-
-    // Load centroids (pad with zeros)
-    __declspec(align(32)) float cx_pad[8] = {0};
-    __declspec(align(32)) float cy_pad[8] = {0};
+    uint32_t hot = HOT_IDX(object_idx);
+    float entity_ox = od->position_orientation.orientation_x[hot];
+    float entity_oy = od->position_orientation.orientation_y[hot];
+
+    // Turn the whole pattern by a random angle on top of the entity orientation, so repeated variants
+    // don't look alike
+    int32_t turn = (int32_t)(rand32() % 360);
+    float turn_cos = lut_cos(turn);
+    float turn_sin = lut_sin(turn);
+    float pattern_ox = entity_ox * turn_cos - entity_oy * turn_sin;
+    float pattern_oy = entity_ox * turn_sin + entity_oy * turn_cos;
+
+    uint32_t first_model = FRACTURE_CACHE_MODEL_BASE + (model_idx * FRACTURE_VARIANTS + variant) * 8;
     for (int i = 0; i < num_fragments; i++) {
-        cx_pad[i] = result.centroid_x[i];
-        cy_pad[i] = result.centroid_y[i];
+        uint32_t lane = batch->count++;
+        batch->centroid_x[lane] = pattern->centroid_x[i];
+        batch->centroid_y[lane] = pattern->centroid_y[i];
+        batch->ox[lane] = pattern_ox;
+        batch->oy[lane] = pattern_oy;
+        batch->x[lane] = od->position_orientation.position_x[hot];
+        batch->y[lane] = od->position_orientation.position_y[hot];
+        batch->vx[lane] = od->velocity_x[hot];
+        batch->vy[lane] = od->velocity_y[hot];
+        batch->models[lane] = (uint16_t)(first_model + (uint32_t)i);
     }
-    __m256 cx = _mm256_load_ps(cx_pad);
-    __m256 cy = _mm256_load_ps(cy_pad);
 
-    // Transform centroids: world = entity + rotate(centroid, orientation)
-    // rotate: wx = cx*ox - cy*oy, wy = cx*oy + cy*ox
-    __m256 rot_x = _mm256_sub_ps(_mm256_mul_ps(cx, ox), _mm256_mul_ps(cy, oy));
-    __m256 rot_y = _mm256_add_ps(_mm256_mul_ps(cx, oy), _mm256_mul_ps(cy, ox));
+    return num_fragments;
+}
+
+int explode_entities(const uint32_t* object_indices, uint32_t count) {
+    PROFILE_ZONE("explode_entities");
+
+    struct objects_data* od = entity_manager_get_objects();
+    int spawned = 0;
+
+    // slower, more dramatic, 90-150 ticks
+    _explode_batch.speed = 15.0f;
+    _explode_batch.speed_range = 10.0f;
+    _explode_batch.spread = 8.0f;
+    _explode_batch.radius = 6.0f;
+    _explode_batch.spin = 3.0f;
+    _explode_batch.ttl_min = 90;
+    _explode_batch.ttl_range = 60;
+
+    for (uint32_t e = 0; e < count; e++) {
+        spawned += _explode_stage(&_explode_batch, od, object_indices[e]);
+    }
+    _explode_flush(&_explode_batch);
+
+    PROFILE_ZONE_END();
+    return spawned;
+}
+
+int explode_entity(uint32_t object_idx) {
+    return explode_entities(&object_idx, 1);
+}
 
-    _mm256_store_ps(world_x, _mm256_add_ps(ex, rot_x));
-    _mm256_store_ps(world_y, _mm256_add_ps(ey, rot_y));
+// ============================================================================
+// Debris Cascades
+// ============================================================================
 
-    // Radial direction is the rotated centroid (already computed)
-    _mm256_store_ps(radial_x, rot_x);
-    _mm256_store_ps(radial_y, rot_y);
+int fracture_debris(const uint32_t* debris_indices, uint32_t count) {
+    PROFILE_ZONE("fracture_debris");
 
-    // Normalize radial directions (batch of 8)
-    vec2_normalize_i(radial_x, radial_y, 8);
+    struct debris_data* dd = debris_get();
+    int spawned = 0;
 
-    // Generate random speeds and spreads using SIMD
-    __m256 rand_spd = randf_8();           // [0, 1)
-    __m256 rand_sx = randf_symmetric_8();  // [-1, 1)
-    __m256 rand_sy = randf_symmetric_8();  // [-1, 1)
+    // pieces of pieces drift apart gently, spin faster and fade sooner, 45-75 ticks
+    _explode_batch.speed = 4.0f;
+    _explode_batch.speed_range = 4.0f;
+    _explode_batch.spread = 3.0f;
+    _explode_batch.radius = 3.0f;
+    _explode_batch.spin = 6.0f;
+    _explode_batch.ttl_min = 45;
+    _explode_batch.ttl_range = 30;
 
-    // speeds = 15 + rand * 10, spread = rand * 8 (slower, more dramatic)
-    __m256 spd = _mm256_add_ps(_mm256_set1_ps(15.0f), _mm256_mul_ps(rand_spd, _mm256_set1_ps(10.0f)));
-    __m256 sx = _mm256_mul_ps(rand_sx, _mm256_set1_ps(8.0f));
-    __m256 sy = _mm256_mul_ps(rand_sy, _mm256_set1_ps(8.0f));
+    for (uint32_t e = 0; e < count; e++) {
+        uint32_t idx = debris_indices[e];
+        if (idx >= dd->active || dd->lifetime_ticks[idx] == 0) continue;  // gone, or already broken this tick
 
-    // vx = entity_vx + radial_x * speed + spread_x
-    __m256 rx = _mm256_load_ps(radial_x);
-    __m256 ry = _mm256_load_ps(radial_y);
+        // the piece dies either way, its slot goes back in the next debris_pack
+        dd->lifetime_ticks[idx] = 0;
 
-    _mm256_store_ps(vx, _mm256_add_ps(evx, _mm256_add_ps(_mm256_mul_ps(rx, spd), sx)));
-    _mm256_store_ps(vy, _mm256_add_ps(evy, _mm256_add_ps(_mm256_mul_ps(ry, spd), sy)));
+        FractureResult result;
+        float parent_cx, parent_cy;
+        int pieces = _fracture_fragment(dd->model_idx[idx], &result, &parent_cx, &parent_cy);
+        if (pieces == 0) continue;
 
-    // Spawn particles
-    for (int i = 0; i < num_fragments; i++) {
-        particle_create_t pc = {
-            .x = world_x[i],
-            .y = world_y[i],
-            .vx = vx[i],
-            .vy = vy[i],
-            .ox = entity_ox + randf_symmetric() * 0.3f,
-            .oy = entity_oy + randf_symmetric() * 0.3f,
-            .ttl = 90 + (uint16_t)(randf() * 60.0f),
-            .model_idx = FRAGMENT_MODEL_BASE + result.pool_indices[i]
-        };
-        particles_create_particle(&pc);
+        if (_explode_batch.count + (uint32_t)pieces > EXPLODE_BATCH_LANES) {
+            _explode_flush(&_explode_batch);
+        }
+
+        // pieces are placed around the parent the way its centroid placed it, relative to the parent's centroid
+        for (int i = 0; i < pieces; i++) {
+            uint32_t lane = _explode_batch.count++;
+            _explode_batch.centroid_x[lane] = result.centroid_x[i] - parent_cx;
+            _explode_batch.centroid_y[lane] = result.centroid_y[i] - parent_cy;
+            _explode_batch.ox[lane] = dd->position_orientation.orientation_x[idx];
+            _explode_batch.oy[lane] = dd->position_orientation.orientation_y[idx];
+            _explode_batch.x[lane] = dd->position_orientation.position_x[idx];
+            _explode_batch.y[lane] = dd->position_orientation.position_y[idx];
+            _explode_batch.vx[lane] = dd->velocity_x[idx];
+            _explode_batch.vy[lane] = dd->velocity_y[idx];
+            _explode_batch.models[lane] = (uint16_t)(FRAGMENT_MODEL_BASE + result.pool_indices[i]);
+        }
+        spawned += pieces;
     }
+    _explode_flush(&_explode_batch);
 
     PROFILE_ZONE_END();
-    return num_fragments;
+    return spawned;
+}
+
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+// Test: explosions use the read-only pattern cache and leave the fragment pool alone
+void fracture_test__explode_uses_cached_patterns(void) {
+    struct objects_data* od = entity_manager_get_objects();
+    struct debris_data* debris = debris_get();
+
+    entity_id_t ship = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 0);
+    uint32_t idx = entity_manager_object_index(ship);
+    od->model_idx[idx] = 0;
+    od->position_orientation.position_x[HOT_IDX(idx)] = 50.0f;
+
+    // deterministic: building again is a no-op, every model got patterns
+    fracture_cache_initialize();
+    TEST_ASSERT_TRUE(_fracture_cache[0][0].count > 0);
+    TEST_ASSERT_TRUE(_fracture_cache[0][0].count <= 8);
+
+    int fragments = explode_entity(idx);
+    TEST_ASSERT_TRUE(fragments > 0);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)fragments, debris->active);
+    TEST_ASSERT_TRUE(_fragment_arena.slots_used[0] == 0 && _fragment_arena.chunks_used[0] == 0);
+
+    uint32_t first = debris->model_idx[0];
+    TEST_ASSERT_TRUE(first >= FRACTURE_CACHE_MODEL_BASE);
+    TEST_ASSERT_EQUAL_UINT32(0, (first - FRACTURE_CACHE_MODEL_BASE) % 8);
+    TEST_ASSERT_TRUE(first < FRACTURE_CACHE_MODEL_BASE + FRACTURE_VARIANTS * 8);
+
+    // debris sits around the ship, within the model's reach
+    for (uint32_t i = 0; i < debris->active; i++) {
+        TEST_ASSERT_EQUAL_UINT16(first + i, debris->model_idx[i]);
+        TEST_ASSERT_FLOAT_WITHIN(64.0f, 50.0f, debris->position_orientation.position_x[i]);
+    }
+
+    // dying cached debris gives nothing back to the pool, pooled debris still does
+    int pooled = fragment_pool_alloc();
+    debris->model_idx[0] = (uint16_t)(FRAGMENT_MODEL_BASE + pooled);
+    memset(debris->lifetime_ticks, 0, debris->active * sizeof(uint16_t));
+    debris_pack();
+    TEST_ASSERT_EQUAL_UINT32(0, debris->active);
+    TEST_ASSERT_EQUAL_INT(pooled, fragment_pool_alloc());
+}
+
+// Test: slots fill word after word through the summary, runs take only the chunks they need and freed
+// runs are found again
+void fracture_test__arena_slots_and_runs(void) {
+    // past the first word, the full one is skipped by the summary
+    for (int i = 0; i < 70; i++) {
+        TEST_ASSERT_EQUAL_INT(i, fragment_pool_alloc());
+    }
+    TEST_ASSERT_TRUE(_fragment_arena.slots_full == 1);
+    fragment_pool_free(3);
+    fragment_pool_free(66);
+    TEST_ASSERT_TRUE(_fragment_arena.slots_full == 0);
+    TEST_ASSERT_EQUAL_INT(3, fragment_pool_alloc());
+    TEST_ASSERT_EQUAL_INT(66, fragment_pool_alloc());
+
+    // 17 vertices take 2 chunks, 128 take 8, a slot gets one run only
+    int8_t* small = fragment_reserve_vertices(0, 17);
+    int8_t* large = fragment_reserve_vertices(1, FRAGMENT_MAX_VERTICES);
+    TEST_ASSERT_TRUE(small == _fragment_arena.vertices[0]);
+    TEST_ASSERT_TRUE(large == _fragment_arena.vertices[2]);
+    TEST_ASSERT_NULL(fragment_reserve_vertices(0, 4));
+    TEST_ASSERT_NULL(fragment_reserve_vertices(2, FRAGMENT_MAX_VERTICES + 1));
+    TEST_ASSERT_NULL(fragment_reserve_vertices(100, 4));
+
+    // the freed hole fits a run as long as it, a longer one goes behind the used chunks
+    fragment_pool_free(0);
+    TEST_ASSERT_TRUE(fragment_reserve_vertices(2, 48) == _fragment_arena.vertices[10]);
+    TEST_ASSERT_TRUE(fragment_reserve_vertices(3, 20) == _fragment_arena.vertices[0]);
+    TEST_ASSERT_EQUAL_UINT8(20, _fragment_arena.vertex_counts[3]);
+
+    // a run never straddles a word: six more long runs leave 3 chunks at the end of word 0, the next starts word 1
+    for (int slot = 4; slot < 10; slot++) {
+        TEST_ASSERT_NOT_NULL(fragment_reserve_vertices(slot, FRAGMENT_MAX_VERTICES));
+    }
+    TEST_ASSERT_TRUE(fragment_reserve_vertices(10, FRAGMENT_MAX_VERTICES) == _fragment_arena.vertices[64]);
+}
+
+// Test: one call explodes many entities, their debris shares lanes and survives a staging flush
+// (the ship's patterns break into 2+ pieces each, so this many ships overflow the staging at least once)
+#define EXPLODE_SHIPS 130
+void fracture_test__explode_many_in_one_batch(void) {
+    struct objects_data* od = entity_manager_get_objects();
+    struct debris_data* debris = debris_get();
+    fracture_cache_initialize();
+
+    // more entities than the staging holds fragments for, one dead index mixed in
+    static uint32_t indices[EXPLODE_SHIPS + 1];
+    int expected_max = 0;
+    for (uint32_t e = 0; e < EXPLODE_SHIPS; e++) {
+        entity_id_t ship = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 0);
+        indices[e] = entity_manager_object_index(ship);
+        od->model_idx[indices[e]] = 0;
+        od->position_orientation.position_x[HOT_IDX(indices[e])] = 1000.0f * (float)e;
+        od->velocity_y[HOT_IDX(indices[e])] = 5.0f;
+        expected_max += 8;
+    }
+    indices[EXPLODE_SHIPS] = od->active;
+
+    int fragments = explode_entities(indices, EXPLODE_SHIPS + 1);
+    TEST_ASSERT_TRUE(fragments >= EXPLODE_SHIPS * 2 && fragments <= expected_max);
+    TEST_ASSERT_TRUE(fragments > EXPLODE_BATCH_LANES);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)fragments, debris->active);
+
+    // every piece sits at its own ship, with a cached pattern model and the ship's drift in its velocity
+    for (uint32_t i = 0; i < debris->active; i++) {
+        float x = debris->position_orientation.position_x[i];
+        float ship_x = 1000.0f * (float)(int)((x + 500.0f) / 1000.0f);
+        TEST_ASSERT_FLOAT_WITHIN(64.0f, ship_x, x);
+        TEST_ASSERT_TRUE(debris->model_idx[i] >= FRACTURE_CACHE_MODEL_BASE);
+        TEST_ASSERT_TRUE(debris->model_idx[i] < FRACTURE_CACHE_MODEL_BASE + FRACTURE_VARIANTS * 8);
+        TEST_ASSERT_FLOAT_WITHIN(40.0f, 5.0f, debris->velocity_y[i]);
+    }
+}
+
+// Test: debris breaks into arena pieces generation by generation, stops at the depth limit and below the size
+void fracture_test__debris_cascades_to_depth_limit(void) {
+    struct objects_data* od = entity_manager_get_objects();
+    struct debris_data* debris = debris_get();
+    fracture_cache_initialize();
+
+    entity_id_t ship = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 0);
+    uint32_t idx = entity_manager_object_index(ship);
+    od->model_idx[idx] = 0;
+    TEST_ASSERT_TRUE(explode_entity(idx) > 0);
+
+    static uint32_t generation[8 * 8 * 8]; // up to 8 pieces per piece
+    uint32_t first = 0;
+    for (uint32_t depth = 2; depth <= FRACTURE_MAX_DEPTH + 1; depth++) {
+        uint32_t last = debris->active;
+        for (uint32_t i = first; i < last; i++) {
+            generation[i - first] = i;
+        }
+
+        int pieces = fracture_debris(generation, last - first);
+        for (uint32_t i = first; i < last; i++) {
+            TEST_ASSERT_EQUAL_UINT16(0, debris->lifetime_ticks[i]);
+        }
+        TEST_ASSERT_EQUAL_UINT32(last + (uint32_t)pieces, debris->active);
+        if (depth > FRACTURE_MAX_DEPTH) {
+            TEST_ASSERT_EQUAL_INT(0, pieces);
+            break;
+        }
+
+        // the ship is big enough for every generation below the limit to break somewhere
+        TEST_ASSERT_TRUE(pieces > 0);
+        for (uint32_t i = last; i < debris->active; i++) {
+            int pool_idx = debris->model_idx[i] - FRAGMENT_MODEL_BASE;
+            TEST_ASSERT_TRUE(pool_idx >= 0 && pool_idx < FRAGMENT_POOL_SIZE);
+            TEST_ASSERT_EQUAL_UINT8(depth, _fragment_arena.depth[pool_idx]);
+            TEST_ASSERT_FLOAT_WITHIN(96.0f, 0.0f, debris->position_orientation.position_x[i]);
+            TEST_ASSERT_TRUE(debris->lifetime_ticks[i] >= 45 && debris->lifetime_ticks[i] < 75);
+        }
+        first = last;
+    }
+
+    // a splinter under the minimum size just dies
+    int splinter = fragment_pool_alloc();
+    int8_t* verts = fragment_reserve_vertices(splinter, 2);
+    verts[0] = 0; verts[1] = 0; verts[2] = 3; verts[3] = 3;
+    __declspec(align(32)) float zero[8] = { 0 };
+    __declspec(align(32)) float one[8] = { 1.0f };
+    __declspec(align(32)) uint16_t model[8] = { (uint16_t)(FRAGMENT_MODEL_BASE + splinter) };
+    debris_batch_t batch = { .count = 1, .x = zero, .y = zero, .vx = zero, .vy = zero, .ox = one, .oy = zero,
+                             .model_idx = model, .radius = 1.0f, .ttl_min = 10 };
+    debris_emit(&batch);
+    uint32_t splinter_piece = debris->active - 1;
+    TEST_ASSERT_EQUAL_INT(0, fracture_debris(&splinter_piece, 1));
+    TEST_ASSERT_EQUAL_UINT16(0, debris->lifetime_ticks[splinter_piece]);
 }
 
+#endif
@@ -3,53 +3,103 @@
 #include <stdint.h>
 #include "core/core.h"
 
-// Fragment pool configuration
-#define FRAGMENT_POOL_SIZE 32
-#define FRAGMENT_MAX_VERTICES 48  // 24 line segments max per fragment
+// Fragment arena configuration
+// Slots are tracked by 64-bit words under one 64-bit summary word, both sizes are exactly 64 * 64
+#define FRAGMENT_POOL_SIZE 4096
+#define FRAGMENT_POOL_WORDS (FRAGMENT_POOL_SIZE / 64)
+#define FRAGMENT_MAX_VERTICES 128  // 64 line segments max per fragment
+
+// Vertices live in runs of whole chunks shared by all slots, a fragment takes only the chunks it fills
+#define FRAGMENT_CHUNK_VERTICES 16  // 32 bytes per chunk
+#define FRAGMENT_CHUNKS 4096
+#define FRAGMENT_CHUNK_WORDS (FRAGMENT_CHUNKS / 64)
 
 // Model indices >= this are dynamic fragments, not static models
+// (everything up to the end of the cache has to stay below 32768, particles compare model indices as int16)
 #define FRAGMENT_MODEL_BASE 64
 
-// SoA fragment pool - stores dynamically created model fragments
+// Precomputed fracture patterns: FRACTURE_VARIANTS per model, built once at startup, read-only afterwards.
+// Their fragments are addressed past the pool slots and never freed:
+// model index = FRACTURE_CACHE_MODEL_BASE + (model * FRACTURE_VARIANTS + variant) * 8 + fragment
+#define FRACTURE_VARIANTS 4
+#define FRACTURE_CACHE_MODEL_BASE (FRAGMENT_MODEL_BASE + FRAGMENT_POOL_SIZE)
+
+// Debris breaks again down to FRACTURE_MAX_DEPTH generations, pieces at the limit or under FRACTURE_MIN_SIZE
+// model units across just disappear
+#define FRACTURE_MAX_DEPTH 3
+#define FRACTURE_MIN_SIZE 6.0f
+
+// Fragment arena - dynamically created model fragments, no malloc
+// Bit set = slot/chunk in use; a summary bit is set when its whole word is in use, alloc is two tzcnts
 typedef struct {
-    __declspec(align(32)) int8_t vertices[FRAGMENT_POOL_SIZE][FRAGMENT_MAX_VERTICES * 2];
+    __declspec(align(32)) int8_t vertices[FRAGMENT_CHUNKS][FRAGMENT_CHUNK_VERTICES * 2];
+    uint16_t first_chunk[FRAGMENT_POOL_SIZE];
     uint8_t vertex_counts[FRAGMENT_POOL_SIZE];
-    uint32_t active_mask;  // bitmask for O(1) alloc via _tzcnt_u32
-} FragmentPool;
+    uint8_t depth[FRAGMENT_POOL_SIZE];  // fracture generation, pattern fragments are 1
+    uint64_t slots_used[FRAGMENT_POOL_WORDS];
+    uint64_t slots_full;
+    uint64_t chunks_used[FRAGMENT_CHUNK_WORDS];
+    uint64_t chunks_full;
+} FragmentArena;
 
 // Result from fracturing a model
 typedef struct {
-    uint8_t pool_indices[8];   // which fragment pool slots were used
+    uint16_t pool_indices[8];  // which fragment arena slots were used
     float centroid_x[8];       // offset from original center
     float centroid_y[8];
     uint8_t count;             // number of fragments created (0-8)
 } FractureResult;
 
-// Initialize the fragment pool (called once at startup)
+// Initialize the fragment arena (called once at startup)
 void fragment_pool_initialize(void);
 
-// Allocate a fragment slot from pool
-// Returns pool index (0-31), or -1 if pool is full
+// Build the fracture pattern cache, only the first call does any work
+void fracture_cache_initialize(void);
+
+// Arena contents go into world snapshots as is (model indices of live fragments stay valid)
+struct snapshot;
+void fragment_pool_snapshot_save(struct snapshot* snapshot);
+bool fragment_pool_snapshot_load(struct snapshot* snapshot);
+
+// Allocate a fragment slot from the arena, without vertices yet
+// Returns pool index (0 to FRAGMENT_POOL_SIZE - 1), or -1 if the arena is full
 int fragment_pool_alloc(void);
 
-// Free a fragment slot back to pool
+// Free a fragment slot and its vertex run back to the arena
 void fragment_pool_free(int pool_idx);
 
 // Draw a fragment (called from _generated_draw_model when index >= FRAGMENT_MODEL_BASE)
+// pool_idx >= FRAGMENT_POOL_SIZE draws a cached pattern fragment
 void fragment_draw(color_t color, int pool_idx);
 
-// Get pointer to fragment vertices for writing during fracture
-int8_t* fragment_get_vertices(int pool_idx);
+// GL_LINES vertex pairs of a fragment model (pool or cached), NULL when model_idx isn't a live fragment
+// The storage is padded to whole chunks, so reading vertices in groups of 8 never leaves it
+const int8_t* fragment_lines(uint16_t model_idx, uint32_t* vertex_count);
 
-// Set vertex count for a fragment
-void fragment_set_vertex_count(int pool_idx, uint8_t count);
+// The whole fragment vertex storage, for renderers that upload it (sizes in bytes): fragment_lines pointers fall
+// inside the arena chunks, which change as debris breaks, or inside the pattern cache, fixed once it's built
+const int8_t* fragment_arena_vertices(uint32_t* size);
+const int8_t* fracture_cache_vertices(uint32_t* size);
+
+// Give a fragment slot a run of vertex_count vertices (1 to FRAGMENT_MAX_VERTICES) to write into
+// Returns NULL if the slot isn't allocated, already has its run, or no run that long is free
+int8_t* fragment_reserve_vertices(int pool_idx, uint32_t vertex_count);
 
 // Fracture a model into fragments
 // Returns number of fragments created, fills result with fragment data
 int fracture_model(uint16_t model_idx, FractureResult* result);
 
-// Explode an entity: fracture its model and spawn debris particles
+// Explode an entity: pick a cached pattern of its model, turn it randomly and spawn its pieces as debris
 // object_idx: index into objects_data array
 // Returns number of fragments spawned
 int explode_entity(uint32_t object_idx);
 
+// Explode count entities at once: their fragments share the SIMD lanes and go out in one debris batch
+// Returns number of fragments spawned
+int explode_entities(const uint32_t* object_indices, uint32_t count);
+
+// Break debris (entity/debris.h) into smaller pieces, reusing the cut & classify kernels on their vertices;
+// every listed piece dies, the ones within the depth and size limits leave pieces behind
+// Returns number of pieces spawned
+int fracture_debris(const uint32_t* debris_indices, uint32_t count);
+
@@ -1,27 +1,113 @@
 #include "platform/platform.h"
+#include "platform/math.h"
 #include "controller.h"
 #include "particles.h"
 #include "fracture.h"
 #include "messaging/messaging.h"
 #include "debug/profiler.h"
+#include "snapshot/snapshot.h"
+
+#include <immintrin.h>
 
 #include "../generated/renderer.gen.h" // todo remove
 
+#ifdef PARTICLES_AGE_RING
+// spawns of PARTICLE_BUCKET_TICKS consecutive ticks share a bucket, a full ring keeps growing its newest bucket
+#define PARTICLE_BUCKETS 256
+#define PARTICLE_BUCKET_TICKS 8
+#define PARTICLE_TOMBSTONE_POSITION 1.0e9f // far outside of camera and collision reach
+
+struct particle_bucket {
+  uint32_t end;    // one past the bucket's last particle
+  uint32_t expiry; // tick its longest-lived particle dies
+  uint32_t window; // spawn tick / PARTICLE_BUCKET_TICKS
+};
+
+struct particle_ring {
+  struct particle_bucket bucket[PARTICLE_BUCKETS];
+  uint32_t oldest;
+  uint32_t count;
+  uint32_t tick;
+};
+
+static struct particle_ring ring_;
+
+static void _ring_track(uint32_t end, uint32_t ttl) {
+  uint32_t window = ring_.tick / PARTICLE_BUCKET_TICKS;
+  struct particle_bucket* newest =
+      ring_.count > 0 ? &ring_.bucket[(ring_.oldest + ring_.count - 1) % PARTICLE_BUCKETS] : NULL;
+
+  if (newest == NULL || (newest->window != window && ring_.count < PARTICLE_BUCKETS)) {
+    newest = &ring_.bucket[(ring_.oldest + ring_.count) % PARTICLE_BUCKETS];
+    ring_.count++;
+    newest->expiry = 0;
+    newest->window = window;
+  }
+
+  newest->end = end;
+  if (ring_.tick + ttl > newest->expiry) {
+    newest->expiry = ring_.tick + ttl;
+  }
+}
+
+// moves the live part of the storage down to 0, at most as many lanes as got retired since the last slide
+static void _ring_slide(struct particles_data* pd) {
+  uint32_t first = pd->first;
+  uint32_t count = pd->active - first;
+  position_orientation_t* po = &pd->position_orientation;
+
+  platform_copy_memory(po->position_x, po->position_x + first, count * sizeof(float));
+  platform_copy_memory(po->position_y, po->position_y + first, count * sizeof(float));
+  platform_copy_memory(po->orientation_x, po->orientation_x + first, count * sizeof(float));
+  platform_copy_memory(po->orientation_y, po->orientation_y + first, count * sizeof(float));
+  platform_copy_memory(po->radius, po->radius + first, count * sizeof(float));
+  platform_copy_memory(pd->velocity_x, pd->velocity_x + first, count * sizeof(float));
+  platform_copy_memory(pd->velocity_y, pd->velocity_y + first, count * sizeof(float));
+  platform_copy_memory(pd->lifetime_ticks, pd->lifetime_ticks + first, count * sizeof(uint16_t));
+  platform_copy_memory(pd->lifetime_max, pd->lifetime_max + first, count * sizeof(uint16_t));
+  platform_copy_memory(pd->model_idx, pd->model_idx + first, count * sizeof(uint16_t));
+
+  uint32_t end = (pd->active + 7) & ~7u;
+  platform_clear_memory(&pd->lifetime_ticks[count], (end - count) * sizeof(uint16_t));
+
+  for (uint32_t b = 0; b < ring_.count; b++) {
+    ring_.bucket[(ring_.oldest + b) % PARTICLE_BUCKETS].end -= first;
+  }
+  pd->active = count;
+  pd->first = 0;
+}
+#endif
+
+static float _model_radius(uint16_t model_idx) {
+  // Fragments use a small default radius (they're small debris)
+  if (model_idx >= FRAGMENT_MODEL_BASE) {
+    return 8.0f;
+  }
+  return _generated_get_model_radius(model_idx);
+}
+
 static void _spawn_particle(particle_create_t* pcm) {
   struct particles_data* pd = entity_manager_get_particles();
 
-  _ASSERT(pd->active < pd->capacity);
+  if (pd->active >= pd->capacity) {
+#ifdef PARTICLES_AGE_RING
+    if (pd->first > 0) {
+      _ring_slide(pd);
+    }
+#endif
+    if (pd->active >= pd->capacity) {
+      entity_manager_reserve_particles(pd->active + 1);
+    }
+    if (pd->active >= pd->capacity) {
+      return; // full: dropped
+    }
+  }
 
   uint32_t idx = pd->active;
   pd->position_orientation.position_x[idx] = pcm->x;
   pd->position_orientation.position_y[idx] = pcm->y;
 
-  // Fragments use a small default radius (they're small debris)
-  if (pcm->model_idx >= FRAGMENT_MODEL_BASE) {
-    pd->position_orientation.radius[idx] = 8.0f;
-  } else {
-    pd->position_orientation.radius[idx] = _generated_get_model_radius(pcm->model_idx);
-  }
+  pd->position_orientation.radius[idx] = _model_radius(pcm->model_idx);
 
   pd->velocity_x[idx] = pcm->vx;
   pd->velocity_y[idx] = pcm->vy;
@@ -37,12 +123,124 @@ static void _spawn_particle(particle_create_t* pcm) {
     pcm->ttl;
 
   pd->active++;
+#ifdef PARTICLES_AGE_RING
+  _ring_track(pd->active, pcm->ttl);
+#endif
 }
 
 void particles_create_particle(particle_create_t* pc) {
   _spawn_particle(pc);
 }
 
+// 8 int32 lanes -> 8 uint16 lanes (saturated)
+static inline __m128i _narrow_epu16(__m256i v) {
+  return _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+void particles_emit(const particle_batch_t* batch) {
+  PROFILE_ZONE("particles_emit");
+  struct particles_data* pd = entity_manager_get_particles();
+
+  // whole groups of 8 get written, the lanes past count as dead; whatever doesn't fit the reservation is dropped
+  uint32_t count = batch->count;
+  uint32_t padded = (count + 7) & ~7u;
+  if (pd->active + padded > pd->capacity) {
+#ifdef PARTICLES_AGE_RING
+    if (pd->first > 0) {
+      _ring_slide(pd);
+    }
+#endif
+    if (pd->active + padded > pd->capacity) {
+      entity_manager_reserve_particles(pd->active + padded);
+    }
+    if (pd->active + padded > pd->capacity) {
+      count = padded = (pd->capacity - pd->active) & ~7u;
+    }
+  }
+
+  __declspec(align(32)) float radius[8];
+  __m256 shared_radius = _mm256_set1_ps(batch->model_idx == NULL ? _model_radius(batch->model) : 0.0f);
+  __m128i shared_model = _mm_set1_epi16((short)batch->model);
+  __m256 ttl_min = _mm256_set1_ps((float)batch->ttl_min);
+  __m256 ttl_range = _mm256_set1_ps((float)batch->ttl_range);
+  __m256 epsilon = _mm256_set1_ps(1.0e-6f);
+  __m256 one = _mm256_set1_ps(1.0f);
+  __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  position_orientation_t* po = &pd->position_orientation;
+  for (uint32_t i = 0; i < count; i += 8) {
+    uint32_t target = pd->active + i;
+
+    __m256 x = _mm256_loadu_ps(batch->x + i);
+    __m256 y = _mm256_loadu_ps(batch->y + i);
+    __m256 vx = _mm256_loadu_ps(batch->vx + i);
+    __m256 vy = _mm256_loadu_ps(batch->vy + i);
+
+    if (batch->dir_x != NULL) {
+      __m256 dx = _mm256_loadu_ps(batch->dir_x + i);
+      __m256 dy = _mm256_loadu_ps(batch->dir_y + i);
+
+      // perpendicular (-dy, dx)
+      __m256 side = _mm256_mul_ps(randf_symmetric_8(), _mm256_set1_ps(batch->spread));
+      __m256 scale = _mm256_fmadd_ps(randf_symmetric_8(), _mm256_set1_ps(batch->speed_variance), one);
+      vx = _mm256_fmadd_ps(_mm256_fnmadd_ps(dy, side, dx), scale, vx);
+      vy = _mm256_fmadd_ps(_mm256_fmadd_ps(dx, side, dy), scale, vy);
+
+      __m256 inv_len = _mm256_rsqrt_ps(_mm256_max_ps(_mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy)), epsilon));
+      __m256 offset = _mm256_mul_ps(_mm256_mul_ps(randf_symmetric_8(), _mm256_set1_ps(batch->jitter)), inv_len);
+      x = _mm256_fnmadd_ps(dy, offset, x);
+      y = _mm256_fmadd_ps(dx, offset, y);
+    }
+
+    __m256 ox, oy;
+    if (batch->ox != NULL) {
+      __m256 jitter = _mm256_set1_ps(batch->orientation_jitter);
+      ox = _mm256_fmadd_ps(randf_symmetric_8(), jitter, _mm256_loadu_ps(batch->ox + i));
+      oy = _mm256_fmadd_ps(randf_symmetric_8(), jitter, _mm256_loadu_ps(batch->oy + i));
+    } else {
+      ox = randf_symmetric_8();
+      oy = randf_symmetric_8();
+    }
+    __m256 inv_len = _mm256_rsqrt_ps(_mm256_max_ps(_mm256_fmadd_ps(ox, ox, _mm256_mul_ps(oy, oy)), epsilon));
+    ox = _mm256_mul_ps(ox, inv_len);
+    oy = _mm256_mul_ps(oy, inv_len);
+
+    // lanes past count stay dead
+    __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)(count - i)), lane);
+    __m256i ttl = _mm256_cvttps_epi32(_mm256_fmadd_ps(randf_8(), ttl_range, ttl_min));
+    __m128i ttl16 = _narrow_epu16(_mm256_and_si256(ttl, valid));
+
+    __m128i models = shared_model;
+    __m256 radii = shared_radius;
+    if (batch->model_idx != NULL) {
+      models = _mm_loadu_si128((const __m128i*)(batch->model_idx + i));
+      for (uint32_t l = 0; l < 8; l++) {
+        radius[l] = i + l < count ? _model_radius(batch->model_idx[i + l]) : 0.0f;
+      }
+      radii = _mm256_load_ps(radius);
+    }
+
+    _mm256_storeu_ps(po->position_x + target, x);
+    _mm256_storeu_ps(po->position_y + target, y);
+    _mm256_storeu_ps(po->orientation_x + target, ox);
+    _mm256_storeu_ps(po->orientation_y + target, oy);
+    _mm256_storeu_ps(po->radius + target, radii);
+    _mm256_storeu_ps(pd->velocity_x + target, vx);
+    _mm256_storeu_ps(pd->velocity_y + target, vy);
+    _mm_storeu_si128((__m128i*)(pd->lifetime_ticks + target), ttl16);
+    _mm_storeu_si128((__m128i*)(pd->lifetime_max + target), ttl16);
+    _mm_storeu_si128((__m128i*)(pd->model_idx + target), models);
+  }
+
+  pd->active += count;
+#ifdef PARTICLES_AGE_RING
+  if (count > 0) {
+    _ring_track(pd->active, (uint32_t)batch->ttl_min + batch->ttl_range);
+  }
+#endif
+  PROFILE_ZONE_END();
+}
+
 static void _particles_dispatch(entity_id_t id, message_t msg) {
   (void)id;
 
@@ -58,69 +256,385 @@ static void _particles_dispatch(entity_id_t id, message_t msg) {
   }
 }
 
-static void _move_particle(struct particles_data* pd, size_t target, size_t source) {
-  pd->position_orientation.position_x[target] = pd->position_orientation.position_x[source];
-  pd->position_orientation.position_y[target] = pd->position_orientation.position_y[source];
-  pd->position_orientation.orientation_x[target] = pd->position_orientation.orientation_x[source];
-  pd->position_orientation.orientation_y[target] = pd->position_orientation.orientation_y[source];
-  pd->position_orientation.radius[target] = pd->position_orientation.radius[source];
+// lane indices of the set bits of an 8-bit alive mask packed to the front, one byte per lane
+static uint64_t pack_lanes_[256];
 
-  pd->velocity_x[target] = pd->velocity_x[source];
-  pd->velocity_y[target] = pd->velocity_y[source];
-  pd->lifetime_ticks[target] = pd->lifetime_ticks[source];
-  pd->lifetime_max[target] = pd->lifetime_max[source];
-  pd->model_idx[target] = pd->model_idx[source];
+static void _pack_lanes_initialize(void) {
+  for (uint32_t mask = 0; mask < 256; mask++) {
+    uint64_t lanes = 0;
+    uint32_t packed = 0;
+    for (uint32_t lane = 0; lane < 8; lane++) {
+      if (mask & (1u << lane)) {
+        lanes |= (uint64_t)lane << (8 * packed++);
+      }
+    }
+    pack_lanes_[mask] = lanes;
+  }
+}
 
-  pd->lifetime_ticks[source] = 0;
+static uint32_t _valid_lanes(uint32_t remaining) {
+  return remaining >= 8 ? 0xFFu : (1u << remaining) - 1;
 }
 
-// Helper to free fragment slot if particle was using one
-static void _free_particle_fragment(struct particles_data* pd, size_t idx) {
-  uint16_t model = pd->model_idx[idx];
-  if (model >= FRAGMENT_MODEL_BASE) {
-    fragment_pool_free(model - FRAGMENT_MODEL_BASE);
+// fragment slots of the dying particles go back to the arena before the pack overwrites model_idx
+static void _free_dead_fragments(struct particles_data* pd, const uint8_t* alive_masks) {
+  const __m128i last_static_model = _mm_set1_epi16(FRAGMENT_MODEL_BASE - 1);
+  const __m128i first_cached_model = _mm_set1_epi16(FRACTURE_CACHE_MODEL_BASE);
+
+  for (uint32_t i = 0; i < pd->active; i += 8) {
+    uint32_t dead = ~(uint32_t)alive_masks[i >> 3] & _valid_lanes(pd->active - i);
+    if (dead == 0) {
+      continue;
+    }
+
+    __m128i models = _mm_load_si128((const __m128i*)&pd->model_idx[i]);
+    // pool slots only, cached pattern fragments are shared and never freed
+    __m128i is_pooled =
+        _mm_and_si128(_mm_cmpgt_epi16(models, last_static_model), _mm_cmplt_epi16(models, first_cached_model));
+    __m128i is_fragment = _mm_packs_epi16(is_pooled, _mm_setzero_si128());
+    uint32_t fragments = (uint32_t)_mm_movemask_epi8(is_fragment) & dead;
+    while (fragments != 0) {
+      uint32_t lane = _tzcnt_u32(fragments);
+      uint32_t pool_idx = pd->model_idx[i + lane] - FRAGMENT_MODEL_BASE;
+      _ASSERT(pool_idx < FRAGMENT_POOL_SIZE);
+      fragment_pool_free((int)pool_idx);
+      fragments &= fragments - 1;
+    }
   }
 }
 
-void entity_manager_pack_particles(void) {
+// the stores write whole 8-lane groups at the (lower or equal) target, lanes past the survivors only ever
+// overwrite what the current group already loaded
+static inline void _pack_column_32(float* column, uint32_t target, uint32_t source, __m256i permutation) {
+  __m256 values = _mm256_load_ps(column + source);
+  _mm256_storeu_ps(column + target, _mm256_permutevar8x32_ps(values, permutation));
+}
+
+static inline void _pack_column_16(uint16_t* column, uint32_t target, uint32_t source, __m128i shuffle) {
+  __m128i values = _mm_load_si128((const __m128i*)(column + source));
+  _mm_storeu_si128((__m128i*)(column + target), _mm_shuffle_epi8(values, shuffle));
+}
+
+void entity_manager_pack_particles(const uint8_t* alive_masks) {
   PROFILE_ZONE("entity_manager_pack_particles");
   struct particles_data* pd = entity_manager_get_particles();
+  position_orientation_t* po = &pd->position_orientation;
 
-  int32_t last_alive = (int32_t)(pd->active - 1);
+  _free_dead_fragments(pd, alive_masks);
 
-  for (int32_t i = 0; i < last_alive; ++i) {
-    if (pd->lifetime_ticks[i] == 0) {
-      // Free fragment slot for this dead particle
-      _free_particle_fragment(pd, i);
+  uint32_t active = pd->active;
+  uint32_t target = 0;
+  for (uint32_t i = 0; i < active; i += 8) {
+    uint32_t alive = alive_masks[i >> 3] & _valid_lanes(active - i);
+    if (alive == 0xFF && target == i) {
+      target += 8; // nothing died so far, already in place
+      continue;
+    }
+    if (alive == 0) {
+      continue;
+    }
 
-      for (; last_alive >= i; --last_alive) {
-        if (pd->lifetime_ticks[last_alive] > 0) {
-          break;
-        }
-        // Free fragment slots for dead particles at the end
-        _free_particle_fragment(pd, last_alive);
-      }
+    __m128i lanes = _mm_loadl_epi64((const __m128i*)&pack_lanes_[alive]);
+    __m256i permutation = _mm256_cvtepu8_epi32(lanes);
+    // lane k of a 16-bit column is bytes 2k, 2k + 1
+    __m128i shuffle = _mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(lanes), _mm_set1_epi16(0x0202)),
+                                    _mm_set1_epi16(0x0100));
+
+    _pack_column_32(po->position_x, target, i, permutation);
+    _pack_column_32(po->position_y, target, i, permutation);
+    _pack_column_32(po->orientation_x, target, i, permutation);
+    _pack_column_32(po->orientation_y, target, i, permutation);
+    _pack_column_32(po->radius, target, i, permutation);
+    _pack_column_32(pd->velocity_x, target, i, permutation);
+    _pack_column_32(pd->velocity_y, target, i, permutation);
+    _pack_column_16(pd->lifetime_ticks, target, i, shuffle);
+    _pack_column_16(pd->lifetime_max, target, i, shuffle);
+    _pack_column_16(pd->model_idx, target, i, shuffle);
+
+    target += _mm_popcnt_u32(alive);
+  }
+
+  // everything behind the survivors has to read as dead for the next ttl pass
+  uint32_t end = (active + 7) & ~7u;
+  platform_clear_memory(&pd->lifetime_ticks[target], (end - target) * sizeof(uint16_t));
+
+  pd->active = target;
+  PROFILE_ZONE_END();
+}
+
+#ifdef PARTICLES_AGE_RING
+// early deaths since the last tick: park them, give their fragment back, mark them as tombstones (no model, drawing
+// skips them)
+static void _bury_dead(struct particles_data* pd, const uint8_t* alive_masks) {
+  const __m128i last_static_model = _mm_set1_epi16(FRAGMENT_MODEL_BASE - 1);
+  const __m128i first_cached_model = _mm_set1_epi16(FRACTURE_CACHE_MODEL_BASE);
+
+  for (uint32_t i = pd->first; i < pd->active; i += 8) {
+    uint32_t dead = ~(uint32_t)alive_masks[i >> 3] & _valid_lanes(pd->active - i);
+    if (dead == 0) {
+      continue;
+    }
+
+    __m128i max = _mm_load_si128((const __m128i*)&pd->lifetime_max[i]);
+    uint32_t buried =
+        (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(max, _mm_setzero_si128()), _mm_setzero_si128()));
+    uint32_t fresh = dead & ~buried;
+    if (fresh == 0) {
+      continue;
+    }
+
+    __m128i models = _mm_load_si128((const __m128i*)&pd->model_idx[i]);
+    __m128i is_pooled =
+        _mm_and_si128(_mm_cmpgt_epi16(models, last_static_model), _mm_cmplt_epi16(models, first_cached_model));
+    __m128i is_fragment = _mm_packs_epi16(is_pooled, _mm_setzero_si128());
+    uint32_t fragments = (uint32_t)_mm_movemask_epi8(is_fragment);
 
-      if (i < last_alive) {
-        _move_particle(pd, i, last_alive);
-        --last_alive; // Consumed this particle, move to next
-      } else {
-        break;
+    while (fresh != 0) {
+      uint32_t lane = _tzcnt_u32(fresh);
+      uint32_t idx = i + lane;
+      if (fragments & (1u << lane)) {
+        _ASSERT(pd->model_idx[idx] - FRAGMENT_MODEL_BASE < FRAGMENT_POOL_SIZE);
+        fragment_pool_free(pd->model_idx[idx] - FRAGMENT_MODEL_BASE);
       }
+      pd->model_idx[idx] = 0xFFFF;
+      pd->lifetime_max[idx] = 0;
+      pd->position_orientation.position_x[idx] = PARTICLE_TOMBSTONE_POSITION;
+      pd->position_orientation.position_y[idx] = PARTICLE_TOMBSTONE_POSITION;
+      pd->velocity_x[idx] = 0.0f;
+      pd->velocity_y[idx] = 0.0f;
+      fresh &= fresh - 1;
     }
   }
+}
+
+void entity_manager_retire_particles(const uint8_t* alive_masks) {
+  PROFILE_ZONE("entity_manager_retire_particles");
+  struct particles_data* pd = entity_manager_get_particles();
 
-  // Handle the case where last particle(s) are dead
-  for (int32_t i = last_alive; i >= 0 && pd->lifetime_ticks[i] == 0; --i) {
-    _free_particle_fragment(pd, i);
-    last_alive = i - 1;
+  _bury_dead(pd, alive_masks);
+
+  // everything in an expired bucket is buried by now, the storage front moves past it (the TTL pass
+  // works in 16-lane steps, so first stays 16-aligned and the last few lanes are skipped later)
+  ring_.tick++;
+  while (ring_.count > 0 && ring_.bucket[ring_.oldest].expiry <= ring_.tick) {
+    pd->first = ring_.bucket[ring_.oldest].end & ~15u;
+    ring_.oldest = (ring_.oldest + 1) % PARTICLE_BUCKETS;
+    ring_.count--;
+  }
+
+  if (ring_.count == 0) {
+    pd->active = 0; // all buried, their lifetimes are 0 already
+    pd->first = 0;
+  } else if (pd->first >= pd->active - pd->first) {
+    _ring_slide(pd);
   }
 
-  pd->active = last_alive + 1;
+  PROFILE_PLOT_I("particle_buckets", ring_.count);
   PROFILE_ZONE_END();
 }
+#endif
+
+void particles_snapshot_save(struct snapshot* snapshot) {
+#ifdef PARTICLES_AGE_RING
+  snapshot_write(snapshot, SNAPSHOT_SECTION_PARTICLE_RING, &ring_, sizeof(ring_));
+#else
+  snapshot_write(snapshot, SNAPSHOT_SECTION_PARTICLE_RING, NULL, 0);
+#endif
+}
+
+bool particles_snapshot_load(struct snapshot* snapshot) {
+  size_t size;
+  const void* ring = snapshot_read(snapshot, SNAPSHOT_SECTION_PARTICLE_RING, &size);
+#ifdef PARTICLES_AGE_RING
+  if (ring == NULL || size != sizeof(ring_)) {
+    return false;
+  }
+  platform_copy_memory(&ring_, ring, sizeof(ring_));
+  return true;
+#else
+  return ring != NULL && size == 0;
+#endif
+}
 
 void particles_entity_initialize(void) {
   // we accept only broadcast for controller, no instances
   entity_manager_vtables[ENTITY_TYPE_PARTICLES].dispatch_message = _particles_dispatch;
+  _pack_lanes_initialize();
+  particles_clear();
+}
+
+void particles_clear(void) {
+#ifdef PARTICLES_AGE_RING
+  platform_clear_memory(&ring_, sizeof(ring_));
+#endif
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+// Test: pack keeps the survivors in order, clears the tail and returns fragments of the dead to the pool
+void particles_test__pack_keeps_survivors_in_order(void) {
+  struct particles_data* pd = entity_manager_get_particles();
+  int fragment_dead = fragment_pool_alloc();
+  int fragment_alive = fragment_pool_alloc();
+
+  // 21 particles, every third one dies, the dying 9th and surviving 10th carry fragments
+  static uint8_t alive_masks[4];
+  platform_clear_memory(alive_masks, sizeof(alive_masks));
+  for (uint32_t i = 0; i < 21; i++) {
+    particle_create_t particle = { .x = (float)i, .vy = -(float)i, .ox = 1.0f, .ttl = (uint16_t)(i + 1),
+                                   .model_idx = 1 };
+    if (i == 9 || i == 10) {
+      particle.model_idx = (uint16_t)(FRAGMENT_MODEL_BASE + (i == 9 ? fragment_dead : fragment_alive));
+    }
+    particles_create_particle(&particle);
+
+    if (i % 3 != 0) {
+      alive_masks[i >> 3] |= (uint8_t)(1u << (i & 7));
+    } else {
+      pd->lifetime_ticks[i] = 0;
+    }
+  }
+
+  entity_manager_pack_particles(alive_masks);
+
+  TEST_ASSERT_EQUAL_UINT32(14, pd->active);
+  for (uint32_t k = 0; k < 14; k++) {
+    uint32_t source = k + k / 2 + 1; // 1, 2, 4, 5, 7, 8, ...
+    TEST_ASSERT_EQUAL_FLOAT((float)source, pd->position_orientation.position_x[k]);
+    TEST_ASSERT_EQUAL_FLOAT(-(float)source, pd->velocity_y[k]);
+    TEST_ASSERT_EQUAL_UINT16(source + 1, pd->lifetime_max[k]);
+  }
+  TEST_ASSERT_EQUAL_UINT16(FRAGMENT_MODEL_BASE + fragment_alive, pd->model_idx[6]);
+  for (uint32_t i = 14; i < 24; i++) {
+    TEST_ASSERT_EQUAL_UINT16(0, pd->lifetime_ticks[i]);
+  }
+
+  // the dead particle's slot is the only free one below the surviving fragment
+  TEST_ASSERT_EQUAL_INT(fragment_dead, fragment_pool_alloc());
+}
+
+// Test: a batch lands in the columns with its randomization in range and the padding lanes dead
+void particles_test__emit_batch(void) {
+  struct particles_data* pd = entity_manager_get_particles();
+  particle_create_t first = { .ox = 1.0f, .ttl = 5, .model_idx = 1 };
+  particles_create_particle(&first); // batches start unaligned
+
+  __declspec(align(32)) float x[16], y[16], vx[16], vy[16], dir_x[16], dir_y[16];
+  for (uint32_t i = 0; i < 16; i++) {
+    x[i] = (float)i;
+    y[i] = 0.0f;
+    vx[i] = 0.0f;
+    vy[i] = 5.0f;
+    dir_x[i] = 10.0f;
+    dir_y[i] = 0.0f;
+  }
+  particle_batch_t batch = { .count = 11, .x = x, .y = y, .vx = vx, .vy = vy, .dir_x = dir_x, .dir_y = dir_y,
+                             .model = 2, .ttl_min = 20, .ttl_range = 10, .speed_variance = 0.3f, .spread = 0.5f,
+                             .jitter = 1.0f };
+  particles_emit(&batch);
+
+  TEST_ASSERT_EQUAL_UINT32(12, pd->active);
+  for (uint32_t k = 1; k < 12; k++) {
+    float px = pd->position_orientation.position_x[k], py = pd->position_orientation.position_y[k];
+    float ox = pd->position_orientation.orientation_x[k], oy = pd->position_orientation.orientation_y[k];
+    TEST_ASSERT_EQUAL_FLOAT((float)(k - 1), px); // jitter goes sideways only
+    TEST_ASSERT_TRUE(py >= -1.0f && py <= 1.0f);
+    TEST_ASSERT_TRUE(pd->velocity_x[k] >= 7.0f && pd->velocity_x[k] <= 13.0f);
+    TEST_ASSERT_TRUE(pd->velocity_y[k] >= 5.0f - 6.5f && pd->velocity_y[k] <= 5.0f + 6.5f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, ox * ox + oy * oy);
+    TEST_ASSERT_TRUE(pd->lifetime_ticks[k] >= 20 && pd->lifetime_ticks[k] < 30);
+    TEST_ASSERT_EQUAL_UINT16(pd->lifetime_ticks[k], pd->lifetime_max[k]);
+    TEST_ASSERT_EQUAL_UINT16(2, pd->model_idx[k]);
+    TEST_ASSERT_EQUAL_FLOAT(_model_radius(2), pd->position_orientation.radius[k]);
+  }
+  for (uint32_t k = 12; k < 20; k++) {
+    TEST_ASSERT_EQUAL_UINT16(0, pd->lifetime_ticks[k]);
+  }
+}
+
+// Test: at the end of the reservation a batch keeps the groups of 8 that fit, single particles are dropped
+void particles_test__full_storage_drops_excess(void) {
+  struct particles_data* pd = entity_manager_get_particles();
+  entity_manager_reserve_particles(PARTICLES_MAX_CAPACITY);
+  TEST_ASSERT_EQUAL_UINT32(PARTICLES_MAX_CAPACITY, pd->capacity);
+
+  __declspec(align(32)) float zero[16] = { 0.0f };
+  particle_batch_t batch = { .count = 16, .x = zero, .y = zero, .vx = zero, .vy = zero, .model = 1, .ttl_min = 20 };
+
+  pd->active = PARTICLES_MAX_CAPACITY - 12;
+  particles_emit(&batch);
+  TEST_ASSERT_EQUAL_UINT32(PARTICLES_MAX_CAPACITY - 4, pd->active);
+
+  particles_emit(&batch);
+  TEST_ASSERT_EQUAL_UINT32(PARTICLES_MAX_CAPACITY - 4, pd->active);
+
+  particle_create_t single = { .ox = 1.0f, .ttl = 5, .model_idx = 1 };
+  for (uint32_t i = 0; i < 8; i++) {
+    particles_create_particle(&single);
+  }
+  TEST_ASSERT_EQUAL_UINT32(PARTICLES_MAX_CAPACITY, pd->active);
+  TEST_ASSERT_EQUAL_UINT32(PARTICLES_MAX_CAPACITY, pd->capacity);
 }
+
+#ifdef PARTICLES_AGE_RING
+// one tick of what the physics does: ttl pass, then retire
+static void _test_ring_tick(struct particles_data* pd, uint8_t* alive_masks) {
+  platform_clear_memory(alive_masks, 64);
+  for (uint32_t i = pd->first; i < pd->active; i++) {
+    if (pd->lifetime_ticks[i] > 0 && --pd->lifetime_ticks[i] > 0) {
+      alive_masks[i >> 3] |= (uint8_t)(1u << (i & 7));
+    }
+  }
+  entity_manager_retire_particles(alive_masks);
+}
+
+// Test: early deaths become tombstones, an expired bucket retires as a whole and the live rest slides down
+void particles_test__ring_retires_buckets(void) {
+  struct particles_data* pd = entity_manager_get_particles();
+  static uint8_t alive_masks[64];
+  int fragment = fragment_pool_alloc();
+
+  // first bucket: 20 particles living 10 ticks, except a fragment dying after 1
+  for (uint32_t i = 0; i < 20; i++) {
+    particle_create_t particle = { .x = (float)i, .ox = 1.0f, .ttl = 10, .model_idx = 1 };
+    if (i == 3) {
+      particle.ttl = 1;
+      particle.model_idx = (uint16_t)(FRAGMENT_MODEL_BASE + fragment);
+    }
+    particles_create_particle(&particle);
+  }
+
+  _test_ring_tick(pd, alive_masks);
+  TEST_ASSERT_EQUAL_UINT32(20, pd->active);
+  TEST_ASSERT_EQUAL_UINT16(0, pd->lifetime_max[3]);
+  TEST_ASSERT_EQUAL_UINT16(0xFFFF, pd->model_idx[3]); // not drawn
+  TEST_ASSERT_TRUE(pd->position_orientation.position_x[3] > 1.0e6f);
+  TEST_ASSERT_EQUAL_INT(fragment, fragment_pool_alloc()); // given back while the bucket is still alive
+
+  // the second bucket opens in the next spawn window
+  for (uint32_t tick = 1; tick < 8; tick++) {
+    _test_ring_tick(pd, alive_masks);
+  }
+  for (uint32_t i = 0; i < 4; i++) {
+    particle_create_t particle = { .x = 100.0f + (float)i, .ox = 1.0f, .ttl = 50, .model_idx = 2 };
+    particles_create_particle(&particle);
+  }
+  TEST_ASSERT_EQUAL_UINT32(24, pd->active);
+
+  _test_ring_tick(pd, alive_masks);
+  TEST_ASSERT_EQUAL_UINT32(24, pd->active);
+  TEST_ASSERT_EQUAL_UINT16(1, pd->lifetime_ticks[0]);
+
+  // the first bucket expires at tick 10, its 16 leading lanes are gone after the slide
+  _test_ring_tick(pd, alive_masks);
+  TEST_ASSERT_EQUAL_UINT32(0, pd->first);
+  TEST_ASSERT_EQUAL_UINT32(8, pd->active);
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(100.0f + (float)i, pd->position_orientation.position_x[4 + i]);
+    TEST_ASSERT_EQUAL_UINT16(48, pd->lifetime_ticks[4 + i]);
+  }
+}
+#endif
+
+#endif
@@ -18,5 +18,42 @@ typedef struct {
 } particle_create_t;
 
 
+// Batched emission, written straight into the particle columns 8 at a time. Every particle has its own base
+// position & velocity (arrays of count, padded to a multiple of 8), the randomization is shared by the batch:
+//   velocity    = v + (dir + perp(dir) * spread * [-1, 1)) * (1 + speed_variance * [-1, 1))
+//   position    = p + normalize(perp(dir)) * jitter * [-1, 1)
+//   orientation = normalize(o + orientation_jitter * [-1, 1)^2), random when ox/oy are NULL
+//   ttl         = ttl_min + [0, ttl_range)
+// Once the storage reaches PARTICLES_MAX_CAPACITY the particles that don't fit are dropped.
+typedef struct {
+  uint32_t count;
+
+  const float* x;
+  const float* y;
+  const float* vx;
+  const float* vy;
+  const float* dir_x; // emission velocity relative to v, NULL: none (spread, variance and jitter are ignored)
+  const float* dir_y;
+  const float* ox; // NULL: random orientation
+  const float* oy;
+  const uint16_t* model_idx; // NULL: every particle uses model
+
+  uint16_t model;
+  uint16_t ttl_min;
+  uint16_t ttl_range;
+
+  float speed_variance;
+  float spread;
+  float jitter;
+  float orientation_jitter;
+} particle_batch_t;
+
 void particles_entity_initialize(void);
+void particles_clear(void); // the storage is the entity manager's, this resets the age ring's bookkeeping
 void particles_create_particle(particle_create_t* pc);
+void particles_emit(const particle_batch_t* batch);
+
+// age ring bookkeeping of PARTICLES_AGE_RING builds (an empty section otherwise)
+struct snapshot;
+void particles_snapshot_save(struct snapshot* snapshot);
+bool particles_snapshot_load(struct snapshot* snapshot);
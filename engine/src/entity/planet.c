@@ -7,12 +7,8 @@
 
 static void _planet_dispatch(entity_id_t id, message_t msg) {
   (void)id;
-
-  switch (msg.message) {
-  case MESSAGE_BROADCAST_120HZ_BEFORE_PHYSICS:
-    // Future: planet rotation update
-    break;
-  }
+  (void)msg;
+  // Future: planet rotation update, as a pre-physics system
 }
 
 void planet_entity_initialize(void) {
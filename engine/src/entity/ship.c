@@ -6,11 +6,12 @@
 #include "entity.h"
 #include "engine.h"
 #include "ship.h"
+#include "scheduler/scheduler.h"
 
 #define MAXSIZE 8192
 
 static void _ship_rotate_by(entity_id_t idx, int32_t rotation) {
-  uint32_t id = GET_ORDINAL(idx);
+  uint32_t id = HOT_IDX(entity_manager_object_index(idx));
   struct objects_data* od = entity_manager_get_objects();
 
   float ox = od->position_orientation.orientation_x[id];
@@ -30,26 +31,22 @@ static void _ship_rotate_by(entity_id_t idx, int32_t rotation) {
 
 static void _ship_apply_thrust_from_engines(void) {
   struct objects_data* od = entity_manager_get_objects();
-  struct parts_data* pd = entity_manager_get_parts();
-
-  for (size_t i = 0; i < od->active; i++) {
-    od->thrust[i] = 0.0f;
-
-    for (size_t j = 0; j < od->parts_count[i]; j++) {
-      uint32_t part_idx = od->parts_start_idx[i] + j;
-      if (pd->type[part_idx]._ != ENTITY_TYPE_PART_ENGINE) {
-        continue;
-      }
-      struct engine_data* ed = (struct engine_data*)(pd->data[part_idx].data);
-      od->thrust[i] += ed->thrust;
-    }  
-  }
 
+  uint32_t ships_end = od->type_start[ENTITY_TYPE_SHIP] + od->type_count[ENTITY_TYPE_SHIP];
+  for (uint32_t i = od->type_start[ENTITY_TYPE_SHIP]; i < ships_end; i++) {
+    od->thrust[HOT_IDX(i)] = 0.0f;
+  }
 
+  // one write per parent, the per-engine work is the scan
+  struct engine_components* ec = engine_sum_thrust_by_parent();
+  for (uint32_t s = 0; s < ec->segments; s++) {
+    uint32_t parent_idx = entity_manager_object_index(ec->segment_parent[s]);
+    od->thrust[HOT_IDX(parent_idx)] = ec->segment_sum[ec->segment_last[s]];
+  }
 }
 
 static void _ship_rotate_to(entity_id_t id, float x, float y) {
-  uint32_t obj_idx = GET_ORDINAL(id);
+  uint32_t obj_idx = HOT_IDX(entity_manager_object_index(id));
   struct objects_data* od = entity_manager_get_objects();
 
   od->position_orientation.orientation_x[obj_idx] = x;
@@ -73,9 +70,6 @@ static void _ship_dispatch(entity_id_t id, message_t msg) {
   case MESSAGE_SHIP_ROTATE_BY:
     _ship_rotate_by(id, msg.data_a);
     break;
-  case MESSAGE_BROADCAST_120HZ_BEFORE_PHYSICS:
-    _ship_apply_thrust_from_engines();
-    break;
   case MESSAGE_COLLIDE_OBJECT_OBJECT:
     _ship_handle_collision(id, &msg);
     break;
@@ -87,4 +81,11 @@ static void _ship_dispatch(entity_id_t id, message_t msg) {
 
 void ship_entity_initialize(void) {
   entity_manager_vtables[ENTITY_TYPE_SHIP].dispatch_message = _ship_dispatch;
+
+  system_t thrust = { .name = "ship_thrust",
+                      .phase = SYSTEM_PHASE_PRE_PHYSICS,
+                      .reads = COMPONENT_PARTS_DATA,
+                      .writes = COMPONENT_OBJECTS_THRUST | COMPONENT_PARTS_DATA, // regroups the engine rows
+                      .run = _ship_apply_thrust_from_engines };
+  scheduler_register(&thrust);
 }
@@ -24,6 +24,21 @@ static inline uint32_t GET_ORDINAL(entity_id_t tid) {
   return (uint32_t)((tid._) & 0x007FFFFF);
 }
 
+// Object handles: ordinal = generation (7 bits) | slot (16 bits)
+// the slot maps to the current dense index in objects_data, the generation is bumped on despawn so stale
+// handles are detected (until it wraps). Slot 0xFFFF is never handed out, TYPE_BROADCAST uses it.
+#define ENTITY_SLOT_BITS 16
+#define ENTITY_SLOT_MASK ((1u << ENTITY_SLOT_BITS) - 1)
+#define ENTITY_GENERATION_MASK 0x7Fu
+
+static inline uint32_t GET_SLOT(entity_id_t tid) {
+  return (tid._) & ENTITY_SLOT_MASK;
+}
+
+static inline uint32_t GET_GENERATION(entity_id_t tid) {
+  return ((tid._) >> ENTITY_SLOT_BITS) & ENTITY_GENERATION_MASK;
+}
+
 static inline entity_id_t TYPE_BROADCAST(entity_type_t type) {
   _ASSERT((type._) <= 0xFF);
   entity_id_t ret = { ._ = (((type._) & 0xFF) << 24) | 0x007FFFFF };
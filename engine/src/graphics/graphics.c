@@ -1,18 +1,40 @@
 #include "graphics.h"
 #include "stars.h"
+#include "lines.h"
+#include "instanced.h"
+#include "render.h"
 #include "entity/entity.h"
 #include "entity/camera.h"
+#include "entity/debris.h"
 #include "platform/platform.h"
 #include "debug/profiler.h"
 
 #include <immintrin.h>
 
-static void _particles_colors(const struct particles_data* pd, color_t* target) {
-  PROFILE_ZONE("_particles_colors");
-  uint16_t* __restrict lifetime_ticks = pd->lifetime_ticks;
-  uint16_t* __restrict lifetime_max = pd->lifetime_max;
+static const render_backend_t batched_backend_ = {
+  "batched",
+  NULL,
+  platform_renderer_draw_stars,
+  lines_draw_models,
+};
 
-  uint16_t* end_life = pd->lifetime_ticks + pd->active;
+static const render_backend_t instanced_backend_ = {
+  "instanced",
+  instanced_frame_start,
+  platform_renderer_draw_stars,
+  instanced_draw_models,
+};
+
+static const render_backend_t* backend_;
+
+// fire-like fade over the remaining lifetime, shared by particles and debris
+static void _lifetime_colors(const uint16_t* lifetime, const uint16_t* lifetime_maximum, uint32_t count,
+                             color_t* target) {
+  PROFILE_ZONE("_lifetime_colors");
+  const uint16_t* __restrict lifetime_ticks = lifetime;
+  const uint16_t* __restrict lifetime_max = lifetime_maximum;
+
+  const uint16_t* end_life = lifetime + count;
 
   __m256 zero = _mm256_setzero_ps();
   __m256 three = _mm256_set1_ps(3.0f);
@@ -78,9 +100,29 @@ static void _graphics_particles_draw(void) {
   // compute colors!
   color_t* colors = (color_t*)pd->temporary;
 
-  _particles_colors(pd, colors);
+  // retired storage [0, first) is skipped (first is a multiple of 16, the view keeps the SoA tiling)
+  uint32_t first = pd->first;
+  uint32_t count = pd->active - first;
+  const position_orientation_t* po = &pd->position_orientation;
+  position_orientation_t live = {
+    po->position_x + first, po->position_y + first, po->orientation_x + first, po->orientation_y + first,
+    po->radius + first,     po->stride,
+  };
+
+  _lifetime_colors(pd->lifetime_ticks + first, pd->lifetime_max + first, count, colors);
 
-  platform_renderer_draw_models(pd->active, colors, &pd->position_orientation, pd->model_idx);
+  render_models(RENDER_LAYER_PARTICLES, count, colors, &live, pd->model_idx + first);
+  PROFILE_ZONE_END();
+}
+
+static void _graphics_debris_draw(void) {
+  PROFILE_ZONE("_graphics_debris_draw");
+  struct debris_data* dd = debris_get();
+  color_t* colors = (color_t*)dd->temporary;
+
+  _lifetime_colors(dd->lifetime_ticks, dd->lifetime_max, dd->active, colors);
+
+  render_models(RENDER_LAYER_DEBRIS, dd->active, colors, &dd->position_orientation, dd->model_idx);
   PROFILE_ZONE_END();
 }
 
@@ -88,7 +130,7 @@ static void _graphics_objects_draw(void) {
   PROFILE_ZONE("_graphics_objects_draw");
   struct objects_data* od = entity_manager_get_objects();
 
-  platform_renderer_draw_models(od->active, NULL, &od->position_orientation, od->model_idx);
+  render_models(RENDER_LAYER_OBJECTS, od->active, NULL, &od->position_orientation, od->model_idx);
   PROFILE_ZONE_END();
 }
 
@@ -96,12 +138,23 @@ static void _graphics_parts_draw(void) {
   PROFILE_ZONE("_graphics_parts_draw");
   struct parts_data* pd = entity_manager_get_parts();
 
-  platform_renderer_draw_models(pd->active, NULL, &pd->world_position_orientation, pd->model_idx);
+  render_models(RENDER_LAYER_PARTS, pd->active, NULL, &pd->world_position_orientation, pd->model_idx);
   PROFILE_ZONE_END();
 }
 
-void graphics_initialize(void) {
+void graphics_initialize(enum graphics_renderer renderer) {
   stars_initialize();
+
+  render_initialize();
+
+  if (renderer == GRAPHICS_RENDERER_NULL) {
+    backend_ = &render_null_backend;
+  } else if (renderer == GRAPHICS_RENDERER_INSTANCED && instanced_initialize()) {
+    backend_ = &instanced_backend_;
+  } else {
+    lines_initialize();
+    backend_ = &batched_backend_;
+  }
 }
 
 void graphics_engine_draw(void) {
@@ -110,12 +163,18 @@ void graphics_engine_draw(void) {
   double cam_x, cam_y;
   camera_get_absolute_position(&cam_x, &cam_y);
 
-  // Draw star background first (behind everything)
+  render_begin();
+
+  // star background, the layer keeps it behind everything
   stars_draw((float)cam_x, (float)cam_y);
 
   _graphics_particles_draw();
+  _graphics_debris_draw();
   _graphics_parts_draw();
   _graphics_objects_draw();
-  
+
+  render_sort();
+  render_submit(backend_);
+
   PROFILE_ZONE_END();
 }
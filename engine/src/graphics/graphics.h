@@ -1,4 +1,12 @@
 #pragma once
 
-void graphics_initialize(void);
+enum graphics_renderer {
+  GRAPHICS_RENDERER_BATCHED = 0, // fixed-function GL, CPU-transformed line batches (graphics/lines.h)
+  GRAPHICS_RENDERER_INSTANCED,   // GL 3.3, model geometry in buffers, instanced draws (graphics/instanced.h)
+  GRAPHICS_RENDERER_NULL,        // no GL calls, the command list only counted (graphics/render.h)
+};
+
+// every renderer consumes the same sorted command list (graphics/render.h),
+// falls back to the batched renderer when the instanced one can't start
+void graphics_initialize(enum graphics_renderer renderer);
 void graphics_engine_draw(void);
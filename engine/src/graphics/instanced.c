@@ -0,0 +1,296 @@
+#include "instanced.h"
+#include "lines.h"
+#include "entity/fracture.h"
+#include "debug/profiler.h"
+
+#include "../generated/models_meta.gen.h"
+
+// every model index there is geometry for: static models, fragment pool slots and cached pattern fragments
+#define INSTANCED_MODEL_KEYS (FRACTURE_CACHE_MODEL_BASE + MODEL_COUNT * FRACTURE_VARIANTS * 8)
+
+// vertex buffer layout: [static lines | static hulls | pattern cache | fragment arena], bases in vertices
+static struct {
+  lines_tables_t tables;
+  uint32_t hull_base;
+  uint32_t cache_base; // = vertices with colors of their own
+  uint32_t arena_base;
+  uint32_t cache_vertices;
+  uint32_t arena_vertices;
+  const int8_t* cache;
+  const int8_t* arena;
+} geometry_;
+
+static uint32_t model_slots_[INSTANCED_MODEL_KEYS]; // instances per model index, then the next free slot
+static instance_batch_t batch_;
+
+static void _geometry_layout(void) {
+  geometry_.tables = lines_tables();
+
+  uint32_t cache_size, arena_size;
+  geometry_.cache = fracture_cache_vertices(&cache_size);
+  geometry_.arena = fragment_arena_vertices(&arena_size);
+  geometry_.cache_vertices = cache_size / 2;
+  geometry_.arena_vertices = arena_size / 2;
+
+  geometry_.hull_base = geometry_.tables.line_total;
+  geometry_.cache_base = geometry_.hull_base + geometry_.tables.hull_total;
+  geometry_.arena_base = geometry_.cache_base + geometry_.cache_vertices;
+}
+
+// false when the model has no lines to draw
+static bool _has_lines(uint16_t model) {
+  if (model < MODEL_COUNT) {
+    for (uint32_t w = 0; w < geometry_.tables.width_count; w++) {
+      if (geometry_.tables.line_count[model][w] > 0) return true;
+    }
+    return false;
+  }
+  uint32_t vertex_count;
+  return model < INSTANCED_MODEL_KEYS && fragment_lines(model, &vertex_count) != NULL && vertex_count > 0;
+}
+
+// a fragment's line range in the vertex buffer (static models have one per stroke width in geometry_.tables),
+// false when there is nothing to draw
+static bool _fragment_range(uint16_t model, uint32_t* first_vertex, uint32_t* vertex_count) {
+  const int8_t* vertices = fragment_lines(model, vertex_count);
+  if (vertices == NULL || *vertex_count == 0) return false;
+
+  if (vertices >= geometry_.cache && vertices < geometry_.cache + geometry_.cache_vertices * 2) {
+    *first_vertex = geometry_.cache_base + (uint32_t)(vertices - geometry_.cache) / 2;
+  } else {
+    *first_vertex = geometry_.arena_base + (uint32_t)(vertices - geometry_.arena) / 2;
+  }
+  return true;
+}
+
+bool instanced_initialize(void) {
+  _geometry_layout();
+
+  uint32_t vertex_count = geometry_.arena_base + geometry_.arena_vertices;
+  if (!platform_renderer_instanced_initialize(vertex_count, geometry_.cache_base, INSTANCED_BATCH)) {
+    return false;
+  }
+
+  // hull fills are black, the one color they need comes with the geometry like the lines' ones
+  uint32_t* black = (uint32_t*)platform_retrieve_memory(geometry_.tables.hull_total * sizeof(uint32_t));
+  for (uint32_t v = 0; v < geometry_.tables.hull_total; v++) {
+    black[v] = 0xFF000000u;
+  }
+
+  platform_renderer_instanced_upload(0, geometry_.tables.line_total, geometry_.tables.line_vertices,
+                                     geometry_.tables.line_colors);
+  platform_renderer_instanced_upload(geometry_.hull_base, geometry_.tables.hull_total, geometry_.tables.hull_vertices,
+                                     black);
+  platform_renderer_instanced_upload(geometry_.cache_base, geometry_.cache_vertices, geometry_.cache, NULL);
+
+  batch_.capacity = INSTANCED_BATCH;
+  batch_.instances = (model_instance_t*)platform_retrieve_memory(INSTANCED_BATCH * sizeof(model_instance_t));
+  batch_.draws =
+      (instanced_draw_t*)platform_retrieve_memory(INSTANCED_DRAWS(INSTANCED_BATCH) * sizeof(instanced_draw_t));
+  return true;
+}
+
+void instanced_frame_start(void) {
+  PROFILE_ZONE("instanced_frame_start");
+  platform_renderer_instanced_upload(geometry_.arena_base, geometry_.arena_vertices, geometry_.arena, NULL);
+  PROFILE_ZONE_END();
+}
+
+size_t instanced_build(instance_batch_t* batch, size_t first, size_t model_count, const color_t* colors,
+                       const position_orientation_t* position_orientation, const uint16_t* model_indices) {
+  PROFILE_ZONE("instanced_build");
+  platform_clear_memory(model_slots_, sizeof(model_slots_));
+  batch->instance_count = 0;
+  batch->draw_count = 0;
+
+  // count the instances of every model index
+  size_t i = first;
+  for (; i < model_count && batch->instance_count < batch->capacity; i++) {
+    uint16_t model = model_indices[i];
+    if (model == 0xFFFF || !_has_lines(model)) continue;
+
+    model_slots_[model]++;
+    batch->instance_count++;
+  }
+  size_t next = i;
+
+  // exclusive prefix sum over the counts, the static models' ranges kept for their draws
+  uint32_t static_first[MODEL_COUNT], static_count[MODEL_COUNT];
+  uint32_t slot = 0;
+  for (uint32_t m = 0; m < INSTANCED_MODEL_KEYS; m++) {
+    uint32_t count = model_slots_[m];
+    if (m < MODEL_COUNT) {
+      static_first[m] = slot;
+      static_count[m] = count;
+    }
+    model_slots_[m] = slot;
+    slot += count;
+  }
+
+  // hull fills first
+  for (uint32_t m = 0; m < MODEL_COUNT; m++) {
+    if (static_count[m] > 0 && geometry_.tables.hull_count[m] > 0) {
+      instanced_draw_t* draw = &batch->draws[batch->draw_count++];
+      draw->first_vertex = geometry_.hull_base + geometry_.tables.hull_start[m];
+      draw->vertex_count = geometry_.tables.hull_count[m];
+      draw->first_instance = static_first[m];
+      draw->instance_count = static_count[m];
+      draw->width = 0.0f;
+      draw->triangles = 1;
+      draw->colored = 1;
+    }
+  }
+
+  // then the lines width by width, one draw per model index in use with lines in that width
+  for (uint32_t w = 0; w < geometry_.tables.width_count; w++) {
+    float width = geometry_.tables.widths[w];
+    for (uint32_t m = 0; m < MODEL_COUNT; m++) {
+      if (static_count[m] == 0 || geometry_.tables.line_count[m][w] == 0) continue;
+
+      instanced_draw_t* draw = &batch->draws[batch->draw_count++];
+      draw->first_vertex = geometry_.tables.line_start[m][w];
+      draw->vertex_count = geometry_.tables.line_count[m][w];
+      draw->first_instance = static_first[m];
+      draw->instance_count = static_count[m];
+      draw->width = width;
+      draw->triangles = 0;
+      draw->colored = 1;
+    }
+
+    if (w != geometry_.tables.fragment_width) continue;
+
+    for (uint32_t m = MODEL_COUNT; m < INSTANCED_MODEL_KEYS; m++) {
+      uint32_t end = m + 1 < INSTANCED_MODEL_KEYS ? model_slots_[m + 1] : slot;
+      uint32_t first_vertex, vertex_count;
+      if (end == model_slots_[m] || !_fragment_range((uint16_t)m, &first_vertex, &vertex_count)) continue;
+
+      instanced_draw_t* draw = &batch->draws[batch->draw_count++];
+      draw->first_vertex = first_vertex;
+      draw->vertex_count = vertex_count;
+      draw->first_instance = model_slots_[m];
+      draw->instance_count = end - model_slots_[m];
+      draw->width = width;
+      draw->triangles = 0;
+      draw->colored = 0;
+    }
+  }
+
+  // scatter the poses into their model's range, in model order within it
+  const color_t white = { 255, 255, 255, 255 };
+  for (i = first; i < next; i++) {
+    uint16_t model = model_indices[i];
+    if (model == 0xFFFF || !_has_lines(model)) continue;
+
+    uint32_t t = tiled_index(position_orientation->stride, (uint32_t)i);
+    model_instance_t* instance = &batch->instances[model_slots_[model]++];
+    instance->x = position_orientation->position_x[t];
+    instance->y = position_orientation->position_y[t];
+    instance->ox = position_orientation->orientation_x[t];
+    instance->oy = position_orientation->orientation_y[t];
+    instance->color = colors ? colors[i] : white;
+  }
+
+  PROFILE_ZONE_END();
+  return next;
+}
+
+void instanced_draw_models(size_t model_count, const color_t* colors,
+                           const position_orientation_t* position_orientation, const uint16_t* model_indices) {
+  PROFILE_ZONE("instanced_draw_models");
+  size_t i = 0;
+  while (i < model_count) {
+    i = instanced_build(&batch_, i, model_count, colors, position_orientation, model_indices);
+    platform_renderer_draw_instanced(batch_.instances, batch_.instance_count, batch_.draws, batch_.draw_count);
+  }
+  PROFILE_ZONE_END();
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+#define TEST_BATCH_INSTANCES 16
+
+static model_instance_t test_instances_[TEST_BATCH_INSTANCES];
+static instanced_draw_t test_draws_[INSTANCED_DRAWS(TEST_BATCH_INSTANCES)];
+
+void instanced_test__instances_grouped_by_model(void) {
+  _geometry_layout();
+
+  instance_batch_t batch = { 0, 0, TEST_BATCH_INSTANCES, test_instances_, test_draws_ };
+
+  // model 0 twice, a cached fragment twice, model 1 once, one skipped slot
+  uint16_t fragment = (uint16_t)FRACTURE_CACHE_MODEL_BASE;
+  uint16_t models[6] = { 0, fragment, 0xFFFF, 0, 1, fragment };
+  float px[6] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f };
+  float py[6] = { 10.0f, 20.0f, 30.0f, 40.0f, 50.0f, 60.0f };
+  float ox[6] = { 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f };
+  float oy[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f };
+  float radius[6] = { 0 };
+  position_orientation_t po = { px, py, ox, oy, radius, 8 };
+
+  size_t next = instanced_build(&batch, 0, 6, NULL, &po, models);
+  TEST_ASSERT_EQUAL_UINT32(6, (uint32_t)next);
+  TEST_ASSERT_EQUAL_UINT32(5, batch.instance_count);
+
+  uint32_t hull_draws = (geometry_.tables.hull_count[0] > 0) + (geometry_.tables.hull_count[1] > 0);
+  uint32_t line_draws = 1; // the fragment
+  for (uint32_t w = 0; w < geometry_.tables.width_count; w++) {
+    line_draws += (geometry_.tables.line_count[0][w] > 0) + (geometry_.tables.line_count[1][w] > 0);
+  }
+  TEST_ASSERT_EQUAL_UINT32(hull_draws + line_draws, batch.draw_count);
+  for (uint32_t d = 0; d < hull_draws; d++) {
+    TEST_ASSERT_EQUAL_UINT8(1, batch.draws[d].triangles);
+  }
+
+  // line draws width by width, every static model's range in its width
+  for (uint32_t d = hull_draws; d < batch.draw_count; d++) {
+    const instanced_draw_t* draw = &batch.draws[d];
+    TEST_ASSERT_EQUAL_UINT8(0, draw->triangles);
+    if (d > hull_draws) {
+      TEST_ASSERT_TRUE(batch.draws[d - 1].width <= draw->width);
+    }
+    if (!draw->colored) continue;
+
+    uint32_t w = 0;
+    while (w < geometry_.tables.width_count && geometry_.tables.widths[w] != draw->width) w++;
+    TEST_ASSERT_TRUE(w < geometry_.tables.width_count);
+    uint32_t m = draw->first_instance == 0 ? 0 : 1;
+    TEST_ASSERT_EQUAL_UINT32(geometry_.tables.line_start[m][w], draw->first_vertex);
+    TEST_ASSERT_EQUAL_UINT32(geometry_.tables.line_count[m][w], draw->vertex_count);
+    TEST_ASSERT_EQUAL_UINT32(m == 0 ? 2 : 1, draw->instance_count);
+  }
+
+  // instances in model order within their range
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, batch.instances[0].x);
+  TEST_ASSERT_EQUAL_FLOAT(4.0f, batch.instances[1].x);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, batch.instances[1].oy);
+  TEST_ASSERT_EQUAL_FLOAT(50.0f, batch.instances[2].y);
+
+  uint32_t fragment_count;
+  const int8_t* fragment_vertices = fragment_lines(fragment, &fragment_count);
+  const instanced_draw_t* pieces = NULL;
+  for (uint32_t d = hull_draws; d < batch.draw_count; d++) {
+    if (!batch.draws[d].colored) pieces = &batch.draws[d];
+  }
+  TEST_ASSERT_NOT_NULL(pieces);
+  TEST_ASSERT_EQUAL_UINT32(geometry_.cache_base + (uint32_t)(fragment_vertices - geometry_.cache) / 2,
+                           pieces->first_vertex);
+  TEST_ASSERT_EQUAL_UINT32(fragment_count, pieces->vertex_count);
+  TEST_ASSERT_EQUAL_UINT32(3, pieces->first_instance);
+  TEST_ASSERT_EQUAL_UINT32(2, pieces->instance_count);
+  TEST_ASSERT_EQUAL_FLOAT(LINES_FRAGMENT_WIDTH, pieces->width);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, batch.instances[3].x);
+  TEST_ASSERT_EQUAL_FLOAT(6.0f, batch.instances[4].x);
+  TEST_ASSERT_EQUAL_UINT8(255, batch.instances[4].color.r);
+
+  // a full batch stops at the first model that doesn't fit
+  batch.capacity = 2;
+  next = instanced_build(&batch, 0, 6, NULL, &po, models);
+  TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)next);
+  TEST_ASSERT_EQUAL_UINT32(2, batch.instance_count);
+  next = instanced_build(&batch, next, 6, NULL, &po, models);
+  TEST_ASSERT_EQUAL_UINT32(5, (uint32_t)next);
+  TEST_ASSERT_EQUAL_UINT32(2, batch.instance_count);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core/core.h"
+#include "platform/platform.h"
+
+// Instanced model rendering (GL 3.3)
+// Model geometry goes to the GPU once: the static models' lines and hull fills (graphics/lines.h tables) and the
+// fracture pattern cache; only the fragment arena is uploaded again, once a frame, as debris breaks during ticks.
+// Per draw only the instances are streamed - pose and heat color gathered from the SoA arrays, grouped by model
+// index with a counting sort - and every model index in use is one instanced draw per stroke width it has lines
+// in (hull fills before lines).
+
+#define INSTANCED_BATCH 16384 // instances per upload
+#define INSTANCED_DRAWS(instances) ((instances) + MODEL_COUNT * (LINES_WIDTHS + 1)) // draws a batch can need
+
+typedef struct {
+  uint32_t instance_count;
+  uint32_t draw_count;
+  uint32_t capacity; // instances, the draws have room for INSTANCED_DRAWS(capacity)
+  model_instance_t* instances;
+  instanced_draw_t* draws;
+} instance_batch_t;
+
+bool instanced_initialize(void); // false when the context can't do GL 3.3
+void instanced_frame_start(void); // uploads the fragment arena
+
+// Groups models [first, model_count) into the batch, as many as fit, and returns the index of the first model left
+// out (model_count when all fit). colors = heat color per model, NULL for white. Models 0xFFFF and fragments
+// that died are skipped. No GL calls, the batch can be drawn or inspected by the caller.
+size_t instanced_build(instance_batch_t* batch, size_t first, size_t model_count, const color_t* colors,
+                       const position_orientation_t* position_orientation, const uint16_t* model_indices);
+
+// Builds and draws the models, batch by batch
+void instanced_draw_models(size_t model_count, const color_t* colors,
+                           const position_orientation_t* position_orientation, const uint16_t* model_indices);
@@ -0,0 +1,435 @@
+#include "lines.h"
+#include "entity/fracture.h"
+#include "platform/platform.h"
+#include "debug/profiler.h"
+
+#include <immintrin.h>
+
+#include "../generated/models_meta.gen.h"
+
+// static models expanded once: GL_LINES pairs with a color per vertex (0 = heat) grouped by stroke width and hull
+// fans as triangles, every range padded to a multiple of 8 vertices so the transform never reads into its neighbour
+static struct {
+  int8_t* line_vertices;
+  uint32_t* line_colors;
+  int8_t* hull_vertices;
+
+  uint32_t line_start[MODEL_COUNT][LINES_WIDTHS];
+  uint32_t line_count[MODEL_COUNT][LINES_WIDTHS];
+  uint32_t hull_start[MODEL_COUNT];
+  uint32_t hull_count[MODEL_COUNT];
+
+  float widths[LINES_WIDTHS];
+  uint32_t width_count;
+  uint32_t fragment_width;
+
+  uint32_t line_total;
+  uint32_t hull_total;
+  bool built;
+} tables_;
+
+static vertex_batch_t lines_[LINES_WIDTHS];
+static vertex_batch_t hulls_;
+
+static inline uint32_t _pad8(uint32_t count) {
+  return (count + 7) & ~7u;
+}
+
+static inline uint32_t _pack_color(color_t color) {
+  return (uint32_t)color.r | (uint32_t)color.g << 8 | (uint32_t)color.b << 16 | (uint32_t)color.a << 24;
+}
+
+static void _widths_add(float width) {
+  uint32_t at = 0;
+  while (at < tables_.width_count && tables_.widths[at] < width) at++;
+  if ((at < tables_.width_count && tables_.widths[at] == width) || tables_.width_count == LINES_WIDTHS) return;
+
+  for (uint32_t w = tables_.width_count; w > at; w--) {
+    tables_.widths[w] = tables_.widths[w - 1];
+  }
+  tables_.widths[at] = width;
+  tables_.width_count++;
+}
+
+// index of the width in use closest to the stroke width
+static uint32_t _width_index(float width) {
+  uint32_t best = 0;
+  float best_distance = 0.0f;
+  for (uint32_t w = 0; w < tables_.width_count; w++) {
+    float distance = tables_.widths[w] > width ? tables_.widths[w] - width : width - tables_.widths[w];
+    if (w == 0 || distance < best_distance) {
+      best = w;
+      best_distance = distance;
+    }
+  }
+  return best;
+}
+
+static void _tables_count(uint32_t model, uint32_t* lines, uint32_t* hulls) {
+  for (uint32_t w = 0; w < LINES_WIDTHS; w++) {
+    lines[w] = 0;
+  }
+  *hulls = 0;
+  for (uint32_t c = 0; c < _model_command_counts[model]; c++) {
+    const DrawCommand* cmd = &_model_commands[model][c];
+    if (cmd->count < 2) continue;
+
+    uint32_t w = _width_index(_model_styles[model][c].width);
+    lines[w] += cmd->type == CMD_LINE_LOOP ? cmd->count * 2u : (cmd->count - 1u) * 2u;
+    if (_model_styles[model][c].hull && cmd->type == CMD_LINE_LOOP && cmd->count >= 3) {
+      *hulls += (cmd->count - 2u) * 3u;
+    }
+  }
+}
+
+static void _tables_fill(uint32_t model) {
+  uint32_t written[LINES_WIDTHS] = { 0 };
+  int8_t* hulls = tables_.hull_vertices + tables_.hull_start[model] * 2;
+
+  for (uint32_t c = 0; c < _model_command_counts[model]; c++) {
+    const DrawCommand* cmd = &_model_commands[model][c];
+    const DrawStyle* style = &_model_styles[model][c];
+    const int8_t* v = _model_vertices[model] + cmd->start * 2;
+    if (cmd->count < 2) continue;
+
+    uint32_t w = _width_index(style->width);
+    int8_t* lines = tables_.line_vertices + (tables_.line_start[model][w] + written[w]) * 2;
+    uint32_t* colors = tables_.line_colors + tables_.line_start[model][w] + written[w];
+
+    uint32_t segments = cmd->type == CMD_LINE_LOOP ? cmd->count : cmd->count - 1u;
+    for (uint32_t s = 0; s < segments; s++) {
+      uint32_t next = (s + 1) % cmd->count;
+      *lines++ = v[s * 2];
+      *lines++ = v[s * 2 + 1];
+      *lines++ = v[next * 2];
+      *lines++ = v[next * 2 + 1];
+      *colors++ = style->color;
+      *colors++ = style->color;
+    }
+    written[w] += segments * 2;
+
+    if (style->hull && cmd->type == CMD_LINE_LOOP && cmd->count >= 3) {
+      for (uint32_t s = 1; s + 1 < cmd->count; s++) {
+        const uint32_t fan[3] = { 0, s, s + 1 };
+        for (uint32_t k = 0; k < 3; k++) {
+          *hulls++ = v[fan[k] * 2];
+          *hulls++ = v[fan[k] * 2 + 1];
+        }
+      }
+    }
+  }
+}
+
+static void _tables_build(void) {
+  if (tables_.built) return;
+
+  tables_.width_count = 0;
+  _widths_add(LINES_FRAGMENT_WIDTH);
+  for (uint32_t m = 0; m < MODEL_COUNT; m++) {
+    for (uint32_t c = 0; c < _model_command_counts[m]; c++) {
+      _widths_add(_model_styles[m][c].width);
+    }
+  }
+  tables_.fragment_width = _width_index(LINES_FRAGMENT_WIDTH);
+
+  uint32_t line_total = 0, hull_total = 0;
+  for (uint32_t m = 0; m < MODEL_COUNT; m++) {
+    _tables_count(m, tables_.line_count[m], &tables_.hull_count[m]);
+    for (uint32_t w = 0; w < LINES_WIDTHS; w++) {
+      tables_.line_start[m][w] = line_total;
+      line_total += _pad8(tables_.line_count[m][w]);
+    }
+    tables_.hull_start[m] = hull_total;
+    hull_total += _pad8(tables_.hull_count[m]);
+  }
+
+  // one extra group keeps the allocations non-empty and the last model's reads inside them
+  line_total += 8;
+  hull_total += 8;
+  tables_.line_vertices = (int8_t*)platform_retrieve_memory(line_total * 2);
+  tables_.line_colors = (uint32_t*)platform_retrieve_memory(line_total * sizeof(uint32_t));
+  tables_.hull_vertices = (int8_t*)platform_retrieve_memory(hull_total * 2);
+  platform_clear_memory(tables_.line_vertices, line_total * 2);
+  platform_clear_memory(tables_.line_colors, line_total * sizeof(uint32_t));
+  platform_clear_memory(tables_.hull_vertices, hull_total * 2);
+
+  for (uint32_t m = 0; m < MODEL_COUNT; m++) {
+    _tables_fill(m);
+  }
+  tables_.line_total = line_total;
+  tables_.hull_total = hull_total;
+  tables_.built = true;
+}
+
+lines_tables_t lines_tables(void) {
+  _tables_build();
+
+  lines_tables_t tables;
+  tables.line_vertices = tables_.line_vertices;
+  tables.line_colors = tables_.line_colors;
+  tables.hull_vertices = tables_.hull_vertices;
+  tables.line_start = tables_.line_start;
+  tables.line_count = tables_.line_count;
+  tables.hull_start = tables_.hull_start;
+  tables.hull_count = tables_.hull_count;
+  tables.widths = tables_.widths;
+  tables.width_count = tables_.width_count;
+  tables.fragment_width = tables_.fragment_width;
+  tables.line_total = tables_.line_total;
+  tables.hull_total = tables_.hull_total;
+  return tables;
+}
+
+void lines_initialize(void) {
+  _tables_build();
+
+  for (uint32_t w = 0; w < tables_.width_count; w++) {
+    lines_[w].capacity = LINES_BATCH_VERTICES;
+    lines_[w].vertices = (float*)platform_retrieve_memory(LINES_BATCH_VERTICES * 2 * sizeof(float));
+    lines_[w].colors = (color_t*)platform_retrieve_memory(LINES_BATCH_VERTICES * sizeof(color_t));
+  }
+  hulls_.capacity = LINES_BATCH_VERTICES;
+  hulls_.vertices = (float*)platform_retrieve_memory(LINES_BATCH_VERTICES * 2 * sizeof(float));
+  hulls_.colors = (color_t*)platform_retrieve_memory(LINES_BATCH_VERTICES * sizeof(color_t));
+}
+
+// model space int8 x,y pairs to world space, 8 vertices per step (count rounded up, the target has the room)
+static inline void _transform(const int8_t* source, uint32_t count, __m256 rot_a, __m256 rot_b, __m256 offset,
+                              float* target) {
+  for (uint32_t v = 0; v < count; v += 8, source += 16, target += 16) {
+    __m128i xy = _mm_loadu_si128((const __m128i*)source); // x0 y0 x1 y1 .. x7 y7
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(xy)); // x0 y0 .. x3 y3
+    __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(xy, 8))); // x4 y4 .. x7 y7
+
+    // x' = ox * x - oy * y + px, y' = ox * y + oy * x + py; the swapped pairs (y x) take the second term
+    lo = _mm256_fmadd_ps(lo, rot_a, _mm256_fmadd_ps(_mm256_permute_ps(lo, _MM_SHUFFLE(2, 3, 0, 1)), rot_b, offset));
+    hi = _mm256_fmadd_ps(hi, rot_a, _mm256_fmadd_ps(_mm256_permute_ps(hi, _MM_SHUFFLE(2, 3, 0, 1)), rot_b, offset));
+
+    _mm256_storeu_ps(target, lo);
+    _mm256_storeu_ps(target + 8, hi);
+  }
+}
+
+// static colors with the heat ones (0) replaced
+static inline void _colors(const uint32_t* source, uint32_t count, __m256i heat, color_t* target) {
+  const __m256i zero = _mm256_setzero_si256();
+  for (uint32_t v = 0; v < count; v += 8, source += 8, target += 8) {
+    __m256i c = _mm256_loadu_si256((const __m256i*)source);
+    c = _mm256_blendv_epi8(c, heat, _mm256_cmpeq_epi32(c, zero));
+    _mm256_storeu_si256((__m256i*)target, c);
+  }
+}
+
+static inline void _fill(uint32_t count, __m256i color, color_t* target) {
+  for (uint32_t v = 0; v < count; v += 8, target += 8) {
+    _mm256_storeu_si256((__m256i*)target, color);
+  }
+}
+
+size_t lines_build(vertex_batch_t* lines, vertex_batch_t* hulls, size_t first, size_t model_count,
+                   const color_t* colors, const position_orientation_t* position_orientation,
+                   const uint16_t* model_indices) {
+  PROFILE_ZONE("lines_build");
+  const __m256 sign = _mm256_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+  const __m256i black = _mm256_set1_epi32((int)0xFF000000u);
+
+  size_t i = first;
+  for (; i < model_count; i++) {
+    uint16_t model = model_indices[i];
+    if (model == 0xFFFF) continue;
+
+    // per width: the model's lines in it, fragments have all theirs in one
+    uint32_t line_counts[LINES_WIDTHS] = { 0 };
+    const int8_t* fragment_vertices = NULL;
+    const int8_t* hull_vertices = NULL;
+    uint32_t hull_count = 0;
+
+    if (model < MODEL_COUNT) {
+      for (uint32_t w = 0; w < tables_.width_count; w++) {
+        line_counts[w] = tables_.line_count[model][w];
+      }
+      hull_vertices = tables_.hull_vertices + tables_.hull_start[model] * 2;
+      hull_count = tables_.hull_count[model];
+    } else {
+      fragment_vertices = fragment_lines(model, &line_counts[tables_.fragment_width]);
+      if (fragment_vertices == NULL) continue;
+    }
+
+    bool fits = hulls->count + _pad8(hull_count) <= hulls->capacity;
+    for (uint32_t w = 0; w < tables_.width_count; w++) {
+      if (lines[w].count + _pad8(line_counts[w]) > lines[w].capacity) fits = false;
+    }
+    if (!fits) break;
+
+    uint32_t t = tiled_index(position_orientation->stride, (uint32_t)i);
+    float px = position_orientation->position_x[t];
+    float py = position_orientation->position_y[t];
+    __m256 rot_a = _mm256_set1_ps(position_orientation->orientation_x[t]);
+    __m256 rot_b = _mm256_mul_ps(sign, _mm256_set1_ps(position_orientation->orientation_y[t]));
+    __m256 offset = _mm256_setr_ps(px, py, px, py, px, py, px, py);
+    __m256i heat = _mm256_set1_epi32(colors ? (int)_pack_color(colors[i]) : -1);
+
+    for (uint32_t w = 0; w < tables_.width_count; w++) {
+      vertex_batch_t* batch = &lines[w];
+      uint32_t line_count = line_counts[w];
+      if (line_count == 0) continue;
+
+      if (fragment_vertices) {
+        _transform(fragment_vertices, line_count, rot_a, rot_b, offset, batch->vertices + batch->count * 2);
+        _fill(line_count, heat, batch->colors + batch->count);
+      } else {
+        uint32_t start = tables_.line_start[model][w];
+        _transform(tables_.line_vertices + start * 2, line_count, rot_a, rot_b, offset,
+                   batch->vertices + batch->count * 2);
+        _colors(tables_.line_colors + start, line_count, heat, batch->colors + batch->count);
+      }
+      batch->count += line_count;
+    }
+
+    if (hull_count) {
+      _transform(hull_vertices, hull_count, rot_a, rot_b, offset, hulls->vertices + hulls->count * 2);
+      _fill(hull_count, black, hulls->colors + hulls->count);
+      hulls->count += hull_count;
+    }
+  }
+
+  PROFILE_ZONE_END();
+  return i;
+}
+
+void lines_draw_models(size_t model_count, const color_t* colors, const position_orientation_t* position_orientation,
+                       const uint16_t* model_indices) {
+  PROFILE_ZONE("lines_draw_models");
+  size_t i = 0;
+  while (i < model_count) {
+    for (uint32_t w = 0; w < tables_.width_count; w++) {
+      lines_[w].count = 0;
+    }
+    hulls_.count = 0;
+
+    size_t next = lines_build(lines_, &hulls_, i, model_count, colors, position_orientation, model_indices);
+    _ASSERT(next > i && "model larger than a whole batch");
+    if (next == i) next++; // skip it rather than spin
+
+    if (hulls_.count > 0) {
+      platform_renderer_draw_triangles(hulls_.count, hulls_.vertices, hulls_.colors);
+    }
+    for (uint32_t w = 0; w < tables_.width_count; w++) {
+      if (lines_[w].count > 0) {
+        platform_renderer_draw_lines(lines_[w].count, lines_[w].vertices, lines_[w].colors, tables_.widths[w]);
+      }
+    }
+    i = next;
+  }
+  PROFILE_ZONE_END();
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+#define TEST_BATCH_VERTICES 256
+
+static __declspec(align(32)) float test_line_vertices_[LINES_WIDTHS][TEST_BATCH_VERTICES * 2];
+static __declspec(align(32)) color_t test_line_colors_[LINES_WIDTHS][TEST_BATCH_VERTICES];
+static __declspec(align(32)) float test_hull_vertices_[TEST_BATCH_VERTICES * 2];
+static __declspec(align(32)) color_t test_hull_colors_[TEST_BATCH_VERTICES];
+
+static void _test_batches_reset(vertex_batch_t* lines, vertex_batch_t* hulls) {
+  for (uint32_t w = 0; w < LINES_WIDTHS; w++) {
+    vertex_batch_t batch = { 0, TEST_BATCH_VERTICES, test_line_vertices_[w], test_line_colors_[w] };
+    lines[w] = batch;
+  }
+  vertex_batch_t hull_batch = { 0, TEST_BATCH_VERTICES, test_hull_vertices_, test_hull_colors_ };
+  *hulls = hull_batch;
+}
+
+void lines_test__models_transform_into_batches(void) {
+  _tables_build();
+
+  vertex_batch_t lines[LINES_WIDTHS];
+  vertex_batch_t hulls;
+  _test_batches_reset(lines, &hulls);
+
+  // every stroke width has its batch, ascending, fragments included
+  TEST_ASSERT_TRUE(tables_.width_count > 0);
+  for (uint32_t w = 1; w < tables_.width_count; w++) {
+    TEST_ASSERT_TRUE(tables_.widths[w - 1] < tables_.widths[w]);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(LINES_FRAGMENT_WIDTH, tables_.widths[tables_.fragment_width]);
+
+  uint32_t segments = 0;
+  for (uint32_t c = 0; c < _model_command_counts[0]; c++) {
+    const DrawCommand* cmd = &_model_commands[0][c];
+    TEST_ASSERT_EQUAL_FLOAT(_model_styles[0][c].width, tables_.widths[_width_index(_model_styles[0][c].width)]);
+    if (cmd->count >= 2) segments += cmd->type == CMD_LINE_LOOP ? cmd->count : cmd->count - 1u;
+  }
+
+  // model 0 turned 90 degrees, a skipped slot, model 0 again unrotated
+  float px[3] = { 100.0f, 0.0f, -50.0f };
+  float py[3] = { 200.0f, 0.0f, 25.0f };
+  float ox[3] = { 0.0f, 1.0f, 1.0f };
+  float oy[3] = { 1.0f, 0.0f, 0.0f };
+  float radius[3] = { 0 };
+  position_orientation_t po = { px, py, ox, oy, radius, 8 };
+  uint16_t models[3] = { 0, 0xFFFF, 0 };
+  color_t heat[3] = { { 10, 20, 30, 40 }, { 0 }, { 50, 60, 70, 80 } };
+
+  size_t next = lines_build(lines, &hulls, 0, 3, heat, &po, models);
+  TEST_ASSERT_EQUAL_UINT32(3, (uint32_t)next);
+  TEST_ASSERT_EQUAL_UINT32(tables_.hull_count[0] * 2, hulls.count);
+
+  uint32_t total = 0;
+  for (uint32_t w = 0; w < tables_.width_count; w++) {
+    uint32_t per_model = tables_.line_count[0][w];
+    TEST_ASSERT_EQUAL_UINT32(per_model * 2, lines[w].count);
+    total += per_model;
+
+    // static colors stay, heat ones take the model's color
+    for (uint32_t k = 0; k < per_model; k++) {
+      uint32_t expected = tables_.line_colors[tables_.line_start[0][w] + k];
+      TEST_ASSERT_EQUAL_HEX32(expected ? expected : _pack_color(heat[0]), _pack_color(lines[w].colors[k]));
+      TEST_ASSERT_EQUAL_HEX32(expected ? expected : _pack_color(heat[2]),
+                              _pack_color(lines[w].colors[per_model + k]));
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(segments * 2, total);
+  for (uint32_t k = 0; k < hulls.count; k++) {
+    TEST_ASSERT_EQUAL_HEX32(0xFF000000u, _pack_color(hulls.colors[k]));
+  }
+
+  // the first command's width starts with its first vertex: (x, y) -> (-y, x) + position
+  uint32_t first_width = _width_index(_model_styles[0][0].width);
+  uint32_t first_count = tables_.line_count[0][first_width];
+  const int8_t* v = _model_vertices[0] + _model_commands[0][0].start * 2;
+  TEST_ASSERT_EQUAL_FLOAT(100.0f - (float)v[1], lines[first_width].vertices[0]);
+  TEST_ASSERT_EQUAL_FLOAT(200.0f + (float)v[0], lines[first_width].vertices[1]);
+  TEST_ASSERT_EQUAL_FLOAT(-50.0f + (float)v[0], lines[first_width].vertices[first_count * 2]);
+  TEST_ASSERT_EQUAL_FLOAT(25.0f + (float)v[1], lines[first_width].vertices[first_count * 2 + 1]);
+
+  // a cached fragment is all heat, in the fragment width
+  uint16_t fragment = (uint16_t)FRACTURE_CACHE_MODEL_BASE;
+  uint32_t fragment_count;
+  const int8_t* fragment_vertices = fragment_lines(fragment, &fragment_count);
+  TEST_ASSERT_NOT_NULL(fragment_vertices);
+  TEST_ASSERT_TRUE(fragment_count > 0);
+
+  _test_batches_reset(lines, &hulls);
+  next = lines_build(lines, &hulls, 0, 1, NULL, &po, &fragment);
+  TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)next);
+  vertex_batch_t* fragments = &lines[tables_.fragment_width];
+  TEST_ASSERT_EQUAL_UINT32(fragment_count, fragments->count);
+  TEST_ASSERT_EQUAL_FLOAT(100.0f - (float)fragment_vertices[1], fragments->vertices[0]);
+  TEST_ASSERT_EQUAL_FLOAT(200.0f + (float)fragment_vertices[0], fragments->vertices[1]);
+  for (uint32_t k = 0; k < fragment_count; k++) {
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFFu, _pack_color(fragments->colors[k]));
+  }
+
+  // a batch without room for the next model stops there
+  _test_batches_reset(lines, &hulls);
+  lines[first_width].capacity = _pad8(first_count);
+  next = lines_build(lines, &hulls, 0, 3, heat, &po, models);
+  TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)next);
+  TEST_ASSERT_EQUAL_UINT32(first_count, lines[first_width].count);
+}
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/core.h"
+
+// Batched model rendering
+// Model outlines are transformed to world space on the CPU (8 vertices per AVX2 step, one pose per model) and
+// appended to a shared vertex/color buffer as line pairs, hull fills go to a second buffer as triangles. A full
+// buffer is one glDrawArrays call, instead of a matrix push and a generated draw function per model. Lines are
+// split into one buffer per stroke width in use, each drawn at its glLineWidth.
+
+#define LINES_BATCH_VERTICES 32768 // per draw call
+#define LINES_WIDTHS 8             // distinct stroke widths, wider ones than the last are drawn at the closest
+#define LINES_FRAGMENT_WIDTH 2.0f  // fracture fragments have no style of their own
+
+typedef struct {
+  uint32_t count; // vertices
+  uint32_t capacity;
+  float* vertices; // interleaved x,y
+  color_t* colors;
+} vertex_batch_t;
+
+void lines_initialize(void); // expands the static models' draw commands into line and hull triangle tables
+
+// The expanded static models, for renderers that upload them once: per model index (and stroke width for the
+// lines) a start and a count in vertices (starts are multiples of 8), line colors are packed color_t with
+// 0 = heat, hull vertices are all black
+typedef struct {
+  const int8_t* line_vertices;
+  const uint32_t* line_colors;
+  const int8_t* hull_vertices;
+  const uint32_t (*line_start)[LINES_WIDTHS]; // [model][width]
+  const uint32_t (*line_count)[LINES_WIDTHS];
+  const uint32_t* hull_start;
+  const uint32_t* hull_count;
+  const float* widths; // stroke widths in use, ascending
+  uint32_t width_count;
+  uint32_t fragment_width; // index into widths
+  uint32_t line_total;     // table sizes in vertices, padding included
+  uint32_t hull_total;
+} lines_tables_t;
+
+lines_tables_t lines_tables(void); // builds the tables on first use
+
+// Appends models [first, model_count) to the batches (lines = outlines, one batch per lines_tables() width,
+// hulls = black fills), stops at the first one that doesn't fit and returns its index (model_count when all did).
+// colors = heat color per model, NULL for white. Models 0xFFFF are skipped. No GL calls, the buffers can be drawn
+// or inspected by the caller.
+size_t lines_build(vertex_batch_t* lines, vertex_batch_t* hulls, size_t first, size_t model_count,
+                   const color_t* colors, const position_orientation_t* position_orientation,
+                   const uint16_t* model_indices);
+
+// Builds and draws the models, hulls before lines, batch by batch and width by width
+void lines_draw_models(size_t model_count, const color_t* colors, const position_orientation_t* position_orientation,
+                       const uint16_t* model_indices);
@@ -0,0 +1,366 @@
+#include "render.h"
+#include "core/columns.h"
+#include "platform/platform.h"
+#include "debug/profiler.h"
+
+static struct {
+  uint32_t count;
+  uint32_t capacity;
+
+  uint64_t* keys;
+  uint32_t* order; // command index, sorted along with the keys
+  uint64_t* keys_scratch;
+  uint32_t* order_scratch;
+
+  // model commands as recorded
+  float* x;
+  float* y;
+  float* ox;
+  float* oy;
+  color_t* color;
+  uint16_t* model;
+
+  // the same in sorted order, what the backend gets
+  float* sorted_x;
+  float* sorted_y;
+  float* sorted_ox;
+  float* sorted_oy;
+  color_t* sorted_color;
+  uint16_t* sorted_model;
+
+  struct {
+    size_t count;
+    const float* vertices;
+    const color_t* colors;
+  } points[RENDER_MAX_POINT_BATCHES];
+  uint32_t point_batches;
+} commands_;
+
+static column_set_t command_columns_;
+static bool initialized_;
+
+static render_null_stats_t null_stats_;
+
+void render_initialize(void) {
+  if (initialized_) return;
+
+  column_set_t* set = &command_columns_;
+  column_set_initialize(set, RENDER_MAX_COMMANDS);
+  column_set_add(set, (void**)&commands_.keys, sizeof(uint64_t));
+  column_set_add(set, (void**)&commands_.order, sizeof(uint32_t));
+  column_set_add(set, (void**)&commands_.keys_scratch, sizeof(uint64_t));
+  column_set_add(set, (void**)&commands_.order_scratch, sizeof(uint32_t));
+  column_set_add(set, (void**)&commands_.x, sizeof(float));
+  column_set_add(set, (void**)&commands_.y, sizeof(float));
+  column_set_add(set, (void**)&commands_.ox, sizeof(float));
+  column_set_add(set, (void**)&commands_.oy, sizeof(float));
+  column_set_add(set, (void**)&commands_.color, sizeof(color_t));
+  column_set_add(set, (void**)&commands_.model, sizeof(uint16_t));
+  column_set_add(set, (void**)&commands_.sorted_x, sizeof(float));
+  column_set_add(set, (void**)&commands_.sorted_y, sizeof(float));
+  column_set_add(set, (void**)&commands_.sorted_ox, sizeof(float));
+  column_set_add(set, (void**)&commands_.sorted_oy, sizeof(float));
+  column_set_add(set, (void**)&commands_.sorted_color, sizeof(color_t));
+  column_set_add(set, (void**)&commands_.sorted_model, sizeof(uint16_t));
+  commands_.capacity = set->capacity;
+
+  initialized_ = true;
+}
+
+void render_begin(void) {
+  commands_.count = 0;
+  commands_.point_batches = 0;
+}
+
+// returns how many of the count commands fit, past RENDER_MAX_COMMANDS the rest of the frame is cut
+static uint32_t _reserve(uint32_t count) {
+  if (commands_.count + count > commands_.capacity) {
+    commands_.capacity = column_set_reserve(&command_columns_, commands_.count + count);
+  }
+  uint32_t room = commands_.capacity - commands_.count;
+  return count < room ? count : room;
+}
+
+void render_points(uint8_t layer, size_t count, const float* vertices, const color_t* colors) {
+  _ASSERT(commands_.point_batches < RENDER_MAX_POINT_BATCHES);
+  if (count == 0 || commands_.point_batches >= RENDER_MAX_POINT_BATCHES || _reserve(1) == 0) return;
+
+  uint32_t batch = commands_.point_batches++;
+  commands_.points[batch].count = count;
+  commands_.points[batch].vertices = vertices;
+  commands_.points[batch].colors = colors;
+
+  const color_t none = { 0, 0, 0, 0 };
+  uint32_t c = commands_.count++;
+  commands_.keys[c] = render_key(layer, (uint16_t)batch, none, RENDER_COMMAND_POINTS);
+  commands_.order[c] = c;
+}
+
+void render_models(uint8_t layer, size_t model_count, const color_t* colors,
+                   const position_orientation_t* position_orientation, const uint16_t* model_indices) {
+  PROFILE_ZONE("render_models");
+  model_count = _reserve((uint32_t)model_count);
+
+  const color_t white = { 255, 255, 255, 255 };
+  uint32_t c = commands_.count;
+  for (size_t i = 0; i < model_count; i++) {
+    uint16_t model = model_indices[i];
+    if (model == 0xFFFF) continue;
+
+    uint32_t t = tiled_index(position_orientation->stride, (uint32_t)i);
+    color_t color = colors ? colors[i] : white;
+
+    commands_.keys[c] = render_key(layer, model, color, RENDER_COMMAND_MODEL);
+    commands_.order[c] = c;
+    commands_.x[c] = position_orientation->position_x[t];
+    commands_.y[c] = position_orientation->position_y[t];
+    commands_.ox[c] = position_orientation->orientation_x[t];
+    commands_.oy[c] = position_orientation->orientation_y[t];
+    commands_.color[c] = color;
+    commands_.model[c] = model;
+    c++;
+  }
+  commands_.count = c;
+  PROFILE_ZONE_END();
+}
+
+void render_radix_sort(uint64_t* keys, uint32_t* values, uint64_t* keys_scratch, uint32_t* values_scratch,
+                       uint32_t count) {
+  static uint32_t histogram[8][256];
+  if (count < 2) return;
+
+  // all eight byte histograms in one read
+  platform_clear_memory(histogram, sizeof(histogram));
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t key = keys[i];
+    for (uint32_t b = 0; b < 8; b++) {
+      histogram[b][(key >> (b * 8)) & 0xFF]++;
+    }
+  }
+
+  uint64_t* source_keys = keys;
+  uint32_t* source_values = values;
+  uint64_t* target_keys = keys_scratch;
+  uint32_t* target_values = values_scratch;
+
+  for (uint32_t b = 0; b < 8; b++) {
+    uint32_t shift = b * 8;
+    uint32_t* h = histogram[b];
+
+    // every key has the same byte here, the pass wouldn't move anything
+    if (h[(source_keys[0] >> shift) & 0xFF] == count) continue;
+
+    uint32_t sum = 0;
+    for (uint32_t d = 0; d < 256; d++) {
+      uint32_t n = h[d];
+      h[d] = sum;
+      sum += n;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+      uint64_t key = source_keys[i];
+      uint32_t slot = h[(key >> shift) & 0xFF]++;
+      target_keys[slot] = key;
+      target_values[slot] = source_values[i];
+    }
+
+    uint64_t* swap_keys = source_keys;
+    source_keys = target_keys;
+    target_keys = swap_keys;
+    uint32_t* swap_values = source_values;
+    source_values = target_values;
+    target_values = swap_values;
+  }
+
+  if (source_keys != keys) {
+    platform_copy_memory(keys, source_keys, count * sizeof(uint64_t));
+    platform_copy_memory(values, source_values, count * sizeof(uint32_t));
+  }
+}
+
+void render_sort(void) {
+  PROFILE_ZONE("render_sort");
+  uint32_t count = commands_.count;
+  render_radix_sort(commands_.keys, commands_.order, commands_.keys_scratch, commands_.order_scratch, count);
+
+  // point commands gather zeros, nothing reads them
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t c = commands_.order[i];
+    commands_.sorted_x[i] = commands_.x[c];
+    commands_.sorted_y[i] = commands_.y[c];
+    commands_.sorted_ox[i] = commands_.ox[c];
+    commands_.sorted_oy[i] = commands_.oy[c];
+    commands_.sorted_color[i] = commands_.color[c];
+    commands_.sorted_model[i] = commands_.model[c];
+  }
+  PROFILE_ZONE_END();
+}
+
+void render_submit(const render_backend_t* backend) {
+  PROFILE_ZONE("render_submit");
+  if (backend->frame_start) {
+    backend->frame_start();
+  }
+
+  uint32_t i = 0;
+  while (i < commands_.count) {
+    uint64_t key = commands_.keys[i];
+
+    if ((key & 0xFF) == RENDER_COMMAND_POINTS) {
+      uint32_t batch = (uint32_t)(key >> 40) & 0xFFFF;
+      backend->draw_points(commands_.points[batch].count, commands_.points[batch].vertices,
+                           commands_.points[batch].colors);
+      i++;
+      continue;
+    }
+
+    // a run of model commands in one layer
+    uint32_t end = i + 1;
+    while (end < commands_.count && commands_.keys[end] >> 56 == key >> 56 &&
+           (commands_.keys[end] & 0xFF) == RENDER_COMMAND_MODEL) {
+      end++;
+    }
+
+    position_orientation_t run = {
+      commands_.sorted_x + i, commands_.sorted_y + i, commands_.sorted_ox + i, commands_.sorted_oy + i, NULL, 8,
+    };
+    backend->draw_models(end - i, commands_.sorted_color + i, &run, commands_.sorted_model + i);
+    i = end;
+  }
+  PROFILE_ZONE_END();
+}
+
+static void _null_frame_start(void) {
+  null_stats_.frames++;
+}
+
+static void _null_draw_points(size_t count, const float* vertices, const color_t* colors) {
+  (void)vertices;
+  (void)colors;
+  null_stats_.point_batches++;
+  null_stats_.points += (uint32_t)count;
+}
+
+static void _null_draw_models(size_t model_count, const color_t* colors,
+                              const position_orientation_t* position_orientation, const uint16_t* model_indices) {
+  (void)colors;
+  (void)position_orientation;
+  null_stats_.model_runs++;
+  null_stats_.models += (uint32_t)model_count;
+  for (size_t i = 0; i < model_count; i++) {
+    if (i == 0 || model_indices[i] != model_indices[i - 1]) {
+      null_stats_.model_batches++;
+    }
+  }
+}
+
+const render_backend_t render_null_backend = {
+  "null",
+  _null_frame_start,
+  _null_draw_points,
+  _null_draw_models,
+};
+
+render_null_stats_t* render_null_stats(void) {
+  return &null_stats_;
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+#define TEST_SORT_COUNT 1000
+
+static uint64_t test_keys_[TEST_SORT_COUNT];
+static uint32_t test_values_[TEST_SORT_COUNT];
+static uint64_t test_keys_scratch_[TEST_SORT_COUNT];
+static uint32_t test_values_scratch_[TEST_SORT_COUNT];
+
+void render_test__radix_sort_is_stable(void) {
+  // few distinct keys spread over the high and low bytes, values remember the input order
+  uint32_t state = 12345;
+  for (uint32_t i = 0; i < TEST_SORT_COUNT; i++) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    test_keys_[i] = (uint64_t)(state & 7) << 56 | (uint64_t)((state >> 3) & 3) << 40 | ((state >> 5) & 1);
+    test_values_[i] = i;
+  }
+
+  render_radix_sort(test_keys_, test_values_, test_keys_scratch_, test_values_scratch_, TEST_SORT_COUNT);
+
+  for (uint32_t i = 1; i < TEST_SORT_COUNT; i++) {
+    TEST_ASSERT_TRUE(test_keys_[i - 1] <= test_keys_[i]);
+    if (test_keys_[i - 1] == test_keys_[i]) {
+      TEST_ASSERT_TRUE(test_values_[i - 1] < test_values_[i]);
+    }
+  }
+}
+
+// records what a backend is given, in order
+static uint32_t test_draw_layers_[8];
+static uint32_t test_draws_;
+
+static void _test_draw_points(size_t count, const float* vertices, const color_t* colors) {
+  (void)vertices;
+  (void)colors;
+  test_draw_layers_[test_draws_++] = (uint32_t)count;
+}
+
+static void _test_draw_models(size_t model_count, const color_t* colors,
+                              const position_orientation_t* position_orientation, const uint16_t* model_indices) {
+  // sorted by model, then color; the poses travel with their models
+  for (size_t i = 1; i < model_count; i++) {
+    TEST_ASSERT_TRUE(model_indices[i - 1] <= model_indices[i]);
+    if (model_indices[i - 1] == model_indices[i]) {
+      TEST_ASSERT_TRUE(colors[i - 1].r <= colors[i].r);
+    }
+  }
+  for (size_t i = 0; i < model_count; i++) {
+    TEST_ASSERT_EQUAL_FLOAT((float)model_indices[i], position_orientation->orientation_y[i]);
+  }
+  test_draw_layers_[test_draws_++] = (uint32_t)(1000 + model_count);
+}
+
+void render_test__frame_sorted_by_layer_and_model(void) {
+  render_initialize();
+  render_begin();
+
+  // objects recorded before stars and particles, models out of order, one slot empty
+  float px[5] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+  float py[5] = { 0 };
+  float ox[5] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+  float oy[5] = { 3.0f, 1.0f, 3.0f, 3.0f, 1.0f }; // = model, checked after the sort
+  float radius[5] = { 0 };
+  position_orientation_t po = { px, py, ox, oy, radius, 8 };
+  uint16_t objects[5] = { 3, 1, 0xFFFF, 3, 1 };
+  uint16_t particles[3] = { 3, 1, 3 };
+  color_t heat[3] = { { 200, 0, 0, 0 }, { 0 }, { 100, 0, 0, 0 } };
+  float stars[4] = { 0 };
+  color_t star_colors[2] = { { 0 } };
+
+  render_models(RENDER_LAYER_OBJECTS, 5, NULL, &po, objects);
+  render_points(RENDER_LAYER_STARS, 2, stars, star_colors);
+  render_models(RENDER_LAYER_PARTICLES, 3, heat, &po, particles);
+  render_sort();
+
+  render_backend_t recorder = { "test", NULL, _test_draw_points, _test_draw_models };
+  test_draws_ = 0;
+  render_submit(&recorder);
+
+  TEST_ASSERT_EQUAL_UINT32(3, test_draws_);
+  TEST_ASSERT_EQUAL_UINT32(2, test_draw_layers_[0]);    // stars first
+  TEST_ASSERT_EQUAL_UINT32(1003, test_draw_layers_[1]); // particles
+  TEST_ASSERT_EQUAL_UINT32(1004, test_draw_layers_[2]); // objects, the empty slot left out
+
+  render_null_stats_t* stats = render_null_stats();
+  platform_clear_memory(stats, sizeof(*stats));
+  render_submit(&render_null_backend);
+  TEST_ASSERT_EQUAL_UINT32(1, stats->frames);
+  TEST_ASSERT_EQUAL_UINT32(1, stats->point_batches);
+  TEST_ASSERT_EQUAL_UINT32(2, stats->points);
+  TEST_ASSERT_EQUAL_UINT32(2, stats->model_runs);
+  TEST_ASSERT_EQUAL_UINT32(4, stats->model_batches); // particles and objects, models 1 and 3 each
+  TEST_ASSERT_EQUAL_UINT32(7, stats->models);
+}
+
+#endif
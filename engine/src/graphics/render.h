@@ -0,0 +1,79 @@
+#pragma once
+
+#include "core/core.h"
+
+//
+// Render command list
+//
+// graphics_engine_draw doesn't draw: every model instance (and every point batch) of the frame becomes a command
+// with a 64-bit sort key, the list is radix sorted (LSD, 8 bits a pass, passes over a byte all keys share are
+// skipped) and the sorted commands are handed to a backend run by run. The GL backends turn runs into draw calls,
+// the null backend only counts them - the whole frame pipeline runs without a GL context.
+//
+// Usage (once a frame):
+//   render_begin()
+//   render_points(...) / render_models(...) - any order, the layer in the key orders them
+//   render_sort()
+//   render_submit(backend)
+//
+
+#define RENDER_MAX_COMMANDS (1 << 20)
+#define RENDER_MAX_POINT_BATCHES 8
+
+enum render_layer {
+  RENDER_LAYER_STARS = 0,
+  RENDER_LAYER_PARTICLES,
+  RENDER_LAYER_DEBRIS,
+  RENDER_LAYER_PARTS,
+  RENDER_LAYER_OBJECTS,
+};
+
+enum render_command {
+  RENDER_COMMAND_MODEL = 0, // one model instance
+  RENDER_COMMAND_POINTS,    // a point batch, its index takes the model bits
+};
+
+// layer (8 bits) | model (16) | color r, g, b, a (32) | command (8), most significant first
+static inline uint64_t render_key(uint8_t layer, uint16_t model, color_t color, uint8_t command) {
+  uint32_t rgba = (uint32_t)color.r << 24 | (uint32_t)color.g << 16 | (uint32_t)color.b << 8 | color.a;
+  return (uint64_t)layer << 56 | (uint64_t)model << 40 | (uint64_t)rgba << 8 | command;
+}
+
+// A backend consumes the sorted list: draw_points for every point batch, draw_models for every run of model
+// commands in one layer (sorted by model, then color; poses untiled, stride 8)
+typedef struct {
+  const char* name;
+  void (*frame_start)(void); // optional, before the first draw of a frame
+  void (*draw_points)(size_t count, const float* vertices, const color_t* colors);
+  void (*draw_models)(size_t model_count, const color_t* colors, const position_orientation_t* position_orientation,
+                      const uint16_t* model_indices);
+} render_backend_t;
+
+void render_initialize(void);
+void render_begin(void);
+
+// the vertices and colors are read at submit, they have to stay valid until then
+void render_points(uint8_t layer, size_t count, const float* vertices, const color_t* colors);
+// colors = heat color per model, NULL for white; models 0xFFFF are left out
+void render_models(uint8_t layer, size_t model_count, const color_t* colors,
+                   const position_orientation_t* position_orientation, const uint16_t* model_indices);
+
+void render_sort(void);
+void render_submit(const render_backend_t* backend);
+
+// sorts keys with their values (stable), *_scratch have room for count elements
+void render_radix_sort(uint64_t* keys, uint32_t* values, uint64_t* keys_scratch, uint32_t* values_scratch,
+                       uint32_t count);
+
+// Null backend: draws nothing, counts what a GL backend would be given
+typedef struct {
+  uint32_t frames;
+  uint32_t point_batches;
+  uint32_t points;
+  uint32_t model_runs;    // draw_models calls
+  uint32_t model_batches; // runs of one model index inside them (instanced draws)
+  uint32_t models;
+} render_null_stats_t;
+
+extern const render_backend_t render_null_backend;
+render_null_stats_t* render_null_stats(void); // the counters since start, clear them to restart
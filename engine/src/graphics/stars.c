@@ -1,12 +1,25 @@
 #include "stars.h"
+#include "render.h"
 #include "platform/platform.h"
 #include "debug/profiler.h"
 
+#include <immintrin.h>
+
 // Configuration
 #define CHUNK_SIZE 128
 #define STARS_PER_CHUNK 16
 #define NUM_LAYERS 3
-#define MAX_VISIBLE_STARS 2048
+
+// Chunks one layer can have in view: the window plus a chunk of margin on each side, +2 for the partial ones
+#define VISIBLE_CHUNKS_X ((WINDOW_WIDTH + 2 * CHUNK_SIZE) / CHUNK_SIZE + 2)
+#define VISIBLE_CHUNKS_Y ((WINDOW_HEIGHT + 2 * CHUNK_SIZE) / CHUNK_SIZE + 2)
+#define VISIBLE_CHUNKS (NUM_LAYERS * VISIBLE_CHUNKS_X * VISIBLE_CHUNKS_Y)
+#define MAX_VISIBLE_STARS (VISIBLE_CHUNKS * STARS_PER_CHUNK)
+
+// Twice what is in view, so the least recently used chunk is never one of this frame
+#define CHUNK_CACHE_SIZE (2 * VISIBLE_CHUNKS)
+#define CHUNK_HASH_BUCKETS 1024 // power of two
+#define CHUNK_NONE 0xFFFFFFFFu
 
 // Parallax speeds for each layer (0 = farthest, 2 = closest)
 static const float layer_speeds_[NUM_LAYERS] = { 0.1f, 0.3f, 0.5f };
@@ -15,7 +28,37 @@ static const float layer_speeds_[NUM_LAYERS] = { 0.1f, 0.3f, 0.5f };
 static const uint8_t layer_min_alpha_[NUM_LAYERS] = { 60, 120, 200 };
 static const uint8_t layer_max_alpha_[NUM_LAYERS] = { 100, 180, 255 };
 
-// Star buffers (format for glDrawArrays)
+// Generated chunks, LRU keyed by (cx, cy, layer). Stars are kept in world coordinates of their layer, only the
+// camera offset and the screen culling are applied per frame.
+static struct {
+  int32_t cx[CHUNK_CACHE_SIZE];
+  int32_t cy[CHUNK_CACHE_SIZE];
+  uint32_t layer[CHUNK_CACHE_SIZE];
+
+  uint32_t bucket_next[CHUNK_CACHE_SIZE]; // hash chain
+  uint32_t newer[CHUNK_CACHE_SIZE];       // LRU list, CHUNK_NONE ends it
+  uint32_t older[CHUNK_CACHE_SIZE];
+  uint32_t newest;
+  uint32_t oldest;
+  uint32_t used;
+
+  float x[CHUNK_CACHE_SIZE][STARS_PER_CHUNK];
+  float y[CHUNK_CACHE_SIZE][STARS_PER_CHUNK];
+  color_t color[CHUNK_CACHE_SIZE][STARS_PER_CHUNK];
+} chunks_;
+
+static uint32_t buckets_[CHUNK_HASH_BUCKETS];
+
+// chunks in view this frame (in layer order) and the ones of them that have to be generated
+static uint32_t visible_[VISIBLE_CHUNKS];
+static uint32_t visible_count_[NUM_LAYERS];
+static uint32_t build_[VISIBLE_CHUNKS];
+static uint32_t build_count_;
+
+// lane indices of the set bits of an 8-bit mask packed to the front, one byte per lane
+static uint64_t pack_lanes_[256];
+
+// Star buffers (format for glDrawArrays), 8 stars of slack for the SIMD stores
 static float* star_vertices_;   // interleaved x,y pairs
 static color_t* star_colors_;   // RGBA per star
 static size_t star_count_;
@@ -29,63 +72,206 @@ static inline uint32_t chunk_hash(int32_t cx, int32_t cy, int32_t layer) {
   return h ^ (h >> 16);
 }
 
-// Fast xorshift for star generation within chunk
-static inline uint32_t xorshift32(uint32_t* state) {
-  uint32_t x = *state;
-  x ^= x << 13;
-  x ^= x >> 17;
-  x ^= x << 5;
+// Fast xorshift for star generation within chunk, one chunk per lane
+static inline __m256i xorshift32x8(__m256i* state) {
+  __m256i x = *state;
+  x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+  x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
   *state = x;
   return x;
 }
 
+static void _pack_lanes_initialize(void) {
+  for (uint32_t mask = 0; mask < 256; mask++) {
+    uint64_t lanes = 0;
+    uint32_t packed = 0;
+    for (uint32_t lane = 0; lane < 8; lane++) {
+      if (mask & (1u << lane)) {
+        lanes |= (uint64_t)lane << (8 * packed++);
+      }
+    }
+    pack_lanes_[mask] = lanes;
+  }
+}
+
 void stars_initialize(void) {
   // Allocate star buffers
-  star_vertices_ = (float*)platform_retrieve_memory(MAX_VISIBLE_STARS * 2 * sizeof(float));
-  star_colors_ = (color_t*)platform_retrieve_memory(MAX_VISIBLE_STARS * sizeof(color_t));
+  star_vertices_ = (float*)platform_retrieve_memory((MAX_VISIBLE_STARS + 8) * 2 * sizeof(float));
+  star_colors_ = (color_t*)platform_retrieve_memory((MAX_VISIBLE_STARS + 8) * sizeof(color_t));
+
+  for (uint32_t b = 0; b < CHUNK_HASH_BUCKETS; b++) {
+    buckets_[b] = CHUNK_NONE;
+  }
+  chunks_.newest = CHUNK_NONE;
+  chunks_.oldest = CHUNK_NONE;
+  chunks_.used = 0;
+
+  _pack_lanes_initialize();
+}
+
+static void _lru_unlink(uint32_t slot) {
+  uint32_t newer = chunks_.newer[slot];
+  uint32_t older = chunks_.older[slot];
+  if (newer != CHUNK_NONE) {
+    chunks_.older[newer] = older;
+  } else {
+    chunks_.newest = older;
+  }
+  if (older != CHUNK_NONE) {
+    chunks_.newer[older] = newer;
+  } else {
+    chunks_.oldest = newer;
+  }
+}
+
+static void _lru_push_newest(uint32_t slot) {
+  chunks_.newer[slot] = CHUNK_NONE;
+  chunks_.older[slot] = chunks_.newest;
+  if (chunks_.newest != CHUNK_NONE) {
+    chunks_.newer[chunks_.newest] = slot;
+  } else {
+    chunks_.oldest = slot;
+  }
+  chunks_.newest = slot;
+}
+
+static void _bucket_remove(uint32_t slot) {
+  uint32_t* link = &buckets_[chunk_hash(chunks_.cx[slot], chunks_.cy[slot], chunks_.layer[slot]) &
+                             (CHUNK_HASH_BUCKETS - 1)];
+  while (*link != slot) {
+    link = &chunks_.bucket_next[*link];
+  }
+  *link = chunks_.bucket_next[slot];
 }
 
-// Generate stars for a single chunk and add to buffer
-static void generate_chunk_stars(int32_t cx, int32_t cy, int32_t layer,
-                                  float offset_x, float offset_y,
-                                  uint8_t min_alpha, uint8_t max_alpha) {
-  if (star_count_ + STARS_PER_CHUNK > MAX_VISIBLE_STARS)
-    return;
+// The cached chunk's slot; a chunk not in the cache takes the least recently used slot and is queued for building
+static uint32_t _chunk_acquire(int32_t cx, int32_t cy, uint32_t layer) {
+  uint32_t* bucket = &buckets_[chunk_hash(cx, cy, layer) & (CHUNK_HASH_BUCKETS - 1)];
+  for (uint32_t slot = *bucket; slot != CHUNK_NONE; slot = chunks_.bucket_next[slot]) {
+    if (chunks_.cx[slot] == cx && chunks_.cy[slot] == cy && chunks_.layer[slot] == layer) {
+      _lru_unlink(slot);
+      _lru_push_newest(slot);
+      return slot;
+    }
+  }
+
+  uint32_t slot;
+  if (chunks_.used < CHUNK_CACHE_SIZE) {
+    slot = chunks_.used++;
+  } else {
+    slot = chunks_.oldest;
+    _lru_unlink(slot);
+    _bucket_remove(slot);
+  }
 
-  uint32_t seed = chunk_hash(cx, cy, layer);
+  chunks_.cx[slot] = cx;
+  chunks_.cy[slot] = cy;
+  chunks_.layer[slot] = layer;
+  chunks_.bucket_next[slot] = *bucket;
+  *bucket = slot;
+  _lru_push_newest(slot);
 
-  float chunk_world_x = (float)(cx * CHUNK_SIZE);
-  float chunk_world_y = (float)(cy * CHUNK_SIZE);
+  build_[build_count_++] = slot;
+  return slot;
+}
 
-  uint8_t alpha_range = max_alpha - min_alpha;
-  float norm = (float)CHUNK_SIZE / 65536.0f;
+// Generates the queued chunks, 8 at once with one chunk's xorshift stream per lane
+static void _build_chunks(void) {
+  PROFILE_ZONE("_build_chunks");
+  const __m256 norm = _mm256_set1_ps((float)CHUNK_SIZE / 65536.0f);
+  const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+  const __m256i white = _mm256_set1_epi32(0x00FFFFFF);
 
-  for (int i = 0; i < STARS_PER_CHUNK; i++) {
-    // Use lower 16 bits for position (0-65535 -> 0-CHUNK_SIZE)
-    uint32_t rx = xorshift32(&seed);
-    uint32_t ry = xorshift32(&seed);
+  float x[STARS_PER_CHUNK][8];
+  float y[STARS_PER_CHUNK][8];
+  uint32_t color[STARS_PER_CHUNK][8];
 
-    float screen_x = chunk_world_x + (float)(rx & 0xFFFF) * norm - offset_x;
-    float screen_y = chunk_world_y + (float)(ry & 0xFFFF) * norm - offset_y;
+  for (uint32_t i = 0; i < build_count_; i += 8) {
+    uint32_t lanes = build_count_ - i < 8 ? build_count_ - i : 8;
 
-    // Simple screen culling
-    if (screen_x < 0 || screen_x >= WINDOW_WIDTH || screen_y < 0 || screen_y >= WINDOW_HEIGHT) {
-      xorshift32(&seed); // consume alpha random to keep determinism
-      continue;
+    // lanes past the last chunk build a copy of it, nothing is stored from them
+    uint32_t seed[8];
+    float origin_x[8];
+    float origin_y[8];
+    uint32_t min_alpha[8];
+    uint32_t alpha_values[8]; // max - min + 1
+    for (uint32_t lane = 0; lane < 8; lane++) {
+      uint32_t slot = build_[i + (lane < lanes ? lane : lanes - 1)];
+      uint32_t layer = chunks_.layer[slot];
+      seed[lane] = chunk_hash(chunks_.cx[slot], chunks_.cy[slot], layer);
+      origin_x[lane] = (float)(chunks_.cx[slot] * CHUNK_SIZE);
+      origin_y[lane] = (float)(chunks_.cy[slot] * CHUNK_SIZE);
+      min_alpha[lane] = layer_min_alpha_[layer];
+      alpha_values[lane] = (uint32_t)(layer_max_alpha_[layer] - layer_min_alpha_[layer]) + 1;
+    }
+
+    __m256i state = _mm256_loadu_si256((const __m256i*)seed);
+    __m256 chunk_x = _mm256_loadu_ps(origin_x);
+    __m256 chunk_y = _mm256_loadu_ps(origin_y);
+    __m256i alpha_base = _mm256_loadu_si256((const __m256i*)min_alpha);
+    __m256i alpha_range = _mm256_loadu_si256((const __m256i*)alpha_values);
+
+    for (uint32_t s = 0; s < STARS_PER_CHUNK; s++) {
+      // Use lower 16 bits for position (0-65535 -> 0-CHUNK_SIZE)
+      __m256i rx = _mm256_and_si256(xorshift32x8(&state), low16);
+      __m256i ry = _mm256_and_si256(xorshift32x8(&state), low16);
+      __m256i ra = xorshift32x8(&state);
+
+      _mm256_storeu_ps(x[s], _mm256_fmadd_ps(_mm256_cvtepi32_ps(rx), norm, chunk_x));
+      _mm256_storeu_ps(y[s], _mm256_fmadd_ps(_mm256_cvtepi32_ps(ry), norm, chunk_y));
+
+      // white with varying alpha, min + (upper 16 bits scaled to the range)
+      __m256i scaled = _mm256_mullo_epi32(_mm256_srli_epi32(ra, 16), alpha_range);
+      __m256i alpha = _mm256_add_epi32(alpha_base, _mm256_srli_epi32(scaled, 16));
+      _mm256_storeu_si256((__m256i*)color[s], _mm256_or_si256(white, _mm256_slli_epi32(alpha, 24)));
+    }
+
+    for (uint32_t lane = 0; lane < lanes; lane++) {
+      uint32_t slot = build_[i + lane];
+      for (uint32_t s = 0; s < STARS_PER_CHUNK; s++) {
+        chunks_.x[slot][s] = x[s][lane];
+        chunks_.y[slot][s] = y[s][lane];
+        *(uint32_t*)&chunks_.color[slot][s] = color[s][lane];
+      }
     }
+  }
+  build_count_ = 0;
+  PROFILE_ZONE_END();
+}
+
+// Appends the stars of a chunk that are on screen, 8 at a time packed to the front
+static void _emit_chunk(uint32_t slot, __m256 offset_x, __m256 offset_y) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 width = _mm256_set1_ps((float)WINDOW_WIDTH);
+  const __m256 height = _mm256_set1_ps((float)WINDOW_HEIGHT);
 
-    // Store vertex (interleaved x,y)
-    star_vertices_[star_count_ * 2] = screen_x;
-    star_vertices_[star_count_ * 2 + 1] = screen_y;
+  for (uint32_t s = 0; s < STARS_PER_CHUNK; s += 8) {
+    __m256 x = _mm256_sub_ps(_mm256_loadu_ps(&chunks_.x[slot][s]), offset_x);
+    __m256 y = _mm256_sub_ps(_mm256_loadu_ps(&chunks_.y[slot][s]), offset_y);
+    __m256i color = _mm256_loadu_si256((const __m256i*)&chunks_.color[slot][s]);
 
-    // Store color (white with varying alpha)
-    uint32_t ra = xorshift32(&seed);
-    star_colors_[star_count_].r = 255;
-    star_colors_[star_count_].g = 255;
-    star_colors_[star_count_].b = 255;
-    star_colors_[star_count_].a = min_alpha + (uint8_t)(ra % (alpha_range + 1));
+    // Simple screen culling
+    __m256 inside_x = _mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_GE_OQ), _mm256_cmp_ps(x, width, _CMP_LT_OQ));
+    __m256 inside_y = _mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_GE_OQ), _mm256_cmp_ps(y, height, _CMP_LT_OQ));
+    __m256 inside = _mm256_and_ps(inside_x, inside_y);
+    uint32_t mask = (uint32_t)_mm256_movemask_ps(inside);
+    if (mask == 0) continue;
+
+    __m256i permutation = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&pack_lanes_[mask]));
+    x = _mm256_permutevar8x32_ps(x, permutation);
+    y = _mm256_permutevar8x32_ps(y, permutation);
+    color = _mm256_permutevar8x32_epi32(color, permutation);
+
+    // interleave to x,y pairs: x0 y0 x1 y1 | x4 y4 x5 y5 and x2 y2 x3 y3 | x6 y6 x7 y7
+    __m256 low = _mm256_unpacklo_ps(x, y);
+    __m256 high = _mm256_unpackhi_ps(x, y);
+    float* vertices = &star_vertices_[star_count_ * 2];
+    _mm256_storeu_ps(vertices, _mm256_permute2f128_ps(low, high, 0x20));
+    _mm256_storeu_ps(vertices + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    _mm256_storeu_si256((__m256i*)&star_colors_[star_count_], color);
 
-    star_count_++;
+    star_count_ += _mm_popcnt_u32(mask);
   }
 }
 
@@ -93,34 +279,113 @@ void stars_draw(float camera_x, float camera_y) {
   PROFILE_ZONE("stars_draw");
   star_count_ = 0;
 
-  // Generate stars for each layer
+  // Find the visible chunks of each layer, queue the ones not cached
+  float offset_x[NUM_LAYERS];
+  float offset_y[NUM_LAYERS];
+  uint32_t visible = 0;
   for (int layer = 0; layer < NUM_LAYERS; layer++) {
     float parallax = layer_speeds_[layer];
-    float offset_x = camera_x * parallax;
-    float offset_y = camera_y * parallax;
+    offset_x[layer] = camera_x * parallax;
+    offset_y[layer] = camera_y * parallax;
 
     // Calculate visible chunk range for this layer
     // Add margin to prevent popping at edges
     float margin = (float)CHUNK_SIZE;
 
-    int min_cx = (int)((offset_x - margin) / CHUNK_SIZE);
-    int max_cx = (int)((offset_x + WINDOW_WIDTH + margin) / CHUNK_SIZE);
-    int min_cy = (int)((offset_y - margin) / CHUNK_SIZE);
-    int max_cy = (int)((offset_y + WINDOW_HEIGHT + margin) / CHUNK_SIZE);
-
-    uint8_t min_alpha = layer_min_alpha_[layer];
-    uint8_t max_alpha = layer_max_alpha_[layer];
+    int min_cx = (int)((offset_x[layer] - margin) / CHUNK_SIZE);
+    int max_cx = (int)((offset_x[layer] + WINDOW_WIDTH + margin) / CHUNK_SIZE);
+    int min_cy = (int)((offset_y[layer] - margin) / CHUNK_SIZE);
+    int max_cy = (int)((offset_y[layer] + WINDOW_HEIGHT + margin) / CHUNK_SIZE);
 
+    uint32_t first = visible;
     for (int cy = min_cy; cy <= max_cy; cy++) {
       for (int cx = min_cx; cx <= max_cx; cx++) {
-        generate_chunk_stars(cx, cy, layer, offset_x, offset_y, min_alpha, max_alpha);
+        _ASSERT(visible < VISIBLE_CHUNKS && "more chunks in view than VISIBLE_CHUNKS allows for");
+        visible_[visible++] = _chunk_acquire(cx, cy, (uint32_t)layer);
       }
     }
+    visible_count_[layer] = visible - first;
+  }
+
+  if (build_count_ > 0) {
+    _build_chunks();
   }
 
-  // Render all stars in one draw call
-  if (star_count_ > 0) {
-    platform_renderer_draw_stars(star_count_, star_vertices_, star_colors_);
+  // Offset and cull the cached stars into the vertex arrays
+  uint32_t v = 0;
+  for (int layer = 0; layer < NUM_LAYERS; layer++) {
+    __m256 layer_x = _mm256_set1_ps(offset_x[layer]);
+    __m256 layer_y = _mm256_set1_ps(offset_y[layer]);
+    for (uint32_t end = v + visible_count_[layer]; v < end; v++) {
+      _emit_chunk(visible_[v], layer_x, layer_y);
+    }
   }
+
+  // all stars in one command, drawn at submit
+  render_points(RENDER_LAYER_STARS, star_count_, star_vertices_, star_colors_);
   PROFILE_ZONE_END();
 }
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+static inline uint32_t xorshift32(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+void stars_test__chunks_cached_between_frames(void) {
+  render_initialize();
+  render_begin();
+  stars_initialize();
+
+  // first frame generates everything in view
+  stars_draw(1000.0f, -500.0f);
+  uint32_t visible = visible_count_[0] + visible_count_[1] + visible_count_[2];
+  TEST_ASSERT_EQUAL_UINT32(visible, chunks_.used);
+  size_t first_count = star_count_;
+  TEST_ASSERT_TRUE(first_count > 0);
+  TEST_ASSERT_TRUE(first_count <= visible * STARS_PER_CHUNK);
+
+  for (size_t i = 0; i < star_count_; i++) {
+    TEST_ASSERT_TRUE(star_vertices_[i * 2] >= 0.0f && star_vertices_[i * 2] < WINDOW_WIDTH);
+    TEST_ASSERT_TRUE(star_vertices_[i * 2 + 1] >= 0.0f && star_vertices_[i * 2 + 1] < WINDOW_HEIGHT);
+    TEST_ASSERT_EQUAL_UINT8(255, star_colors_[i].r);
+    TEST_ASSERT_TRUE(star_colors_[i].a >= layer_min_alpha_[0]);
+  }
+
+  // the same view again is served from the cache, star for star
+  float first_x = star_vertices_[0];
+  uint8_t first_alpha = star_colors_[0].a;
+  render_begin();
+  stars_draw(1000.0f, -500.0f);
+  TEST_ASSERT_EQUAL_UINT32(visible, chunks_.used);
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)first_count, (uint32_t)star_count_);
+  TEST_ASSERT_EQUAL_FLOAT(first_x, star_vertices_[0]);
+  TEST_ASSERT_EQUAL_UINT8(first_alpha, star_colors_[0].a);
+
+  // a lane of the SIMD build matches the scalar xorshift stream of its chunk
+  uint32_t slot = visible_[0];
+  uint32_t state = chunk_hash(chunks_.cx[slot], chunks_.cy[slot], chunks_.layer[slot]);
+  for (uint32_t s = 0; s < STARS_PER_CHUNK; s++) {
+    uint32_t rx = xorshift32(&state);
+    xorshift32(&state);
+    xorshift32(&state);
+    float expected = (float)(chunks_.cx[slot] * CHUNK_SIZE) + (float)(rx & 0xFFFF) * ((float)CHUNK_SIZE / 65536.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, expected, chunks_.x[slot][s]);
+  }
+
+  // moving far away reuses the least recently used slots, the cache doesn't grow past its size
+  for (int frame = 0; frame < 8; frame++) {
+    render_begin();
+    stars_draw(100000.0f * (float)(frame + 1), 0.0f);
+  }
+  TEST_ASSERT_TRUE(chunks_.used <= CHUNK_CACHE_SIZE);
+  TEST_ASSERT_TRUE(star_count_ <= MAX_VISIBLE_STARS);
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 // Procedural star background with parallax effect
 // Stars are generated deterministically based on camera position
+// Generated chunks are cached (LRU), a frame only builds the chunks that came into view
 
 void stars_initialize(void);
 void stars_draw(float camera_x, float camera_y);
@@ -4,9 +4,12 @@
 #include "collisions/collisions.h"
 #include "physics/physics.h"
 #include "messaging/messaging.h"
+#include "messaging/trace.h"
+#include "scheduler/scheduler.h"
 #include "graphics/graphics.h"
 #include "debug/debug.h"
 #include "debug/profiler.h"
+#include "debug/dispatch_stats.h"
 
 // TEST: Explode ship periodically (every 3 seconds)
 static uint32_t _test_tick_counter = 0;
@@ -28,9 +31,14 @@ int run(void) {
   debug_initialize();
   platform_initialize();
   messaging_initialize();
+  scheduler_initialize();
   entity_manager_initialize();
-  graphics_initialize();
+  physics_engine_initialize();
+  graphics_initialize(platform_has_argument("-nullrender")  ? GRAPHICS_RENDERER_NULL
+                      : platform_has_argument("-instanced") ? GRAPHICS_RENDERER_INSTANCED
+                                                            : GRAPHICS_RENDERER_BATCHED);
   collisions_engine_initialize();
+  scheduler_build();
 
   messaging_send(RECIPIENT_ID_BROADCAST, CREATE_MESSAGE(MESSAGE_BROADCAST_SYSTEM_INITIALIZED, 0, 0));
 
@@ -45,24 +53,28 @@ int run(void) {
       break;
 
     PROFILE_FRAME_START("Physics");
-    messaging_send(RECIPIENT_ID_BROADCAST, CREATE_MESSAGE(MESSAGE_BROADCAST_FRAME_TICK, 0, 0));
+    scheduler_run(SYSTEM_PHASE_INPUT, SYSTEM_PHASE_INPUT);
 
     while (platform_tick_pending()) {
       _test_explosion_tick();  // TEST
-      physics_engine_tick();
-      collisions_engine_tick();
+      scheduler_run(SYSTEM_PHASE_PRE_PHYSICS, SYSTEM_PHASE_COLLISION);
       messaging_pump();
     }
     PROFILE_FRAME_END("Physics");
 
     PROFILE_FRAME_START("Render");
+    scheduler_run(SYSTEM_PHASE_RENDER_PREP, SYSTEM_PHASE_RENDER_PREP);
     graphics_engine_draw();
     debug_watch_draw();
     PROFILE_FRAME_END("Render");
 
     platform_renderer_report_stats();
+    DISPATCH_STATS_FRAME();
     platform_frame_end();
     PROFILE_FRAME_MARK();
   }
+
+  MESSAGE_TRACE_SHUTDOWN();
+  DISPATCH_STATS_DUMP();
   return 0;
 }
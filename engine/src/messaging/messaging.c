@@ -1,9 +1,13 @@
 #include "messaging.h"
+#include "trace.h"
 #include "entity/entity.h"
 #include "platform/platform.h"
 #include "debug/profiler.h"
+#include "debug/dispatch_stats.h"
+#include "snapshot/snapshot.h"
 
 #define MAX_MESSAGES 1024
+#define PAYLOAD_ARENA_SIZE (256 * 1024)
 
 struct message_with_recipient {
   message_t message;
@@ -15,17 +19,36 @@ struct messaging_system {
   size_t tail;
 
   struct message_with_recipient* messages;
+
+  uint8_t* payload_arena;
+  uint32_t payload_used;
+
+  uint32_t dropped; // sends into a full queue and payloads past the arena, since initialize
 };
 
 static struct messaging_system messaging_ = { 0 };
 
 void messaging_initialize(void) {
   messaging_.messages = platform_retrieve_memory(sizeof(struct message_with_recipient) * MAX_MESSAGES);
+  messaging_.payload_arena = platform_retrieve_memory(PAYLOAD_ARENA_SIZE);
+  messaging_clear();
+  messaging_.dropped = 0;
+  MESSAGE_TRACE_INITIALIZE();
+}
+
+void messaging_clear(void) {
+  messaging_.head = 0;
+  messaging_.tail = 0;
+  messaging_.payload_used = 0;
 }
 
 void messaging_send(entity_id_t recipient_id, message_t msg) {
   size_t next_tail = (messaging_.tail + 1) % MAX_MESSAGES;
-  _ASSERT(next_tail != messaging_.head); // overflow
+  if (next_tail == messaging_.head) {
+    // overflow, the message is dropped
+    messaging_.dropped++;
+    return;
+  }
 
   messaging_.messages[messaging_.tail].recipient_id = recipient_id;
   messaging_.messages[messaging_.tail].message = msg;
@@ -34,16 +57,139 @@ void messaging_send(entity_id_t recipient_id, message_t msg) {
 
 void messaging_pump(void) {
   PROFILE_ZONE("messaging_pump");
-  size_t message_count = 0;
+  DISPATCH_STATS_BEGIN();
+  uint32_t message_count = 0;
   while (messaging_.head != messaging_.tail) {
-    struct message_with_recipient* mwr = &messaging_.messages[messaging_.head];
-    // process message here
-    // for now, just discard
+    // copy out, the slot is free for handlers to reuse once head moves
+    struct message_with_recipient mwr = messaging_.messages[messaging_.head];
     messaging_.head = (messaging_.head + 1) % MAX_MESSAGES;
 
-    entity_manager_dispatch_message(mwr->recipient_id, mwr->message);
+    MESSAGE_TRACE_BEGIN();
+    entity_manager_dispatch_message(mwr.recipient_id, mwr.message);
+    MESSAGE_TRACE_END(mwr.recipient_id, mwr.message);
     message_count++;
   }
+  MESSAGE_TRACE_TICK();
+  DISPATCH_STATS_PUMP_END(message_count);
   PROFILE_PLOT("message_count", message_count);
+  PROFILE_PLOT("message_payload_bytes", messaging_.payload_used);
+  PROFILE_PLOT("message_dropped", messaging_.dropped);
+
+  // queue is drained, nobody can reference the payloads anymore
+  messaging_.payload_used = 0;
   PROFILE_ZONE_END();
 }
+
+void* messaging_payload_alloc(message_t* msg, uint32_t size) {
+  uint32_t offset = messaging_.payload_used;
+  uint32_t next = (offset + size + 15) & ~15u;
+  if (size > PAYLOAD_ARENA_SIZE || next > PAYLOAD_ARENA_SIZE) {
+    // overflow, too many payloads in one tick, the message is dropped
+    messaging_.dropped++;
+    return NULL;
+  }
+
+  messaging_.payload_used = next;
+  msg->data_cd = (int64_t)(((uint64_t)size << 32) | offset);
+  return messaging_.payload_arena + offset;
+}
+
+uint32_t messaging_dropped(void) {
+  return messaging_.dropped;
+}
+
+const void* messaging_payload(const message_t* msg, uint32_t* size) {
+  uint32_t offset = (uint32_t)((uint64_t)msg->data_cd & 0xFFFFFFFF);
+  uint32_t payload_size = (uint32_t)((uint64_t)msg->data_cd >> 32);
+  _ASSERT(offset + payload_size <= messaging_.payload_used); // stale payload from an already pumped tick
+
+  if (size != NULL) {
+    *size = payload_size;
+  }
+  return messaging_.payload_arena + offset;
+}
+
+void messaging_snapshot_save(snapshot_t* snapshot) {
+  // the ring is written oldest first, a load starts it over at 0
+  uint32_t count = (uint32_t)((messaging_.tail + MAX_MESSAGES - messaging_.head) % MAX_MESSAGES);
+  uint32_t to_end = (uint32_t)(MAX_MESSAGES - messaging_.head);
+  uint32_t first = to_end < count ? to_end : count;
+
+  snapshot_write(snapshot, SNAPSHOT_SECTION_MESSAGES, &messaging_.messages[messaging_.head],
+                 first * sizeof(struct message_with_recipient));
+  snapshot_append(snapshot, SNAPSHOT_SECTION_MESSAGES, messaging_.messages,
+                  (count - first) * sizeof(struct message_with_recipient));
+  snapshot_write(snapshot, SNAPSHOT_SECTION_PAYLOADS, messaging_.payload_arena, messaging_.payload_used);
+}
+
+bool messaging_snapshot_load(snapshot_t* snapshot) {
+  size_t messages_size, payload_size;
+  const void* messages = snapshot_read(snapshot, SNAPSHOT_SECTION_MESSAGES, &messages_size);
+  const void* payload = snapshot_read(snapshot, SNAPSHOT_SECTION_PAYLOADS, &payload_size);
+
+  messaging_clear();
+  if (messages == NULL || payload == NULL || messages_size % sizeof(struct message_with_recipient) != 0 ||
+      messages_size >= MAX_MESSAGES * sizeof(struct message_with_recipient) || payload_size > PAYLOAD_ARENA_SIZE) {
+    return false;
+  }
+
+  platform_copy_memory(messaging_.messages, messages, messages_size);
+  platform_copy_memory(messaging_.payload_arena, payload, payload_size);
+  messaging_.tail = messages_size / sizeof(struct message_with_recipient);
+  messaging_.payload_used = (uint32_t)payload_size;
+  return true;
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+// Test: payloads round-trip through the message and the arena is reused after pump
+void messaging_test__payload_arena_reset(void) {
+  messaging_initialize();
+
+  message_t msg = CREATE_MESSAGE(MESSAGE_COLLIDE_OBJECT_OBJECT, 1, 2);
+  float* payload = messaging_payload_alloc(&msg, sizeof(float) * 5);
+  for (int i = 0; i < 5; i++) {
+    payload[i] = (float)i * 0.5f;
+  }
+
+  message_t small = CREATE_MESSAGE(MESSAGE_COLLIDE_OBJECT_OBJECT, 3, 4);
+  uint8_t* second = messaging_payload_alloc(&small, 1);
+  TEST_ASSERT_EQUAL_INT(0, ((uintptr_t)second) & 15);
+
+  uint32_t size = 0;
+  const float* read = messaging_payload(&msg, &size);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(float) * 5, size);
+  TEST_ASSERT_EQUAL_PTR(payload, read);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, read[4]);
+  TEST_ASSERT_EQUAL_INT32(1, msg.data_a);
+  TEST_ASSERT_EQUAL_INT32(2, msg.data_b);
+
+  messaging_pump();
+
+  message_t next = CREATE_MESSAGE(MESSAGE_COLLIDE_OBJECT_OBJECT, 0, 0);
+  TEST_ASSERT_EQUAL_PTR(payload, messaging_payload_alloc(&next, 4));
+}
+
+// Test: a full queue and an exhausted payload arena drop the message and count it
+void messaging_test__overflow_drops_and_counts(void) {
+  messaging_initialize();
+
+  message_t msg = CREATE_MESSAGE(MESSAGE_COLLIDE_OBJECT_OBJECT, 0, 0);
+  TEST_ASSERT_NOT_NULL(messaging_payload_alloc(&msg, PAYLOAD_ARENA_SIZE - 16));
+  TEST_ASSERT_NOT_NULL(messaging_payload_alloc(&msg, 16));
+  TEST_ASSERT_NULL(messaging_payload_alloc(&msg, 1));
+  TEST_ASSERT_NULL(messaging_payload_alloc(&msg, UINT32_MAX - 8)); // no wrap around
+  TEST_ASSERT_EQUAL_UINT32(2, messaging_dropped());
+
+  // the ring keeps one slot free, the last send doesn't fit
+  for (uint32_t i = 0; i < MAX_MESSAGES; i++) {
+    messaging_send((entity_id_t)INVALID_ENTITY, CREATE_MESSAGE(MESSAGE_COLLIDE_OBJECT_OBJECT, (int32_t)i, 0));
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, messaging_dropped());
+  TEST_ASSERT_EQUAL_size_t(MAX_MESSAGES - 1, messaging_.tail);
+
+  messaging_clear();
+}
+
+#endif
@@ -19,9 +19,7 @@ typedef struct {
 
 enum message_codes_system {
   MESSAGE_BROADCAST_SYSTEM_INITIALIZED = 0,
-  MESSAGE_BROADCAST_120HZ_AFTER_PHYSICS = 1,
-  MESSAGE_BROADCAST_FRAME_TICK = 2,
-  MESSAGE_BROADCAST_120HZ_BEFORE_PHYSICS = 3,
+  // 1 - 3 were the tick broadcasts, per-tick work is driven by scheduler/scheduler.h now
   MESSAGE_COLLIDE_OBJECT_OBJECT = 4, // data_a = this entity id, data_b = other entity id
   MESSAGE_COLLIDE_OBJECT_PARTICLE = 5 // data_a = this entity id, data_b = particle id
 };
@@ -58,6 +56,20 @@ static inline message_t CREATE_MESSAGE_F(uint16_t msg, float x, float y) {
 }
 
 void messaging_initialize(void);
+void messaging_clear(void); // drops everything queued, payloads included
 
-void messaging_send(entity_id_t recipient_id, message_t msg);
+struct snapshot;
+void messaging_snapshot_save(struct snapshot* snapshot);
+bool messaging_snapshot_load(struct snapshot* snapshot);
+
+void messaging_send(entity_id_t recipient_id, message_t msg); // a full queue drops the message
 void messaging_pump(void);
+uint32_t messaging_dropped(void); // messages dropped by a full queue or payload arena, since initialize
+
+// Variable-size payloads, for events that don't fit into data_a/data_b/data_cd.
+// The payload lives in a per-tick bump arena that is reset at the end of messaging_pump, so the message must be sent
+// (and is dispatched) within the same pump; don't keep the pointer around in handlers.
+// data_cd carries the arena reference (offset | size << 32), data_a/data_b stay free for the sender.
+// Returns 16 byte aligned memory to fill, or NULL when the arena is full this tick; don't send the message then.
+void* messaging_payload_alloc(message_t* msg, uint32_t size);
+const void* messaging_payload(const message_t* msg, uint32_t* size);
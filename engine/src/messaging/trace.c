@@ -0,0 +1,172 @@
+#include "trace.h"
+#include "platform/platform.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MESSAGE_TRACE_CAPACITY (1024 * 1024) // records in the ring file (32 MB)
+#define MESSAGE_TRACE_BUFFER 4096            // records buffered in memory between writes
+
+struct message_trace {
+  FILE* file;
+  message_trace_header_t header;
+
+  message_trace_record_t* buffer;
+  uint32_t buffered;
+
+  struct message_trace_stats stats;
+};
+
+static struct message_trace trace_ = { 0 };
+
+static void _trace_write_header(void) {
+  fseek(trace_.file, 0, SEEK_SET);
+  fwrite(&trace_.header, sizeof(trace_.header), 1, trace_.file);
+}
+
+static void _trace_flush(void) {
+  if (trace_.file == NULL) {
+    // could not open the trace file, keep live stats only
+    trace_.buffered = 0;
+    return;
+  }
+
+  // the buffer may straddle the end of the ring, write it in at most two runs
+  uint32_t written = 0;
+  while (written < trace_.buffered) {
+    uint32_t position = (uint32_t)((trace_.header.written + written) % MESSAGE_TRACE_CAPACITY);
+    uint32_t run = trace_.buffered - written;
+    if (run > MESSAGE_TRACE_CAPACITY - position) {
+      run = MESSAGE_TRACE_CAPACITY - position;
+    }
+
+    fseek(trace_.file, (long)(sizeof(message_trace_header_t) + (size_t)position * sizeof(message_trace_record_t)),
+          SEEK_SET);
+    fwrite(&trace_.buffer[written], sizeof(message_trace_record_t), run, trace_.file);
+    written += run;
+  }
+
+  trace_.header.written += trace_.buffered;
+  trace_.buffered = 0;
+  _trace_write_header();
+}
+
+void message_trace_initialize(void) {
+  memset(&trace_.stats, 0, sizeof(trace_.stats));
+  trace_.buffer = platform_retrieve_memory(sizeof(message_trace_record_t) * MESSAGE_TRACE_BUFFER);
+  trace_.buffered = 0;
+
+  trace_.header.magic = MESSAGE_TRACE_MAGIC;
+  trace_.header.version = MESSAGE_TRACE_VERSION;
+  trace_.header.record_size = sizeof(message_trace_record_t);
+  trace_.header.capacity = MESSAGE_TRACE_CAPACITY;
+  trace_.header.written = 0;
+
+  trace_.file = fopen(MESSAGE_TRACE_FILE, "wb");
+  if (trace_.file != NULL) {
+    _trace_write_header();
+  }
+}
+
+void message_trace_record(entity_id_t recipient_id, const message_t* msg, uint64_t cycles) {
+  uint32_t cycles32 = cycles > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)cycles;
+  uint32_t code = msg->message & (MESSAGE_TRACE_MAX_CODES - 1);
+  uint32_t type = GET_TYPE(recipient_id);
+  uint32_t bucket = message_trace_bucket(cycles32);
+
+  struct message_trace_stats* stats = &trace_.stats;
+  stats->code_count[code]++;
+  stats->code_cycles[code] += cycles32;
+  stats->code_histogram[code][bucket]++;
+  stats->type_count[type]++;
+  stats->type_cycles[type] += cycles32;
+
+  message_trace_record_t* record = &trace_.buffer[trace_.buffered];
+  record->tick = stats->tick;
+  record->recipient = recipient_id._;
+  record->code = msg->message;
+  record->reserved = 0;
+  record->cycles = cycles32;
+  record->data_a = msg->data_a;
+  record->data_b = msg->data_b;
+  record->data_cd = msg->data_cd;
+
+  if (++trace_.buffered == MESSAGE_TRACE_BUFFER) {
+    _trace_flush();
+  }
+}
+
+void message_trace_tick(void) {
+  trace_.stats.tick++;
+}
+
+void message_trace_shutdown(void) {
+  _trace_flush();
+  if (trace_.file != NULL) {
+    fclose(trace_.file);
+    trace_.file = NULL;
+  }
+}
+
+const struct message_trace_stats* message_trace_get_stats(void) {
+  return &trace_.stats;
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+// Test: records land in the per-code and per-type counters, the log2 histogram and the ring file
+void message_trace_test__record_and_histogram(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, message_trace_bucket(0));
+  TEST_ASSERT_EQUAL_UINT32(0, message_trace_bucket(1));
+  TEST_ASSERT_EQUAL_UINT32(1, message_trace_bucket(2));
+  TEST_ASSERT_EQUAL_UINT32(1, message_trace_bucket(3));
+  TEST_ASSERT_EQUAL_UINT32(10, message_trace_bucket(1024));
+  TEST_ASSERT_EQUAL_UINT32(31, message_trace_bucket(0xFFFFFFFFu));
+
+  message_trace_initialize();
+
+  entity_id_t recipient = { (7u << 24) | 42u };
+  message_t msg = CREATE_MESSAGE(MESSAGE_COLLIDE_OBJECT_OBJECT, 5, 6);
+  message_trace_record(recipient, &msg, 100);
+  message_trace_tick();
+  message_trace_record(recipient, &msg, 127);
+  message_trace_record(RECIPIENT_ID_BROADCAST, &msg, 1ull << 40); // saturated to 32 bits
+
+  const struct message_trace_stats* stats = message_trace_get_stats();
+  uint32_t code = MESSAGE_COLLIDE_OBJECT_OBJECT;
+  // no 64 bit asserts in the Win32 Unity build
+  TEST_ASSERT_EQUAL_UINT32(3, (uint32_t)stats->code_count[code]);
+  TEST_ASSERT_TRUE(stats->code_cycles[code] == 100 + 127 + 0xFFFFFFFFull);
+  TEST_ASSERT_EQUAL_UINT32(2, stats->code_histogram[code][6]);
+  TEST_ASSERT_EQUAL_UINT32(1, stats->code_histogram[code][31]);
+  TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)stats->type_count[7]);
+  TEST_ASSERT_EQUAL_UINT32(227, (uint32_t)stats->type_cycles[7]);
+  TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)stats->type_count[0xFF]);
+  TEST_ASSERT_EQUAL_UINT32(1, stats->tick);
+
+  message_trace_shutdown();
+
+  // the records are flushed to the ring file behind the header
+  FILE* file = fopen(MESSAGE_TRACE_FILE, "rb");
+  TEST_ASSERT_NOT_NULL(file);
+  message_trace_header_t header;
+  message_trace_record_t records[3];
+  TEST_ASSERT_EQUAL_size_t(1, fread(&header, sizeof(header), 1, file));
+  TEST_ASSERT_EQUAL_size_t(3, fread(records, sizeof(records[0]), 3, file));
+  fclose(file);
+  remove(MESSAGE_TRACE_FILE);
+
+  TEST_ASSERT_EQUAL_HEX32(MESSAGE_TRACE_MAGIC, header.magic);
+  TEST_ASSERT_EQUAL_UINT32(3, (uint32_t)header.written);
+  TEST_ASSERT_EQUAL_UINT32(0, records[0].tick);
+  TEST_ASSERT_EQUAL_UINT32(1, records[1].tick);
+  TEST_ASSERT_EQUAL_HEX32(recipient._, records[0].recipient);
+  TEST_ASSERT_EQUAL_UINT16(MESSAGE_COLLIDE_OBJECT_OBJECT, records[1].code);
+  TEST_ASSERT_EQUAL_UINT32(127, records[1].cycles);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, records[2].cycles);
+  TEST_ASSERT_EQUAL_INT32(5, records[2].data_a);
+  TEST_ASSERT_EQUAL_INT32(6, records[2].data_b);
+}
+
+#endif
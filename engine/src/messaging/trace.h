@@ -0,0 +1,63 @@
+#pragma once
+
+//
+// Binary message trace recorder
+//
+// Usage (messaging_pump is already instrumented):
+//   MESSAGE_TRACE_INITIALIZE()       - opens the ring file (messaging_initialize)
+//   MESSAGE_TRACE_BEGIN()            - start timing a handler (declares a local)
+//   MESSAGE_TRACE_END(recipient, m)  - record the dispatched message and its handler time
+//   MESSAGE_TRACE_TICK()             - closes one messaging_pump invocation
+//   MESSAGE_TRACE_SHUTDOWN()         - flushes the ring file
+//
+// Every dispatched message goes into a ring file on disk (MESSAGE_TRACE_FILE, fixed size,
+// oldest records are overwritten), live per-code / per-type counters and handler time
+// histograms are kept in memory. Summarize a trace with tools/msgtrace_dump.c.
+//
+// To enable: define MESSAGE_TRACE_ENABLE in build config (needs CRT, not for ReleaseMin)
+// When disabled: all macros expand to nothing (zero overhead, not in binary)
+//
+
+#include "messaging.h"
+#include "trace_format.h"
+
+#include <intrin.h>
+
+#define MESSAGE_TRACE_FILE "raketic.msgtrace"
+#define MESSAGE_TRACE_MAX_CODES 256
+#define MESSAGE_TRACE_MAX_TYPES 256
+
+struct message_trace_stats {
+  uint64_t code_count[MESSAGE_TRACE_MAX_CODES];
+  uint64_t code_cycles[MESSAGE_TRACE_MAX_CODES];
+  uint32_t code_histogram[MESSAGE_TRACE_MAX_CODES][MESSAGE_TRACE_HISTOGRAM_BUCKETS];
+
+  uint64_t type_count[MESSAGE_TRACE_MAX_TYPES]; // by recipient type, broadcast lands in 0xFF
+  uint64_t type_cycles[MESSAGE_TRACE_MAX_TYPES];
+
+  uint32_t tick;
+};
+
+void message_trace_initialize(void);
+void message_trace_record(entity_id_t recipient_id, const message_t* msg, uint64_t cycles);
+void message_trace_tick(void);
+void message_trace_shutdown(void);
+const struct message_trace_stats* message_trace_get_stats(void);
+
+#ifdef MESSAGE_TRACE_ENABLE
+
+#define MESSAGE_TRACE_BEGIN() uint64_t __trace_start = __rdtsc()
+#define MESSAGE_TRACE_END(recipient, msg) message_trace_record((recipient), &(msg), __rdtsc() - __trace_start)
+#define MESSAGE_TRACE_INITIALIZE() message_trace_initialize()
+#define MESSAGE_TRACE_TICK() message_trace_tick()
+#define MESSAGE_TRACE_SHUTDOWN() message_trace_shutdown()
+
+#else
+
+#define MESSAGE_TRACE_BEGIN()
+#define MESSAGE_TRACE_END(recipient, msg)
+#define MESSAGE_TRACE_INITIALIZE()
+#define MESSAGE_TRACE_TICK()
+#define MESSAGE_TRACE_SHUTDOWN()
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+//
+// On-disk layout of the message trace ring file
+// Shared by the recorder (messaging/trace.c) and the offline dump tool (tools/msgtrace_dump.c),
+// so it must not depend on anything from the engine.
+//
+
+#include <stdint.h>
+
+#define MESSAGE_TRACE_MAGIC 0x544D4B52u // "RKMT"
+#define MESSAGE_TRACE_VERSION 1
+
+// log2(cycles) buckets for handler time histograms
+#define MESSAGE_TRACE_HISTOGRAM_BUCKETS 32
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t capacity; // records in the ring
+
+  // total records ever written, the oldest record lives at (written % capacity) once the ring wrapped
+  uint64_t written;
+} message_trace_header_t;
+
+typedef struct {
+  uint32_t tick;      // messaging_pump invocation the message was dispatched in
+  uint32_t recipient; // entity_id_t
+  uint16_t code;
+  uint16_t reserved;
+  uint32_t cycles; // handler time (rdtsc delta, saturated to 32 bits)
+
+  int32_t data_a;
+  int32_t data_b;
+  int64_t data_cd;
+} message_trace_record_t;
+
+// floor(log2(cycles)), 0 and 1 share bucket 0; the recorder and the dump tool both bucket with it
+static inline uint32_t message_trace_bucket(uint32_t cycles) {
+  uint32_t bucket = 0;
+  while (cycles > 1 && bucket < MESSAGE_TRACE_HISTOGRAM_BUCKETS - 1) {
+    cycles >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
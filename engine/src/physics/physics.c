@@ -1,22 +1,20 @@
 #include "physics.h"
+#include "yoshida.h"
 #include "entity/entity.h"
 #include "debug/profiler.h"
+#include "scheduler/scheduler.h"
 
 #include <immintrin.h>
 
-#define YOSHIDA_C1 1.3512071919596578f
-#define YOSHIDA_C2 -1.7024143839193155f
-#define YOSHIDA_C3 1.3512071919596578f
-
 
 static void _particle_manager_euler(struct particles_data* pd) {
   __m256 dt = _mm256_set1_ps(TICK_S);
 
-  float* px = pd->position_orientation.position_x;
-  float* py = pd->position_orientation.position_y;
+  float* px = pd->position_orientation.position_x + pd->first;
+  float* py = pd->position_orientation.position_y + pd->first;
 
-  float* vx = pd->velocity_x;
-  float* vy = pd->velocity_y;
+  float* vx = pd->velocity_x + pd->first;
+  float* vy = pd->velocity_y + pd->first;
 
   float* end_pos = pd->position_orientation.position_x + pd->active;
 
@@ -36,79 +34,17 @@ static void _particle_manager_euler(struct particles_data* pd) {
 }
 
 static void _objects_apply_yoshida_step(struct objects_data* od, float step, float hstep) {
-  float* __restrict px = od->position_orientation.position_x;
-  float* __restrict py = od->position_orientation.position_y;
-
-  float* __restrict vx = od->velocity_x;
-  float* __restrict vy = od->velocity_y;
-
-  float* __restrict ax = od->acceleration_x;
-  float* __restrict ay = od->acceleration_y;
-
-  float* end_px = od->position_orientation.position_x + od->active;
-
-  for (; px < end_px; px += 8, py += 8, vx += 8, vy += 8, ax += 8, ay += 8) {
-
-    // acceleration = thrust / mass
-    __m256 acc_x = _mm256_load_ps(ax);
-    __m256 acc_y = _mm256_load_ps(ay);
-
-    __m256 velocity_x = _mm256_load_ps(vx);
-    __m256 velocity_y = _mm256_load_ps(vy);
-
-    __m256 pos_x = _mm256_load_ps(px);
-    __m256 pos_y = _mm256_load_ps(py);
-
-
-    __m256 w = _mm256_set1_ps(step);
-    __m256 whalf = _mm256_set1_ps(hstep);
-
-    velocity_x = _mm256_fmadd_ps(acc_x, whalf, velocity_x); // a*b+c
-    velocity_y = _mm256_fmadd_ps(acc_y, whalf, velocity_y);
-
-    pos_x = _mm256_fmadd_ps(velocity_x, w, pos_x);
-    pos_y = _mm256_fmadd_ps(velocity_y, w, pos_y);
-
-    // TODO COMPUTE GRAVITY
-    velocity_x = _mm256_fmadd_ps(acc_x, whalf, velocity_x);
-    velocity_y = _mm256_fmadd_ps(acc_y, whalf, velocity_y);
-
-    _mm256_store_ps(px, pos_x);
-    _mm256_store_ps(py, pos_y);
-
-    _mm256_store_ps(vx, velocity_x);
-    _mm256_store_ps(vy, velocity_y);
-
-  }
+  yoshida_step(od->position_orientation.position_x, od->position_orientation.position_y, od->velocity_x,
+               od->velocity_y, od->acceleration_x, od->acceleration_y, OBJECTS_HOT_STRIDE, HOT_IDX(od->active), step,
+               hstep);
 }
 
 static void _recompute_thrust(struct objects_data* od) {
-  float* __restrict thrust = od->thrust;
-  float* __restrict mass = od->mass;
-  float* __restrict ox = od->position_orientation.orientation_x;
-  float* __restrict oy = od->position_orientation.orientation_y;
-  float* __restrict accx = od->acceleration_x;
-  float* __restrict accy = od->acceleration_y;
-
-  __m256 epsilon = _mm256_set1_ps(0.0001f); // avoid division by zero
-
-  float* thrust_end = thrust + od->active;
-  for (; thrust < thrust_end; thrust += 8, mass += 8, ox += 8, oy += 8, accx += 8, accy += 8) {
-    __m256 thrusts = _mm256_load_ps(thrust);
-    __m256 masses = _mm256_max_ps(_mm256_load_ps(mass), epsilon);
-    __m256 orientations_x = _mm256_load_ps(ox);
-    __m256 orientations_y = _mm256_load_ps(oy);
-
-    __m256 acc_x = _mm256_div_ps(_mm256_mul_ps(thrusts, orientations_x), masses);
-    __m256 acc_y = _mm256_div_ps(_mm256_mul_ps(thrusts, orientations_y), masses);
-
-    _mm256_store_ps(accx, acc_x);
-    _mm256_store_ps(accy, acc_y);
-  }
+  yoshida_thrust_acceleration(od->thrust, od->mass, od->position_orientation.orientation_x,
+                              od->position_orientation.orientation_y, od->acceleration_x, od->acceleration_y,
+                              OBJECTS_HOT_STRIDE, HOT_IDX(od->active));
 }
 
-#define GRAVITATIONAL_CONSTANT 6.67430f // e-1f
-
 static inline float _hsum256(__m256 v) {
   __m128 lo = _mm256_castps256_ps128(v);
   __m128 hi = _mm256_extractf128_ps(v, 1);
@@ -126,19 +62,19 @@ static void _recompute_acceleration(struct objects_data* od) {
   __m256 g = _mm256_set1_ps(GRAVITATIONAL_CONSTANT);
 
   for (size_t i = 0; i < od->active; i++) {
-    __m256 ipx = _mm256_set1_ps(od->position_orientation.position_x[i]);
-    __m256 ipy = _mm256_set1_ps(od->position_orientation.position_y[i]);
+    __m256 ipx = _mm256_set1_ps(od->position_orientation.position_x[HOT_IDX(i)]);
+    __m256 ipy = _mm256_set1_ps(od->position_orientation.position_y[HOT_IDX(i)]);
 
     float* __restrict px = od->position_orientation.position_x;
     float* __restrict py = od->position_orientation.position_y;
     float* __restrict m = od->mass;
 
-    float* end_px = od->position_orientation.position_x + od->active;
+    float* end_px = od->position_orientation.position_x + HOT_IDX(od->active);
 
     __m256 axs = _mm256_set1_ps(0.0f);
     __m256 ays = _mm256_set1_ps(0.0f);
 
-    for (; px < end_px; px += 8, py += 8, m += 8) {
+    for (; px < end_px; px += OBJECTS_HOT_STRIDE, py += OBJECTS_HOT_STRIDE, m += OBJECTS_HOT_STRIDE) {
       __m256 jpx = _mm256_load_ps(px);
       __m256 jpy = _mm256_load_ps(py);
 
@@ -160,8 +96,8 @@ static void _recompute_acceleration(struct objects_data* od) {
       ays = _mm256_add_ps(ays, ay);
     }
 
-    od->acceleration_x[i] += _hsum256(axs);
-    od->acceleration_y[i] += _hsum256(ays);
+    od->acceleration_x[HOT_IDX(i)] += _hsum256(axs);
+    od->acceleration_y[HOT_IDX(i)] += _hsum256(ays);
   }
 }
 
@@ -189,8 +125,10 @@ static uint32_t _particle_manager_ttl(struct particles_data* pd) {
   __m256i zero = _mm256_setzero_si256();
   __m256i one = _mm256_set1_epi16(1);
 
-  uint16_t* __restrict lifetime_ticks = pd->lifetime_ticks;
+  uint16_t* __restrict lifetime_ticks = pd->lifetime_ticks + pd->first;
   uint16_t* __restrict end_life = pd->lifetime_ticks + pd->active;
+  // 16 particles per mask, for the pack (or retire), indexed from particle 0
+  uint16_t* __restrict alive_masks = (uint16_t*)pd->temporary + pd->first / 16;
 
   uint32_t alive_count = 0;
 
@@ -199,9 +137,13 @@ static uint32_t _particle_manager_ttl(struct particles_data* pd) {
     lifetime = _mm256_subs_epu16(lifetime, one);
     _mm256_store_si256((__m256i*)lifetime_ticks, lifetime);
 
-    // Accumulate: 0xFFFF for alive, 0x0000 for dead
+    // 0xFFFF for alive, 0x0000 for dead, narrowed to one bit per particle
     __m256i alive_mask = _mm256_cmpgt_epi16(lifetime, zero);
-    alive_count += _mm_popcnt_u32(_mm256_movemask_epi8(alive_mask)) / 2; // /2 because 16-bit elements, 8-bit mask
+    __m128i alive_bytes =
+        _mm_packs_epi16(_mm256_castsi256_si128(alive_mask), _mm256_extracti128_si256(alive_mask, 1));
+    uint32_t alive = (uint32_t)_mm_movemask_epi8(alive_bytes);
+    *alive_masks++ = (uint16_t)alive;
+    alive_count += _mm_popcnt_u32(alive);
   }
 
   PROFILE_PLOT_I("survived", alive_count);
@@ -209,50 +151,103 @@ static uint32_t _particle_manager_ttl(struct particles_data* pd) {
   return alive_count;
 }
 
+// world pose of parts i..i+7 from their parents' world poses
+static inline void _parts_compose(const struct parts_data* pd, uint32_t i, __m256 parent_x, __m256 parent_y,
+                                  __m256 parent_ox, __m256 parent_oy, __m256 world[4]) {
+  __m256 local_x = _mm256_load_ps(&pd->local_offset_x[i]);
+  __m256 local_y = _mm256_load_ps(&pd->local_offset_y[i]);
+
+  // rotate local offset by parent's orientation (CCW, matching renderer)
+  // x' = x*cos - y*sin, y' = x*sin + y*cos
+  __m256 rotated_lx = _mm256_fmsub_ps(local_x, parent_ox, _mm256_mul_ps(local_y, parent_oy));
+  __m256 rotated_ly = _mm256_fmadd_ps(local_x, parent_oy, _mm256_mul_ps(local_y, parent_ox));
+
+  // set world position
+  world[0] = _mm256_add_ps(parent_x, rotated_lx);
+  world[1] = _mm256_add_ps(parent_y, rotated_ly);
+
+  __m256 local_ox = _mm256_load_ps(&pd->local_orientation_x[i]);
+  __m256 local_oy = _mm256_load_ps(&pd->local_orientation_y[i]);
+  // compose orientations (CCW angle addition via complex multiplication)
+  // world = local * parent: ox' = lox*pox - loy*poy, oy' = lox*poy + loy*pox
+  __m256 world_ox = _mm256_fmsub_ps(local_ox, parent_ox, _mm256_mul_ps(local_oy, parent_oy));
+  __m256 world_oy = _mm256_fmadd_ps(local_ox, parent_oy, _mm256_mul_ps(local_oy, parent_ox));
+
+  // normalize world orientation
+  __m256 length_sq =
+      _mm256_rsqrt_ps(_mm256_add_ps(_mm256_mul_ps(world_ox, world_ox), _mm256_mul_ps(world_oy, world_oy)));
+  world[2] = _mm256_mul_ps(world_ox, length_sq);
+  world[3] = _mm256_mul_ps(world_oy, length_sq);
+}
+
+// one pass per mount level: lanes of `level` gather the world pose of their parent part, which the previous
+// pass already finished, the other lanes are left alone
+static void _parts_level_transform(struct parts_data* pd, uint32_t level) {
+  position_orientation_t* world = &pd->world_position_orientation;
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i wanted = _mm256_set1_epi32((int)level);
+  const __m256i active = _mm256_set1_epi32((int)pd->active);
+  const __m256 zero = _mm256_setzero_ps();
+
+  for (uint32_t i = 0; i < pd->active; i += 8) {
+    __m256i index = _mm256_add_epi32(_mm256_set1_epi32((int)i), lanes);
+    __m256i levels = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&pd->level[i]));
+    __m256i mask = _mm256_and_si256(_mm256_cmpeq_epi32(levels, wanted), _mm256_cmpgt_epi32(active, index));
+    if (_mm256_testz_si256(mask, mask)) {
+      continue;
+    }
+
+    __m256i parent =
+        _mm256_sub_epi32(index, _mm256_load_si256((const __m256i*)&pd->parent_part_offset[i]));
+    __m256 lane_mask = _mm256_castsi256_ps(mask);
+
+    __m256 pose[4];
+    _parts_compose(pd, i, _mm256_mask_i32gather_ps(zero, world->position_x, parent, lane_mask, 4),
+                   _mm256_mask_i32gather_ps(zero, world->position_y, parent, lane_mask, 4),
+                   _mm256_mask_i32gather_ps(zero, world->orientation_x, parent, lane_mask, 4),
+                   _mm256_mask_i32gather_ps(zero, world->orientation_y, parent, lane_mask, 4), pose);
+
+    _mm256_maskstore_ps(&world->position_x[i], mask, pose[0]);
+    _mm256_maskstore_ps(&world->position_y[i], mask, pose[1]);
+    _mm256_maskstore_ps(&world->orientation_x[i], mask, pose[2]);
+    _mm256_maskstore_ps(&world->orientation_y[i], mask, pose[3]);
+  }
+}
+
 static void _parts_world_transform(struct objects_data* od, struct parts_data* pd) {
   PROFILE_ZONE("_parts_world_transform");
   PROFILE_PLOT_I("parts", pd->active);
 
+  // blocks are packed, every lane gathers its own parent's pose
+  const float* parent_px = od->position_orientation.position_x;
+  const float* parent_py = od->position_orientation.position_y;
+  const float* parent_pox = od->position_orientation.orientation_x;
+  const float* parent_poy = od->position_orientation.orientation_y;
+  const __m256i hot_stride = _mm256_set1_epi32(OBJECTS_HOT_STRIDE);
+  const __m256i lane_mask = _mm256_set1_epi32(7);
+
+  // level 0 for everyone (mounted parts are overwritten by their level's pass),
+  // lanes past active read stale (but committed) parent indices, their results are never used
   for (uint32_t i = 0; i < pd->active; i += 8) {
-    uint32_t parent_idx = GET_ORDINAL(pd->parent_id[i]);
-
-    _ASSERT(parent_idx >= 0 && parent_idx <= od->active);
-    _ASSERT(od->parts_start_idx[parent_idx] <= i && od->parts_start_idx[parent_idx] + od->parts_count[parent_idx] >= i);
-
-    __m256 parent_x = _mm256_set1_ps(od->position_orientation.position_x[parent_idx]);
-    __m256 parent_y = _mm256_set1_ps(od->position_orientation.position_y[parent_idx]);
-
-    __m256 parent_ox = _mm256_set1_ps(od->position_orientation.orientation_x[parent_idx]);
-    __m256 parent_oy = _mm256_set1_ps(od->position_orientation.orientation_y[parent_idx]);
-
-    __m256 local_x = _mm256_load_ps(&pd->local_offset_x[i]);
-    __m256 local_y = _mm256_load_ps(&pd->local_offset_y[i]);
-
-    // rotate local offset by parent's orientation (CCW, matching renderer)
-    // x' = x*cos - y*sin, y' = x*sin + y*cos
-    __m256 rotated_lx = _mm256_fmsub_ps(local_x, parent_ox, _mm256_mul_ps(local_y, parent_oy));
-    __m256 rotated_ly = _mm256_fmadd_ps(local_x, parent_oy, _mm256_mul_ps(local_y, parent_ox));
-
-    // set world position
-    __m256 world_px = _mm256_add_ps(parent_x, rotated_lx);
-    __m256 world_py = _mm256_add_ps(parent_y, rotated_ly);
-    _mm256_store_ps(&pd->world_position_orientation.position_x[i], world_px);
-    _mm256_store_ps(&pd->world_position_orientation.position_y[i], world_py);
-
-    __m256 local_ox = _mm256_load_ps(&pd->local_orientation_x[i]);
-    __m256 local_oy = _mm256_load_ps(&pd->local_orientation_y[i]);
-    // compose orientations (CCW angle addition via complex multiplication)
-    // world = local * parent: ox' = lox*pox - loy*poy, oy' = lox*poy + loy*pox
-    __m256 world_ox = _mm256_fmsub_ps(local_ox, parent_ox, _mm256_mul_ps(local_oy, parent_oy));
-    __m256 world_oy = _mm256_fmadd_ps(local_ox, parent_oy, _mm256_mul_ps(local_oy, parent_ox));
-
-    // normalize world orientation
-    __m256 length_sq =
-        _mm256_rsqrt_ps(_mm256_add_ps(_mm256_mul_ps(world_ox, world_ox), _mm256_mul_ps(world_oy, world_oy)));
-    world_ox = _mm256_mul_ps(world_ox, length_sq);
-    world_oy = _mm256_mul_ps(world_oy, length_sq);
-    _mm256_store_ps(&pd->world_position_orientation.orientation_x[i], world_ox);
-    _mm256_store_ps(&pd->world_position_orientation.orientation_y[i], world_oy);
+    _ASSERT(pd->parent_index[i] < od->active);
+
+    // HOT_IDX per lane
+    __m256i parent_idx = _mm256_load_si256((const __m256i*)&pd->parent_index[i]);
+    __m256i hot = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(parent_idx, 3), hot_stride),
+                                   _mm256_and_si256(parent_idx, lane_mask));
+
+    __m256 pose[4];
+    _parts_compose(pd, i, _mm256_i32gather_ps(parent_px, hot, 4), _mm256_i32gather_ps(parent_py, hot, 4),
+                   _mm256_i32gather_ps(parent_pox, hot, 4), _mm256_i32gather_ps(parent_poy, hot, 4), pose);
+
+    _mm256_store_ps(&pd->world_position_orientation.position_x[i], pose[0]);
+    _mm256_store_ps(&pd->world_position_orientation.position_y[i], pose[1]);
+    _mm256_store_ps(&pd->world_position_orientation.orientation_x[i], pose[2]);
+    _mm256_store_ps(&pd->world_position_orientation.orientation_y[i], pose[3]);
+  }
+
+  for (uint32_t level = 1; level <= pd->levels; level++) {
+    _parts_level_transform(pd, level);
   }
   PROFILE_ZONE_END();
 }
@@ -270,23 +265,32 @@ static void _particle_manager_tick(void) {
   struct particles_data* pd = entity_manager_get_particles();
 
   _particle_manager_euler(pd);
+#ifdef PARTICLES_AGE_RING
+  _particle_manager_ttl(pd);
+  entity_manager_retire_particles((const uint8_t*)pd->temporary);
+#else
   if (_particle_manager_ttl(pd) < pd->active) {
-    entity_manager_pack_particles();
+    entity_manager_pack_particles((const uint8_t*)pd->temporary);
   }
+#endif
   PROFILE_ZONE_END();
 }
 
-void physics_engine_tick(void) {
-  messaging_send(RECIPIENT_ID_BROADCAST, CREATE_MESSAGE(MESSAGE_BROADCAST_120HZ_BEFORE_PHYSICS, 0, 0));
-
-  PROFILE_ZONE("physics_engine_tick");
-
-  _objects_tick();
-  _particle_manager_tick();
-
-  PROFILE_ZONE_END();
-
-  messaging_send(RECIPIENT_ID_BROADCAST, CREATE_MESSAGE(MESSAGE_BROADCAST_120HZ_AFTER_PHYSICS, 0, 0));
+void physics_engine_initialize(void) {
+  // objects and particles don't touch each other's data, they run in parallel
+  system_t objects = { .name = "objects_physics",
+                       .phase = SYSTEM_PHASE_PHYSICS,
+                       .reads = COMPONENT_OBJECTS_THRUST,
+                       .writes = COMPONENT_OBJECTS_TRANSFORM | COMPONENT_PARTS_TRANSFORM,
+                       .run = _objects_tick };
+  scheduler_register(&objects);
+
+  system_t particles = { .name = "particles_physics",
+                         .phase = SYSTEM_PHASE_PHYSICS,
+                         .reads = 0,
+                         .writes = COMPONENT_PARTICLES | COMPONENT_FRAGMENTS,
+                         .run = _particle_manager_tick };
+  scheduler_register(&particles);
 }
 
 #ifdef UNIT_TESTS
@@ -297,35 +301,27 @@ void physics_test__parts_world_transform_rotations(void) {
   struct objects_data* od = entity_manager_get_objects();
   struct parts_data* pd = entity_manager_get_parts();
 
-  od->active = 2;
-  od->position_orientation.orientation_x[0] = 0.0f;
-  od->position_orientation.orientation_y[0] = 1.0f;
-
-  od->position_orientation.orientation_x[1] = 1.0f;
-  od->position_orientation.orientation_y[1] = 0.0f;
-
-  od->parts_start_idx[0] = 0;
-  od->parts_count[0] = 2;
+  entity_id_t ids[2] = { entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 2),
+                         entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 2) };
 
-  od->parts_start_idx[1] = 8;
-  od->parts_count[1] = 2;
+  od->position_orientation.orientation_x[HOT_IDX(0)] = 0.0f;
+  od->position_orientation.orientation_y[HOT_IDX(0)] = 1.0f;
 
+  od->position_orientation.orientation_x[HOT_IDX(1)] = 1.0f;
+  od->position_orientation.orientation_y[HOT_IDX(1)] = 0.0f;
 
-  pd->active = 16;
   for (int i = 0; i < 2; i++) {
-    od->parts_start_idx[i] = 8 * i;
-    od->parts_count[i] = 2;
+    uint32_t start = od->parts_start_idx[i];
+    TEST_ASSERT_EQUAL_UINT32(ids[i]._, pd->parent_id[start]._);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)i, pd->parent_index[start]);
 
-    pd->parent_id[8 * i] = OBJECT_ID_WITH_TYPE(i, ENTITY_TYPE_ANY);
+    pd->local_orientation_x[start + 0] = 1.0f;
+    pd->local_orientation_y[start + 0] = 0.0f;
 
-    pd->local_orientation_x[8 * i + 0] = 1.0f;
-    pd->local_orientation_y[8 * i + 0] = 0.0f;
-
-    pd->local_orientation_x[8 * i + 1] = 0.0f;
-    pd->local_orientation_y[8 * i + 1] = 1.0f;
+    pd->local_orientation_x[start + 1] = 0.0f;
+    pd->local_orientation_y[start + 1] = 1.0f;
   }
 
-
   _parts_world_transform(od, pd);
 
   TEST_ASSERT_FLOAT_WITHIN(0.001f, -1.0f, pd->world_position_orientation.orientation_x[0]);
@@ -334,10 +330,90 @@ void physics_test__parts_world_transform_rotations(void) {
   TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, pd->world_position_orientation.orientation_x[1]);
   TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.orientation_y[1]);
 
-  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.orientation_x[8]);
-  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, pd->world_position_orientation.orientation_y[8]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.orientation_x[2]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, pd->world_position_orientation.orientation_y[2]);
 
-  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, pd->world_position_orientation.orientation_x[9]);
-  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.orientation_y[9]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, pd->world_position_orientation.orientation_x[3]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.orientation_y[3]);
+}
+
+// Test: packed blocks share an 8-lane group, every lane follows its own parent
+void physics_test__parts_gather_parent_per_lane(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  struct parts_data* pd = entity_manager_get_parts();
+
+  uint32_t counts[3] = { 1, 3, 2 };
+  for (uint32_t s = 0; s < 3; s++) {
+    entity_id_t id = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, counts[s]);
+    uint32_t idx = entity_manager_object_index(id);
+    od->position_orientation.position_x[HOT_IDX(idx)] = 100.0f * (float)(s + 1);
+    od->position_orientation.position_y[HOT_IDX(idx)] = -10.0f * (float)(s + 1);
+    for (uint32_t p = 0; p < counts[s]; p++) {
+      pd->local_offset_x[od->parts_start_idx[idx] + p] = (float)p;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(6, pd->active);
+
+  _parts_world_transform(od, pd);
+
+  for (uint32_t i = 0; i < pd->active; i++) {
+    uint32_t parent = pd->parent_index[i];
+    float expected_x = od->position_orientation.position_x[HOT_IDX(parent)] + pd->local_offset_x[i];
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, expected_x, pd->world_position_orientation.position_x[i]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, od->position_orientation.position_y[HOT_IDX(parent)],
+                             pd->world_position_orientation.position_y[i]);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 301.0f, pd->world_position_orientation.position_x[5]);
+}
+
+// Test: a part mounted on a mounted part follows the whole chain, level 0 parts keep the object pose
+void physics_test__parts_mounted_on_parts(void) {
+  struct objects_data* od = entity_manager_get_objects();
+  struct parts_data* pd = entity_manager_get_parts();
+
+  entity_id_t lead = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 2);
+  entity_id_t id = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 4);
+  uint32_t idx = entity_manager_object_index(id);
+  uint32_t start = od->parts_start_idx[idx];
+
+  // ship at (10, 0) facing +y, pylon at +x turned by 90 degrees, engine 2 along the pylon, nozzle 1 further
+  od->position_orientation.position_x[HOT_IDX(idx)] = 10.0f;
+  od->position_orientation.orientation_x[HOT_IDX(idx)] = 0.0f;
+  od->position_orientation.orientation_y[HOT_IDX(idx)] = 1.0f;
+
+  pd->local_offset_x[start + 0] = 5.0f;
+  pd->local_offset_x[start + 1] = 1.0f;
+  pd->local_orientation_x[start + 1] = 0.0f;
+  pd->local_orientation_y[start + 1] = 1.0f;
+  pd->local_offset_x[start + 2] = 2.0f;
+  pd->local_offset_x[start + 3] = 1.0f;
+
+  entity_manager_mount_part(start + 2, start + 1);
+  entity_manager_mount_part(start + 3, start + 2);
+  TEST_ASSERT_EQUAL_UINT32(2, pd->levels);
+  TEST_ASSERT_EQUAL_UINT8(2, pd->level[start + 3]);
+
+  _parts_world_transform(od, pd);
+
+  // level 0: rotated by the ship only
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, pd->world_position_orientation.position_x[start]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 5.0f, pd->world_position_orientation.position_y[start]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, pd->world_position_orientation.position_x[start + 1]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.position_y[start + 1]);
+  // pylon faces -x in the world, the engine sits 2 behind it and inherits the orientation
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 8.0f, pd->world_position_orientation.position_x[start + 2]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.position_y[start + 2]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, -1.0f, pd->world_position_orientation.orientation_x[start + 2]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 7.0f, pd->world_position_orientation.position_x[start + 3]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.position_y[start + 3]);
+
+  // despawning the ship in front shifts the block down, the relative offsets still find the right parents
+  entity_manager_despawn_object(lead);
+  start = od->parts_start_idx[entity_manager_object_index(id)];
+  TEST_ASSERT_EQUAL_UINT32(0, start);
+
+  _parts_world_transform(od, pd);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 7.0f, pd->world_position_orientation.position_x[start + 3]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pd->world_position_orientation.position_y[start + 3]);
 }
 #endif
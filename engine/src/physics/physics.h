@@ -1,3 +1,5 @@
 #pragma once
 
-void physics_engine_tick(void);
+void physics_engine_initialize(void); // registers the physics systems
+
+#define GRAVITATIONAL_CONSTANT 6.67430f // e-1f
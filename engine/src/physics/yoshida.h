@@ -0,0 +1,71 @@
+#pragma once
+
+#include "core/core.h"
+
+#include <immintrin.h>
+
+// Yoshida integration passes over the objects' hot columns, header-only so physics.c (OBJECTS_HOT_STRIDE) and
+// tools/layout_bench.c (both layouts) run the same loops. Columns are stored in 8-lane tiles, stride elements
+// apart; end = tiled_index(stride, active) with active a multiple of 8.
+
+#define YOSHIDA_C1 1.3512071919596578f
+#define YOSHIDA_C2 -1.7024143839193155f
+#define YOSHIDA_C3 1.3512071919596578f
+
+// acceleration = thrust * orientation / mass
+static inline void yoshida_thrust_acceleration(const float* __restrict thrust, const float* __restrict mass,
+                                               const float* __restrict ox, const float* __restrict oy,
+                                               float* __restrict accx, float* __restrict accy, uint32_t stride,
+                                               uint32_t end) {
+  __m256 epsilon = _mm256_set1_ps(0.0001f); // avoid division by zero
+
+  const float* thrust_end = thrust + end;
+  for (; thrust < thrust_end; thrust += stride, mass += stride, ox += stride, oy += stride, accx += stride,
+                              accy += stride) {
+    __m256 thrusts = _mm256_load_ps(thrust);
+    __m256 masses = _mm256_max_ps(_mm256_load_ps(mass), epsilon);
+    __m256 orientations_x = _mm256_load_ps(ox);
+    __m256 orientations_y = _mm256_load_ps(oy);
+
+    __m256 acc_x = _mm256_div_ps(_mm256_mul_ps(thrusts, orientations_x), masses);
+    __m256 acc_y = _mm256_div_ps(_mm256_mul_ps(thrusts, orientations_y), masses);
+
+    _mm256_store_ps(accx, acc_x);
+    _mm256_store_ps(accy, acc_y);
+  }
+}
+
+// one substep: half kick, drift, half kick
+static inline void yoshida_step(float* __restrict px, float* __restrict py, float* __restrict vx, float* __restrict vy,
+                                const float* __restrict ax, const float* __restrict ay, uint32_t stride, uint32_t end,
+                                float step, float hstep) {
+  __m256 w = _mm256_set1_ps(step);
+  __m256 whalf = _mm256_set1_ps(hstep);
+
+  const float* end_px = px + end;
+  for (; px < end_px; px += stride, py += stride, vx += stride, vy += stride, ax += stride, ay += stride) {
+    __m256 acc_x = _mm256_load_ps(ax);
+    __m256 acc_y = _mm256_load_ps(ay);
+
+    __m256 velocity_x = _mm256_load_ps(vx);
+    __m256 velocity_y = _mm256_load_ps(vy);
+
+    __m256 pos_x = _mm256_load_ps(px);
+    __m256 pos_y = _mm256_load_ps(py);
+
+    velocity_x = _mm256_fmadd_ps(acc_x, whalf, velocity_x); // a*b+c
+    velocity_y = _mm256_fmadd_ps(acc_y, whalf, velocity_y);
+
+    pos_x = _mm256_fmadd_ps(velocity_x, w, pos_x);
+    pos_y = _mm256_fmadd_ps(velocity_y, w, pos_y);
+
+    velocity_x = _mm256_fmadd_ps(acc_x, whalf, velocity_x);
+    velocity_y = _mm256_fmadd_ps(acc_y, whalf, velocity_y);
+
+    _mm256_store_ps(px, pos_x);
+    _mm256_store_ps(py, pos_y);
+
+    _mm256_store_ps(vx, velocity_x);
+    _mm256_store_ps(vy, velocity_y);
+  }
+}
@@ -1,7 +1,12 @@
 #include "platform.h"
 
 #include <Windows.h>
+#include <intrin.h>
 
 void platform_clear_memory(void* ptr, size_t size) {
   RtlSecureZeroMemory(ptr, size);
 }
+
+void platform_copy_memory(void* dst, const void* src, size_t size) {
+  __movsb((unsigned char*)dst, (const unsigned char*)src, size);
+}
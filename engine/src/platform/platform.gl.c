@@ -6,11 +6,6 @@
 
 #pragma comment(lib, "opengl32.lib")
 
-#include "../generated/renderer.gen.h"
-#include "../entity/entity.h"
-
-static color_t white_ = { 255, 255, 255, 255 };
-
 void _gl_initialize(void) {
   glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
@@ -22,33 +17,6 @@ void _gl_initialize(void) {
   glLoadIdentity();
 }
 
-void platform_renderer_draw_models(size_t model_count, const color_t* colors,
-                                   const position_orientation_t* position_orientation, const uint16_t* model_indices) {
-  for (size_t i = 0; i < model_count; i++) {
-    if (model_indices[i] == 0xFFFF) {
-      continue;
-    }
-
-    glPushMatrix();
-
-    // clang-format off
-    float m[16] = {
-      position_orientation->orientation_x[i], position_orientation->orientation_y[i], 0.0, 0.0,
-      -position_orientation->orientation_y[i], position_orientation->orientation_x[i], 0.0, 0.0,
-      0.0              , 0.0               , 1.0, 0.0,
-      position_orientation->position_x[i]   , position_orientation->position_y[i]    , 0.0, 1.0,
-    };
-    // clang-format on
-
-    glMultMatrixf(m);
-
-    _generated_draw_model(colors ? colors[i] : white_, model_indices[i]);
-    PROFILE_DRAW_CALL();
-
-    glPopMatrix();
-  }
-}
-
 void platform_debug_draw_line(float x1, float y1, float x2, float y2, color_t color) {
   glColor4ub(color.r, color.g, color.b, color.a);
   glLineWidth(1.0f);
@@ -79,6 +47,33 @@ void platform_renderer_draw_stars(size_t count, const float* vertices, const col
   glDisable(GL_BLEND);
 }
 
+static void _draw_arrays(GLenum mode, size_t count, const float* vertices, const color_t* colors) {
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+
+  glVertexPointer(2, GL_FLOAT, 0, vertices);
+  glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors);
+
+  glDrawArrays(mode, 0, (GLsizei)count);
+  PROFILE_DRAW_CALL();
+
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void platform_renderer_draw_lines(size_t count, const float* vertices, const color_t* colors, float width) {
+  if (count == 0) return;
+
+  glLineWidth(width);
+  _draw_arrays(GL_LINES, count, vertices, colors);
+}
+
+void platform_renderer_draw_triangles(size_t count, const float* vertices, const color_t* colors) {
+  if (count == 0) return;
+
+  _draw_arrays(GL_TRIANGLES, count, vertices, colors);
+}
+
 void platform_renderer_report_stats(void) {
   PROFILE_DRAW_CALLS_RESET();
 }
@@ -0,0 +1,279 @@
+#include "platform.h"
+#include "debug/profiler.h"
+
+#include <Windows.h>
+#include <gl/GL.h>
+#include <stddef.h>
+
+// GL 3.3 instanced renderer, next to the fixed-function one in platform.gl.c. It shares the compatibility context
+// the window creates: the entry points come from wglGetProcAddress and the state it binds is unbound after every
+// draw, so the fixed-function client arrays keep working.
+
+typedef char GLchar;
+typedef ptrdiff_t GLsizeiptr;
+typedef ptrdiff_t GLintptr;
+
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_STREAM_DRAW 0x88E0
+#define GL_STATIC_DRAW 0x88E4
+#define GL_DYNAMIC_DRAW 0x88E8
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+
+static struct {
+  void(APIENTRY* GenVertexArrays)(GLsizei n, GLuint* arrays);
+  void(APIENTRY* BindVertexArray)(GLuint array);
+  void(APIENTRY* GenBuffers)(GLsizei n, GLuint* buffers);
+  void(APIENTRY* BindBuffer)(GLenum target, GLuint buffer);
+  void(APIENTRY* BufferData)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+  void(APIENTRY* BufferSubData)(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+  void(APIENTRY* VertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                                      const void* pointer);
+  void(APIENTRY* EnableVertexAttribArray)(GLuint index);
+  void(APIENTRY* DisableVertexAttribArray)(GLuint index);
+  void(APIENTRY* VertexAttrib4f)(GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+  void(APIENTRY* VertexAttribDivisor)(GLuint index, GLuint divisor);
+  void(APIENTRY* DrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+  GLuint(APIENTRY* CreateShader)(GLenum type);
+  void(APIENTRY* ShaderSource)(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+  void(APIENTRY* CompileShader)(GLuint shader);
+  void(APIENTRY* GetShaderiv)(GLuint shader, GLenum pname, GLint* params);
+  void(APIENTRY* DeleteShader)(GLuint shader);
+  GLuint(APIENTRY* CreateProgram)(void);
+  void(APIENTRY* AttachShader)(GLuint program, GLuint shader);
+  void(APIENTRY* LinkProgram)(GLuint program);
+  void(APIENTRY* GetProgramiv)(GLuint program, GLenum pname, GLint* params);
+  void(APIENTRY* UseProgram)(GLuint program);
+  GLint(APIENTRY* GetUniformLocation)(GLuint program, const GLchar* name);
+  void(APIENTRY* Uniform2f)(GLint location, GLfloat v0, GLfloat v1);
+} gl_;
+
+static struct {
+  GLuint program;
+  GLuint vao;
+  GLuint geometry; // int8 x,y per vertex
+  GLuint colors;   // packed color_t per colored vertex
+  GLuint instances;
+  uint32_t max_instances;
+} instanced_;
+
+// attribute locations, match the shader
+enum {
+  ATTRIBUTE_VERTEX = 0,
+  ATTRIBUTE_COLOR,
+  ATTRIBUTE_POSE,
+  ATTRIBUTE_HEAT,
+};
+
+static const GLchar* vertex_shader_ =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 vertex;\n"
+    "layout(location = 1) in vec4 color;\n"
+    "layout(location = 2) in vec4 pose;\n" // x, y, ox, oy
+    "layout(location = 3) in vec4 heat;\n"
+    "uniform vec2 screen;\n" // 2 / window size
+    "out vec4 vertex_color;\n"
+    "void main() {\n"
+    "  vec2 world = pose.xy + vec2(pose.z * vertex.x - pose.w * vertex.y, pose.w * vertex.x + pose.z * vertex.y);\n"
+    "  gl_Position = vec4(world.x * screen.x - 1.0, 1.0 - world.y * screen.y, 0.0, 1.0);\n"
+    "  vertex_color = color == vec4(0.0) ? heat : color;\n"
+    "}\n";
+
+static const GLchar* fragment_shader_ =
+    "#version 330 core\n"
+    "in vec4 vertex_color;\n"
+    "out vec4 target;\n"
+    "void main() {\n"
+    "  target = vertex_color;\n"
+    "}\n";
+
+static bool _gl_load(PROC* slot, const char* name) {
+  PROC proc = wglGetProcAddress(name);
+  // some drivers return small values instead of NULL for entry points they don't have
+  if ((uintptr_t)proc <= 3 || (intptr_t)proc == -1) {
+    return false;
+  }
+  *slot = proc;
+  return true;
+}
+
+static bool _gl_load_all(void) {
+  return _gl_load((PROC*)&gl_.GenVertexArrays, "glGenVertexArrays") &&
+         _gl_load((PROC*)&gl_.BindVertexArray, "glBindVertexArray") &&
+         _gl_load((PROC*)&gl_.GenBuffers, "glGenBuffers") && _gl_load((PROC*)&gl_.BindBuffer, "glBindBuffer") &&
+         _gl_load((PROC*)&gl_.BufferData, "glBufferData") &&
+         _gl_load((PROC*)&gl_.BufferSubData, "glBufferSubData") &&
+         _gl_load((PROC*)&gl_.VertexAttribPointer, "glVertexAttribPointer") &&
+         _gl_load((PROC*)&gl_.EnableVertexAttribArray, "glEnableVertexAttribArray") &&
+         _gl_load((PROC*)&gl_.DisableVertexAttribArray, "glDisableVertexAttribArray") &&
+         _gl_load((PROC*)&gl_.VertexAttrib4f, "glVertexAttrib4f") &&
+         _gl_load((PROC*)&gl_.VertexAttribDivisor, "glVertexAttribDivisor") &&
+         _gl_load((PROC*)&gl_.DrawArraysInstanced, "glDrawArraysInstanced") &&
+         _gl_load((PROC*)&gl_.CreateShader, "glCreateShader") &&
+         _gl_load((PROC*)&gl_.ShaderSource, "glShaderSource") &&
+         _gl_load((PROC*)&gl_.CompileShader, "glCompileShader") &&
+         _gl_load((PROC*)&gl_.GetShaderiv, "glGetShaderiv") &&
+         _gl_load((PROC*)&gl_.DeleteShader, "glDeleteShader") &&
+         _gl_load((PROC*)&gl_.CreateProgram, "glCreateProgram") &&
+         _gl_load((PROC*)&gl_.AttachShader, "glAttachShader") &&
+         _gl_load((PROC*)&gl_.LinkProgram, "glLinkProgram") &&
+         _gl_load((PROC*)&gl_.GetProgramiv, "glGetProgramiv") &&
+         _gl_load((PROC*)&gl_.UseProgram, "glUseProgram") &&
+         _gl_load((PROC*)&gl_.GetUniformLocation, "glGetUniformLocation") &&
+         _gl_load((PROC*)&gl_.Uniform2f, "glUniform2f");
+}
+
+// "major.minor ..." of the current context, no context at all reads as too old
+static bool _gl_version_at_least_33(void) {
+  const GLubyte* version = glGetString(GL_VERSION);
+  if (version == NULL || version[0] < '0' || version[0] > '9' || version[1] != '.') {
+    return false;
+  }
+  return version[0] > '3' || (version[0] == '3' && version[2] >= '3' && version[2] <= '9');
+}
+
+static GLuint _gl_shader(GLenum type, const GLchar* source) {
+  GLuint shader = gl_.CreateShader(type);
+  gl_.ShaderSource(shader, 1, &source, NULL);
+  gl_.CompileShader(shader);
+
+  GLint compiled = GL_FALSE;
+  gl_.GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+  if (!compiled) {
+    gl_.DeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+static GLuint _gl_program(void) {
+  GLuint vertex = _gl_shader(GL_VERTEX_SHADER, vertex_shader_);
+  GLuint fragment = _gl_shader(GL_FRAGMENT_SHADER, fragment_shader_);
+  if (vertex == 0 || fragment == 0) {
+    return 0;
+  }
+
+  GLuint program = gl_.CreateProgram();
+  gl_.AttachShader(program, vertex);
+  gl_.AttachShader(program, fragment);
+  gl_.LinkProgram(program);
+  gl_.DeleteShader(vertex); // flagged only, the program keeps them
+  gl_.DeleteShader(fragment);
+
+  GLint linked = GL_FALSE;
+  gl_.GetProgramiv(program, GL_LINK_STATUS, &linked);
+  return linked ? program : 0;
+}
+
+// instance attributes of the draw starting at first_instance, there is no base instance in 3.3
+static void _instance_attributes(uint32_t first_instance) {
+  size_t offset = first_instance * sizeof(model_instance_t);
+  gl_.VertexAttribPointer(ATTRIBUTE_POSE, 4, GL_FLOAT, GL_FALSE, sizeof(model_instance_t),
+                          (const void*)(offset + offsetof(model_instance_t, x)));
+  gl_.VertexAttribPointer(ATTRIBUTE_HEAT, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(model_instance_t),
+                          (const void*)(offset + offsetof(model_instance_t, color)));
+}
+
+bool platform_renderer_instanced_initialize(uint32_t vertex_count, uint32_t colored_count, uint32_t max_instances) {
+  if (!_gl_version_at_least_33() || !_gl_load_all()) {
+    return false;
+  }
+
+  instanced_.program = _gl_program();
+  if (instanced_.program == 0) {
+    return false;
+  }
+  instanced_.max_instances = max_instances;
+
+  gl_.GenVertexArrays(1, &instanced_.vao);
+  gl_.BindVertexArray(instanced_.vao);
+
+  gl_.GenBuffers(1, &instanced_.geometry);
+  gl_.BindBuffer(GL_ARRAY_BUFFER, instanced_.geometry);
+  gl_.BufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertex_count * 2, NULL, GL_DYNAMIC_DRAW);
+  gl_.VertexAttribPointer(ATTRIBUTE_VERTEX, 2, GL_BYTE, GL_FALSE, 2, NULL);
+  gl_.EnableVertexAttribArray(ATTRIBUTE_VERTEX);
+
+  gl_.GenBuffers(1, &instanced_.colors);
+  gl_.BindBuffer(GL_ARRAY_BUFFER, instanced_.colors);
+  gl_.BufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(colored_count + 1) * sizeof(color_t), NULL, GL_STATIC_DRAW);
+  gl_.VertexAttribPointer(ATTRIBUTE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(color_t), NULL);
+
+  gl_.GenBuffers(1, &instanced_.instances);
+  gl_.BindBuffer(GL_ARRAY_BUFFER, instanced_.instances);
+  gl_.BufferData(GL_ARRAY_BUFFER, (GLsizeiptr)max_instances * sizeof(model_instance_t), NULL, GL_STREAM_DRAW);
+  _instance_attributes(0);
+  gl_.VertexAttribDivisor(ATTRIBUTE_POSE, 1);
+  gl_.VertexAttribDivisor(ATTRIBUTE_HEAT, 1);
+  gl_.EnableVertexAttribArray(ATTRIBUTE_POSE);
+  gl_.EnableVertexAttribArray(ATTRIBUTE_HEAT);
+
+  gl_.BindVertexArray(0);
+  gl_.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+  gl_.UseProgram(instanced_.program);
+  gl_.Uniform2f(gl_.GetUniformLocation(instanced_.program, "screen"), 2.0f / WINDOW_WIDTH, 2.0f / WINDOW_HEIGHT);
+  gl_.UseProgram(0);
+  return true;
+}
+
+void platform_renderer_instanced_upload(uint32_t first_vertex, uint32_t vertex_count, const int8_t* vertices,
+                                        const uint32_t* colors) {
+  if (vertex_count == 0) return;
+
+  gl_.BindBuffer(GL_ARRAY_BUFFER, instanced_.geometry);
+  gl_.BufferSubData(GL_ARRAY_BUFFER, (GLintptr)first_vertex * 2, (GLsizeiptr)vertex_count * 2, vertices);
+  if (colors) {
+    gl_.BindBuffer(GL_ARRAY_BUFFER, instanced_.colors);
+    gl_.BufferSubData(GL_ARRAY_BUFFER, (GLintptr)first_vertex * sizeof(uint32_t),
+                      (GLsizeiptr)vertex_count * sizeof(uint32_t), colors);
+  }
+  gl_.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void platform_renderer_draw_instanced(const model_instance_t* instances, uint32_t instance_count,
+                                      const instanced_draw_t* draws, uint32_t draw_count) {
+  if (instance_count == 0 || draw_count == 0) return;
+  _ASSERT(instance_count <= instanced_.max_instances);
+
+  gl_.UseProgram(instanced_.program);
+  gl_.BindVertexArray(instanced_.vao);
+
+  // orphan last draw's storage instead of waiting for it
+  gl_.BindBuffer(GL_ARRAY_BUFFER, instanced_.instances);
+  gl_.BufferData(GL_ARRAY_BUFFER, (GLsizeiptr)instanced_.max_instances * sizeof(model_instance_t), NULL,
+                 GL_STREAM_DRAW);
+  gl_.BufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)instance_count * sizeof(model_instance_t), instances);
+
+  int colored = -1;
+  float width = -1.0f;
+  for (uint32_t d = 0; d < draw_count; d++) {
+    const instanced_draw_t* draw = &draws[d];
+
+    if (!draw->triangles && draw->width != width) {
+      width = draw->width;
+      glLineWidth(width);
+    }
+
+    if (draw->colored != colored) {
+      colored = draw->colored;
+      if (colored) {
+        gl_.EnableVertexAttribArray(ATTRIBUTE_COLOR);
+      } else {
+        gl_.DisableVertexAttribArray(ATTRIBUTE_COLOR);
+        gl_.VertexAttrib4f(ATTRIBUTE_COLOR, 0.0f, 0.0f, 0.0f, 0.0f); // all heat
+      }
+    }
+
+    _instance_attributes(draw->first_instance);
+    gl_.DrawArraysInstanced(draw->triangles ? GL_TRIANGLES : GL_LINES, (GLint)draw->first_vertex,
+                            (GLsizei)draw->vertex_count, (GLsizei)draw->instance_count);
+    PROFILE_DRAW_CALL();
+  }
+
+  gl_.BindVertexArray(0);
+  gl_.BindBuffer(GL_ARRAY_BUFFER, 0);
+  gl_.UseProgram(0);
+}
@@ -32,9 +32,6 @@ bool platform_tick_pending(void);
 void platform_frame_start(void);
 void platform_frame_end(void);
 
-void platform_renderer_draw_models(size_t model_count, const color_t* colors,
-                                   const position_orientation_t* position_orientation, const uint16_t* model_indices);
-
 const struct input_state* platform_get_input_state(void);
 bool platform_input_is_button_down(enum buttons button);
 bool platform_input_is_key_down(enum keys key);
@@ -45,10 +42,67 @@ bool platform_input_is_key_down(enum keys key);
 void* platform_retrieve_memory(size_t memory_size);
 void platform_clear_memory(void* ptr, size_t size);
 
+// Reserved address ranges for growable storage (outside the fixed heap)
+// reserve returns page aligned address space without backing memory, commit backs [ptr, ptr + size)
+// with zeroed pages. Committing an already committed range is allowed.
+void* platform_reserve_memory(size_t size);
+void platform_commit_memory(void* ptr, size_t size);
+// forward copy, the ranges may overlap only when dst < src
+void platform_copy_memory(void* dst, const void* src, size_t size);
+
+// Memory-mapped files
+// map_file maps an existing file read-only and returns its size, create_mapped_file creates (or truncates) a file
+// of `size` bytes and maps it read/write. Both return NULL on failure. unmap releases either view, a writable
+// view is flushed to the file by the OS.
+const void* platform_map_file(const char* path, size_t* size);
+void* platform_create_mapped_file(const char* path, size_t size);
+void platform_unmap_file(const void* view);
+
+// true when the process was started with `argument` as one of its command line arguments (exact match)
+bool platform_has_argument(const char* argument);
+
+// Worker threads
+// runs fn(ctx, index) for every index in [0, count) spread over the worker threads and the calling thread,
+// returns once all of them finished. Not reentrant, call from the main thread only.
+typedef void (*platform_job_fn)(void* ctx, uint32_t index);
+void platform_parallel_for(platform_job_fn fn, void* ctx, uint32_t count);
+
 void platform_debug_draw_line(float x1, float y1, float x2, float y2, color_t color);
 
 // Star field rendering (vertices = interleaved x,y pairs)
 void platform_renderer_draw_stars(size_t count, const float* vertices, const color_t* colors);
 
+// Batched model geometry (graphics/lines.h), world space vertices (interleaved x,y) with a color each
+void platform_renderer_draw_lines(size_t count, const float* vertices, const color_t* colors, float width);
+void platform_renderer_draw_triangles(size_t count, const float* vertices, const color_t* colors);
+
+// Instanced model rendering (graphics/instanced.h, GL 3.3)
+// Geometry is model space int8 x,y pairs in one vertex buffer, the first colored_count vertices have a packed
+// color_t each (0 = the instance's heat color), the rest are drawn in the heat color. Instances are streamed
+// every draw, one instanced draw per range of the geometry.
+typedef struct {
+  float x, y;
+  float ox, oy;
+  color_t color; // heat
+} model_instance_t;
+
+typedef struct {
+  uint32_t first_vertex;
+  uint32_t vertex_count;
+  uint32_t first_instance;
+  uint32_t instance_count;
+  float width;       // stroke width of the lines
+  uint8_t triangles; // hull fill, otherwise lines
+  uint8_t colored;   // the vertices have colors of their own
+} instanced_draw_t;
+
+// false (and nothing is kept) when the context can't do GL 3.3
+bool platform_renderer_instanced_initialize(uint32_t vertex_count, uint32_t colored_count, uint32_t max_instances);
+// colors only for ranges inside colored_count, NULL otherwise
+void platform_renderer_instanced_upload(uint32_t first_vertex, uint32_t vertex_count, const int8_t* vertices,
+                                        const uint32_t* colors);
+void platform_renderer_draw_instanced(const model_instance_t* instances, uint32_t instance_count,
+                                      const instanced_draw_t* draws, uint32_t draw_count);
+
 // Call at end of frame to report draw call stats to profiler
 void platform_renderer_report_stats(void);
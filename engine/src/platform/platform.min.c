@@ -14,6 +14,7 @@ static struct input_state input_state_ = { 0 };
 int _fltused = 0;
 
 void _memory_initialize(void);
+void _workers_initialize(void);
 void _math_initialize(void);
 void _gl_initialize(void);
 
@@ -100,6 +101,7 @@ static void _platform_create_window(void) {
 
 void platform_initialize(void) {
   _memory_initialize();
+  _workers_initialize();
   _platform_create_window();
   _gl_initialize();
   _math_initialize();
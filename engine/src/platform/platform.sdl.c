@@ -19,6 +19,7 @@ static uint32_t prev_time_;
 static double ticks_;
 
 void _memory_initialize(void);
+void _workers_initialize(void);
 void _gl_initialize(void);
 void _math_initialize(void);
 
@@ -46,6 +47,7 @@ static void _platform_create_window(void) {
 
 void platform_initialize(void) {
   _memory_initialize();
+  _workers_initialize();
   _platform_create_window();
   _gl_initialize();
   _math_initialize();
@@ -25,3 +25,176 @@ void* platform_retrieve_memory(size_t memory_size) {
   PROFILE_ALLOC(ptr, memory_size);
   return ptr;
 }
+
+void* platform_reserve_memory(size_t size) {
+  void* ptr = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_READWRITE);
+  _ASSERT(ptr != NULL);
+  return ptr;
+}
+
+void platform_commit_memory(void* ptr, size_t size) {
+  if (size == 0) {
+    return;
+  }
+
+  void* committed = VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE);
+  _ASSERT(committed != NULL);
+  PROFILE_ALLOC(committed, size);
+}
+
+const void* platform_map_file(const char* path, size_t* size) {
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 || file_size.QuadPart > (LONGLONG)(SIZE_MAX / 2)) {
+    CloseHandle(file);
+    return NULL;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    return NULL;
+  }
+
+  // the view keeps the mapping alive
+  const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+
+  *size = (size_t)file_size.QuadPart;
+  return view;
+}
+
+void* platform_create_mapped_file(const char* path, size_t size) {
+  HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, (DWORD)size, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    return NULL;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+  CloseHandle(mapping);
+  return view;
+}
+
+void platform_unmap_file(const void* view) {
+  UnmapViewOfFile(view);
+}
+
+bool platform_has_argument(const char* argument) {
+  const char* line = GetCommandLineA();
+  for (const char* p = line; *p; p++) {
+    if (p != line && p[-1] != ' ') continue; // only where an argument starts
+
+    const char* a = argument;
+    const char* q = p;
+    while (*a && *q == *a) {
+      a++;
+      q++;
+    }
+    if (*a == 0 && (*q == 0 || *q == ' ')) return true;
+  }
+  return false;
+}
+
+#define MAX_WORKERS 7
+#define JOB_IDLE 0x40000000 // larger than any job, parks late wakers until the next job is published
+
+struct worker_job {
+  platform_job_fn fn;
+  void* ctx;
+  uint32_t count;
+
+  volatile LONG next;
+  volatile LONG remaining;
+  volatile LONG busy; // workers inside _job_execute, a finished job is retired only once they left
+};
+
+static struct worker_job job_ = { .next = JOB_IDLE };
+static HANDLE job_wake_ = NULL;
+static HANDLE job_done_ = NULL;
+static uint32_t worker_count_ = 0;
+
+static void _job_execute(void) {
+  for (;;) {
+    LONG idx = InterlockedIncrement(&job_.next) - 1;
+    if ((uint32_t)idx >= job_.count) {
+      return;
+    }
+
+    job_.fn(job_.ctx, (uint32_t)idx);
+    if (InterlockedDecrement(&job_.remaining) == 0) {
+      SetEvent(job_done_);
+    }
+  }
+}
+
+static DWORD WINAPI _worker_main(LPVOID param) {
+  (void)param;
+  for (;;) {
+    WaitForSingleObject(job_wake_, INFINITE);
+    InterlockedIncrement(&job_.busy);
+    _job_execute();
+    InterlockedDecrement(&job_.busy);
+  }
+}
+
+void _workers_initialize(void) {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+
+  worker_count_ = info.dwNumberOfProcessors > 1 ? info.dwNumberOfProcessors - 1 : 0;
+  if (worker_count_ > MAX_WORKERS) {
+    worker_count_ = MAX_WORKERS;
+  }
+
+  job_wake_ = CreateSemaphoreA(NULL, 0, MAX_WORKERS * 64, NULL);
+  job_done_ = CreateEventA(NULL, FALSE, FALSE, NULL);
+  _ASSERT(job_wake_ != NULL && job_done_ != NULL);
+
+  for (uint32_t i = 0; i < worker_count_; i++) {
+    HANDLE thread = CreateThread(NULL, 0, _worker_main, NULL, 0, NULL);
+    _ASSERT(thread != NULL);
+    CloseHandle(thread);
+  }
+}
+
+void platform_parallel_for(platform_job_fn fn, void* ctx, uint32_t count) {
+  if (count <= 1 || worker_count_ == 0) {
+    for (uint32_t i = 0; i < count; i++) {
+      fn(ctx, i);
+    }
+    return;
+  }
+
+  _ASSERT(job_.next >= JOB_IDLE); // not reentrant
+
+  job_.fn = fn;
+  job_.ctx = ctx;
+  job_.count = count;
+  job_.remaining = (LONG)count;
+  InterlockedExchange(&job_.next, 0); // publish
+
+  uint32_t wake = count - 1 < worker_count_ ? count - 1 : worker_count_;
+  ReleaseSemaphore(job_wake_, (LONG)wake, NULL);
+
+  _job_execute();
+  // the done event may still be signaled from a job the caller finished itself, hence the loop
+  while (InterlockedCompareExchange(&job_.remaining, 0, 0) != 0) {
+    WaitForSingleObject(job_done_, INFINITE);
+  }
+
+  // late wakers may have claimed an index past count, let them finish comparing before count changes
+  InterlockedExchange(&job_.next, JOB_IDLE);
+  while (InterlockedCompareExchange(&job_.busy, 0, 0) != 0) {
+    YieldProcessor();
+  }
+}
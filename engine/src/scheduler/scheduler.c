@@ -0,0 +1,183 @@
+#include "scheduler.h"
+#include "platform/platform.h"
+#include "debug/profiler.h"
+
+#include <intrin.h>
+
+#define MAX_SYSTEMS 32
+
+struct scheduler {
+  uint32_t count;
+  bool built;
+
+  system_t systems[MAX_SYSTEMS];
+  struct system_stats stats[MAX_SYSTEMS];
+
+  // system indices sorted by (phase, wave, registration order)
+  uint32_t order[MAX_SYSTEMS];
+  uint32_t phase_start[SYSTEM_PHASE_COUNT + 1];
+};
+
+static struct scheduler scheduler_ = { 0 };
+
+static bool _systems_conflict(const system_t* a, const system_t* b) {
+  return (a->writes & (b->reads | b->writes)) != 0 || (b->writes & a->reads) != 0;
+}
+
+static void _scheduler_run_system(void* ctx, uint32_t index) {
+  const uint32_t* wave = ctx;
+  uint32_t system_idx = wave[index];
+
+  uint64_t start = __rdtsc();
+  scheduler_.systems[system_idx].run();
+  uint64_t cycles = __rdtsc() - start;
+
+  struct system_stats* stats = &scheduler_.stats[system_idx];
+  stats->last_cycles = cycles;
+  stats->total_cycles += cycles;
+  stats->invocations++;
+}
+
+void scheduler_initialize(void) {
+  scheduler_.count = 0;
+  scheduler_.built = false;
+}
+
+void scheduler_register(const system_t* system) {
+  _ASSERT(scheduler_.count < MAX_SYSTEMS);
+  _ASSERT(system->phase < SYSTEM_PHASE_COUNT);
+  _ASSERT(system->run != NULL);
+
+  uint32_t idx = scheduler_.count++;
+  scheduler_.systems[idx] = *system;
+
+  struct system_stats* stats = &scheduler_.stats[idx];
+  stats->name = system->name;
+  stats->phase = system->phase;
+  stats->wave = 0;
+  stats->last_cycles = 0;
+  stats->total_cycles = 0;
+  stats->invocations = 0;
+
+  scheduler_.built = false;
+}
+
+void scheduler_build(void) {
+  // a system runs one wave after the latest earlier registered system of its phase it conflicts with,
+  // registration order breaks the tie between conflicting systems
+  for (uint32_t i = 0; i < scheduler_.count; i++) {
+    uint32_t wave = 0;
+    for (uint32_t j = 0; j < i; j++) {
+      if (scheduler_.systems[j].phase == scheduler_.systems[i].phase &&
+          _systems_conflict(&scheduler_.systems[i], &scheduler_.systems[j]) && scheduler_.stats[j].wave + 1 > wave) {
+        wave = scheduler_.stats[j].wave + 1;
+      }
+    }
+    scheduler_.stats[i].wave = wave;
+  }
+
+  // stable insertion sort by (phase, wave)
+  for (uint32_t i = 0; i < scheduler_.count; i++) {
+    uint32_t j = i;
+    const struct system_stats* si = &scheduler_.stats[i];
+    while (j > 0) {
+      const struct system_stats* sp = &scheduler_.stats[scheduler_.order[j - 1]];
+      if (sp->phase < si->phase || (sp->phase == si->phase && sp->wave <= si->wave)) {
+        break;
+      }
+      scheduler_.order[j] = scheduler_.order[j - 1];
+      j--;
+    }
+    scheduler_.order[j] = i;
+  }
+
+  uint32_t pos = 0;
+  for (uint32_t phase = 0; phase < SYSTEM_PHASE_COUNT; phase++) {
+    scheduler_.phase_start[phase] = pos;
+    while (pos < scheduler_.count && scheduler_.stats[scheduler_.order[pos]].phase == phase) {
+      pos++;
+    }
+  }
+  scheduler_.phase_start[SYSTEM_PHASE_COUNT] = pos;
+
+  scheduler_.built = true;
+}
+
+void scheduler_run(enum system_phase first, enum system_phase last) {
+  _ASSERT(scheduler_.built);
+  _ASSERT(first <= last && last < SYSTEM_PHASE_COUNT);
+
+  uint32_t end = scheduler_.phase_start[last + 1];
+  uint32_t wave_start = scheduler_.phase_start[first];
+
+  while (wave_start < end) {
+    const struct system_stats* head = &scheduler_.stats[scheduler_.order[wave_start]];
+
+    uint32_t wave_end = wave_start + 1;
+    while (wave_end < end && scheduler_.stats[scheduler_.order[wave_end]].phase == head->phase &&
+           scheduler_.stats[scheduler_.order[wave_end]].wave == head->wave) {
+      wave_end++;
+    }
+
+    platform_parallel_for(_scheduler_run_system, &scheduler_.order[wave_start], wave_end - wave_start);
+
+#ifdef TRACY_ENABLE
+    for (uint32_t i = wave_start; i < wave_end; i++) {
+      const struct system_stats* stats = &scheduler_.stats[scheduler_.order[i]];
+      PROFILE_PLOT(stats->name, stats->last_cycles);
+    }
+#endif
+
+    wave_start = wave_end;
+  }
+}
+
+uint32_t scheduler_get_stats(const struct system_stats** stats) {
+  *stats = scheduler_.stats;
+  return scheduler_.count;
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+
+static void _test_system_noop(void) {}
+
+// Test: independent systems share a wave, conflicting ones are ordered by registration, phases never mix
+void scheduler_test__waves_from_component_sets(void) {
+  scheduler_initialize();
+
+  system_t objects = { "objects", SYSTEM_PHASE_PHYSICS, COMPONENT_OBJECTS_THRUST, COMPONENT_OBJECTS_TRANSFORM,
+                       _test_system_noop };
+  system_t particles = { "particles", SYSTEM_PHASE_PHYSICS, 0, COMPONENT_PARTICLES, _test_system_noop };
+  system_t camera = { "camera", SYSTEM_PHASE_PHYSICS, 0, COMPONENT_OBJECTS_TRANSFORM | COMPONENT_PARTICLES,
+                      _test_system_noop };
+  system_t reader = { "reader", SYSTEM_PHASE_PHYSICS, COMPONENT_PARTS_DATA, 0, _test_system_noop };
+  system_t thrust = { "thrust", SYSTEM_PHASE_PRE_PHYSICS, COMPONENT_PARTS_DATA, COMPONENT_OBJECTS_THRUST,
+                      _test_system_noop };
+
+  scheduler_register(&objects);
+  scheduler_register(&particles);
+  scheduler_register(&camera);
+  scheduler_register(&reader);
+  scheduler_register(&thrust);
+  scheduler_build();
+
+  const struct system_stats* stats;
+  TEST_ASSERT_EQUAL_UINT32(5, scheduler_get_stats(&stats));
+  TEST_ASSERT_EQUAL_UINT32(0, stats[0].wave);
+  TEST_ASSERT_EQUAL_UINT32(0, stats[1].wave);
+  TEST_ASSERT_EQUAL_UINT32(1, stats[2].wave);
+  TEST_ASSERT_EQUAL_UINT32(0, stats[3].wave);
+  TEST_ASSERT_EQUAL_UINT32(0, stats[4].wave); // other phase, no dependency on physics
+
+  scheduler_run(SYSTEM_PHASE_PRE_PHYSICS, SYSTEM_PHASE_PHYSICS);
+  for (uint32_t i = 0; i < 5; i++) {
+    TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)stats[i].invocations);
+  }
+
+  scheduler_run(SYSTEM_PHASE_PRE_PHYSICS, SYSTEM_PHASE_PRE_PHYSICS);
+  TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)stats[0].invocations);
+  TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)stats[4].invocations);
+}
+
+#endif
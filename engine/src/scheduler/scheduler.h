@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/core.h"
+
+//
+// System scheduler
+//
+// Every subsystem registers as a named system with a phase and the component sets it reads and writes.
+// Phases always run in order and act as barriers; inside a phase, a system depends on every earlier
+// registered system it conflicts with (write/write or read/write overlap). Systems without a path between
+// them are grouped into waves that run in parallel on the platform worker threads.
+//
+// Usage:
+//   scheduler_initialize()                       - clears the registry (before any module initializes)
+//   scheduler_register(&system)                  - from module initializers
+//   scheduler_build()                            - once everything registered, builds the DAG
+//   scheduler_run(SYSTEM_PHASE_PRE_PHYSICS, SYSTEM_PHASE_COLLISION) - runs phases [first, last]
+//
+// Systems must not assume anything about the thread they run on; sending messages, emitting particles
+// or drawing random numbers is a write to the respective component and keeps such systems serialized.
+//
+
+enum system_phase {
+  SYSTEM_PHASE_INPUT = 0,    // once per frame
+  SYSTEM_PHASE_PRE_PHYSICS,  // once per tick
+  SYSTEM_PHASE_PHYSICS,      // once per tick
+  SYSTEM_PHASE_POST_PHYSICS, // once per tick
+  SYSTEM_PHASE_COLLISION,    // once per tick, messaging_pump follows
+  SYSTEM_PHASE_RENDER_PREP,  // once per frame, before drawing
+
+  SYSTEM_PHASE_COUNT
+};
+
+enum system_component {
+  COMPONENT_INPUT = 1 << 0,
+  COMPONENT_MESSAGES = 1 << 1, // messaging queue (messaging_send)
+  COMPONENT_RANDOM = 1 << 2,   // rand32 state
+
+  COMPONENT_OBJECTS_TRANSFORM = 1 << 3, // positions, orientations, velocities
+  COMPONENT_OBJECTS_THRUST = 1 << 4,
+  COMPONENT_PARTS_TRANSFORM = 1 << 5, // world positions of parts
+  COMPONENT_PARTS_DATA = 1 << 6,      // per-part state (engine thrust, ...)
+  COMPONENT_PARTICLES = 1 << 7,
+  COMPONENT_FRAGMENTS = 1 << 8, // fracture fragment pool
+  COMPONENT_CAMERA = 1 << 9,
+  COMPONENT_DEBRIS = 1 << 10,
+};
+
+typedef void (*system_fn)(void);
+
+typedef struct {
+  const char* name; // must be a string literal, used for profiler plots
+  enum system_phase phase;
+  uint32_t reads;  // enum system_component mask
+  uint32_t writes; // enum system_component mask
+  system_fn run;
+} system_t;
+
+struct system_stats {
+  const char* name;
+  enum system_phase phase;
+  uint32_t wave; // parallel group inside the phase
+  uint64_t last_cycles;
+  uint64_t total_cycles;
+  uint64_t invocations;
+};
+
+void scheduler_initialize(void);
+void scheduler_register(const system_t* system);
+void scheduler_build(void);
+void scheduler_run(enum system_phase first, enum system_phase last);
+
+uint32_t scheduler_get_stats(const struct system_stats** stats); // returns the number of systems
@@ -0,0 +1,333 @@
+#include "snapshot.h"
+#include "platform/platform.h"
+#include "debug/profiler.h"
+#include "entity/entity.h"
+#include "entity/engine.h"
+#include "entity/debris.h"
+#include "entity/fracture.h"
+#include "entity/particles.h"
+#include "messaging/messaging.h"
+
+#define SNAPSHOT_ALIGNMENT 32
+
+struct snapshot_section_entry {
+  uint32_t offset; // from the start of the file
+  uint32_t size;
+};
+
+struct snapshot_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t layout;
+  uint32_t size; // whole file
+  struct snapshot_section_entry sections[SNAPSHOT_SECTION_COUNT];
+};
+
+// precedes the data of a column set section
+struct snapshot_columns {
+  uint32_t count;
+  uint32_t columns;
+  uint32_t tiled;
+  uint32_t element_size[COLUMN_SET_MAX_COLUMNS];
+};
+
+struct snapshot {
+  uint8_t* base; // NULL while measuring
+  uint32_t size;
+  uint32_t offset;
+  struct snapshot_header* header;
+};
+
+static uint32_t _align(uint32_t offset) {
+  return (offset + SNAPSHOT_ALIGNMENT - 1) & ~(uint32_t)(SNAPSHOT_ALIGNMENT - 1);
+}
+
+// whatever changes the meaning of the sections without changing their structure
+static uint32_t _snapshot_layout(void) {
+  uint32_t layout = OBJECTS_HOT_STRIDE;
+  layout = layout * 31 + ENTITY_TYPE_COUNT;
+  layout = layout * 31 + (uint32_t)sizeof(message_t);
+  layout = layout * 31 + (uint32_t)sizeof(FragmentArena);
+#ifdef PARTICLES_AGE_RING
+  layout = layout * 31 + 1;
+#endif
+  return layout;
+}
+
+static void _snapshot_begin(snapshot_t* snapshot, enum snapshot_section section) {
+  snapshot->offset = _align(snapshot->offset);
+  if (snapshot->base != NULL) {
+    snapshot->header->sections[section].offset = snapshot->offset;
+    snapshot->header->sections[section].size = 0;
+  }
+}
+
+void snapshot_append(snapshot_t* snapshot, enum snapshot_section section, const void* data, size_t size) {
+  if (snapshot->base != NULL) {
+    _ASSERT(snapshot->offset + size <= snapshot->size);
+    platform_copy_memory(snapshot->base + snapshot->offset, data, size);
+    snapshot->header->sections[section].size =
+        snapshot->offset + (uint32_t)size - snapshot->header->sections[section].offset;
+  }
+  snapshot->offset += (uint32_t)size;
+}
+
+void snapshot_write(snapshot_t* snapshot, enum snapshot_section section, const void* data, size_t size) {
+  _snapshot_begin(snapshot, section);
+  snapshot_append(snapshot, section, data, size);
+}
+
+static uint32_t _tiled_bytes(const column_set_t* set, uint32_t count) {
+  return ((count + 7) >> 3) * 8 * set->tile_columns * set->tile_element_size;
+}
+
+void snapshot_write_columns(snapshot_t* snapshot, enum snapshot_section section, const column_set_t* set,
+                            uint32_t count) {
+  _ASSERT(count <= set->capacity);
+
+  struct snapshot_columns columns = { .count = count, .columns = set->count, .tiled = set->tiles != NULL };
+  for (uint32_t i = 0; i < set->count; i++) {
+    columns.element_size[i] = set->element_size[i];
+  }
+
+  _snapshot_begin(snapshot, section);
+  snapshot_append(snapshot, section, &columns, sizeof(columns));
+
+  // tiles (or columns) start aligned, so a load is a straight copy per column
+  if (set->tiles != NULL) {
+    snapshot->offset = _align(snapshot->offset);
+    snapshot_append(snapshot, section, set->tiles, _tiled_bytes(set, count));
+    return;
+  }
+
+  for (uint32_t i = 0; i < set->count; i++) {
+    snapshot->offset = _align(snapshot->offset);
+    snapshot_append(snapshot, section, *set->column[i], count * set->element_size[i]);
+  }
+}
+
+const void* snapshot_read(snapshot_t* snapshot, enum snapshot_section section, size_t* size) {
+  const struct snapshot_section_entry* entry = &snapshot->header->sections[section];
+  if (entry->offset == 0) {
+    return NULL;
+  }
+
+  *size = entry->size;
+  return snapshot->base + entry->offset;
+}
+
+bool snapshot_read_columns(snapshot_t* snapshot, enum snapshot_section section, column_set_t* set, uint32_t* count) {
+  size_t size;
+  const uint8_t* data = snapshot_read(snapshot, section, &size);
+  if (data == NULL || size < sizeof(struct snapshot_columns)) {
+    return false;
+  }
+
+  const struct snapshot_columns* columns = (const struct snapshot_columns*)data;
+  if (columns->columns != set->count || columns->tiled != (set->tiles != NULL) || columns->count > set->max_capacity) {
+    return false;
+  }
+  for (uint32_t i = 0; i < set->count; i++) {
+    if (columns->element_size[i] != set->element_size[i]) {
+      return false;
+    }
+  }
+
+  uint32_t loaded = columns->count;
+  uint32_t previous = *count > loaded ? *count : loaded;
+  column_set_reserve(set, loaded);
+
+  // whatever the running world left behind the loaded range is zeroed, SIMD loops read up to the next 8
+  uint32_t offset = _align(sizeof(struct snapshot_columns));
+  if (set->tiles != NULL) {
+    uint32_t bytes = _tiled_bytes(set, loaded);
+    if (offset + bytes > size) {
+      return false;
+    }
+    platform_copy_memory(set->tiles, data + offset, bytes);
+    platform_clear_memory(set->tiles + bytes, _tiled_bytes(set, previous) - bytes);
+  } else {
+    uint32_t tail = ((previous + 7) & ~7u) < set->capacity ? ((previous + 7) & ~7u) : set->capacity;
+    for (uint32_t i = 0; i < set->count; i++) {
+      uint32_t bytes = loaded * set->element_size[i];
+      offset = _align(offset);
+      if (offset + bytes > size) {
+        return false;
+      }
+
+      uint8_t* column = *set->column[i];
+      platform_copy_memory(column, data + offset, bytes);
+      platform_clear_memory(column + bytes, (tail - loaded) * set->element_size[i]);
+      offset += bytes;
+    }
+  }
+
+  *count = loaded;
+  return true;
+}
+
+static void _snapshot_write_world(snapshot_t* snapshot) {
+  entity_manager_snapshot_save(snapshot);
+  engine_snapshot_save(snapshot);
+  particles_snapshot_save(snapshot);
+  fragment_pool_snapshot_save(snapshot);
+  debris_snapshot_save(snapshot);
+  messaging_snapshot_save(snapshot);
+}
+
+bool snapshot_save(const char* path) {
+  PROFILE_ZONE("snapshot_save");
+
+  // measure first, the file is mapped at its final size and written in place
+  snapshot_t snapshot = { .base = NULL, .offset = sizeof(struct snapshot_header) };
+  _snapshot_write_world(&snapshot);
+
+  snapshot.size = _align(snapshot.offset);
+  snapshot.base = platform_create_mapped_file(path, snapshot.size);
+  if (snapshot.base == NULL) {
+    PROFILE_ZONE_END();
+    return false;
+  }
+
+  snapshot.header = (struct snapshot_header*)snapshot.base;
+  platform_clear_memory(snapshot.header, sizeof(struct snapshot_header));
+  snapshot.header->magic = SNAPSHOT_MAGIC;
+  snapshot.header->version = SNAPSHOT_VERSION;
+  snapshot.header->layout = _snapshot_layout();
+  snapshot.header->size = snapshot.size;
+
+  snapshot.offset = sizeof(struct snapshot_header);
+  _snapshot_write_world(&snapshot);
+
+  platform_unmap_file(snapshot.base);
+  PROFILE_PLOT("snapshot_bytes", snapshot.size);
+  PROFILE_ZONE_END();
+  return true;
+}
+
+static bool _snapshot_validate(const snapshot_t* snapshot) {
+  if (snapshot->size < sizeof(struct snapshot_header)) {
+    return false;
+  }
+
+  const struct snapshot_header* header = snapshot->header;
+  if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION || header->layout != _snapshot_layout() ||
+      header->size != snapshot->size) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+    const struct snapshot_section_entry* entry = &header->sections[i];
+    if (entry->offset < sizeof(struct snapshot_header) || entry->offset > snapshot->size ||
+        entry->size > snapshot->size - entry->offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool snapshot_load(const char* path) {
+  PROFILE_ZONE("snapshot_load");
+
+  size_t size;
+  const void* view = platform_map_file(path, &size);
+  if (view == NULL) {
+    PROFILE_ZONE_END();
+    return false;
+  }
+
+  // the view is read-only, the sections are copied straight out of it
+  snapshot_t snapshot = { .base = (uint8_t*)view, .size = (uint32_t)size, .header = (struct snapshot_header*)view };
+  bool loaded = _snapshot_validate(&snapshot);
+  if (loaded) {
+    loaded = entity_manager_snapshot_load(&snapshot) && engine_snapshot_load(&snapshot) &&
+             particles_snapshot_load(&snapshot) && fragment_pool_snapshot_load(&snapshot) &&
+             debris_snapshot_load(&snapshot) && messaging_snapshot_load(&snapshot);
+    if (!loaded) {
+      // the header matched but a section didn't, don't run a half restored world; an empty one keeps the
+      // registered systems and no map is loaded
+      messaging_clear();
+      entity_manager_clear();
+    }
+  }
+
+  platform_unmap_file(view);
+  PROFILE_ZONE_END();
+  return loaded;
+}
+
+#ifdef UNIT_TESTS
+#include "../test/unity.h"
+#include "scheduler/scheduler.h"
+
+// Test: a saved world comes back with the same handles, parts, components, particles, fragments and queue
+void snapshot_test__round_trip(void) {
+  messaging_initialize();
+  struct objects_data* od = entity_manager_get_objects();
+  struct parts_data* pd = entity_manager_get_parts();
+
+  entity_id_t a = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 2);
+  entity_id_t b = entity_manager_spawn_object(ENTITY_TYPEREF_PLANET, 0);
+  entity_id_t c = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 1);
+  entity_manager_despawn_object(c); // leaves a slot on the free list
+
+  od->position_orientation.position_x[HOT_IDX(entity_manager_object_index(a))] = 12.5f;
+  od->velocity_y[HOT_IDX(entity_manager_object_index(b))] = -3.0f;
+  uint32_t engine_part = od->parts_start_idx[entity_manager_object_index(a)] + 1;
+  pd->type[engine_part]._ = ENTITY_TYPE_PART_ENGINE;
+  engine_attach(engine_part, 0.75f, 3);
+
+  particle_create_t particle = { .x = 1.0f, .y = 2.0f, .ttl = 10, .model_idx = 4 };
+  particles_create_particle(&particle);
+  TEST_ASSERT_EQUAL_INT(0, fragment_pool_alloc());
+
+  message_t msg = CREATE_MESSAGE(MESSAGE_SHIP_ROTATE_BY, 7, 0);
+  uint32_t* payload = messaging_payload_alloc(&msg, sizeof(uint32_t));
+  TEST_ASSERT_NOT_NULL(payload);
+  *payload = 0xC0FFEE;
+  messaging_send(a, msg);
+
+  TEST_ASSERT_TRUE(snapshot_save("snapshot_test.snapshot"));
+
+  messaging_clear();
+  entity_manager_initialize();
+  TEST_ASSERT_FALSE(entity_manager_is_alive(a));
+
+  TEST_ASSERT_TRUE(snapshot_load("snapshot_test.snapshot"));
+  TEST_ASSERT_TRUE(entity_manager_is_alive(a) && entity_manager_is_alive(b));
+  TEST_ASSERT_FALSE(entity_manager_is_alive(c));
+  TEST_ASSERT_EQUAL_FLOAT(12.5f, od->position_orientation.position_x[HOT_IDX(entity_manager_object_index(a))]);
+  TEST_ASSERT_EQUAL_FLOAT(-3.0f, od->velocity_y[HOT_IDX(entity_manager_object_index(b))]);
+  TEST_ASSERT_EQUAL_UINT32(1, od->type_count[ENTITY_TYPE_PLANET]);
+
+  struct engine_components* engines = engine_get_components();
+  TEST_ASSERT_EQUAL_UINT32(1, engines->active);
+  TEST_ASSERT_EQUAL_UINT32(engine_part, engines->part_idx[0]);
+  TEST_ASSERT_EQUAL_UINT32(0, pd->component_idx[engine_part]);
+  TEST_ASSERT_EQUAL_FLOAT(0.75f, engines->power[0]);
+
+  TEST_ASSERT_EQUAL_UINT32(1, entity_manager_get_particles()->active);
+  TEST_ASSERT_EQUAL_UINT16(4, entity_manager_get_particles()->model_idx[0]);
+  TEST_ASSERT_EQUAL_INT(1, fragment_pool_alloc());
+  TEST_ASSERT_EQUAL_UINT32(0xC0FFEE, *(const uint32_t*)messaging_payload(&msg, NULL));
+
+  // the free slot is reused with the next generation
+  entity_id_t d = entity_manager_spawn_object(ENTITY_TYPEREF_SHIP, 1);
+  TEST_ASSERT_EQUAL_UINT32(GET_SLOT(c), GET_SLOT(d));
+  TEST_ASSERT_FALSE(entity_manager_is_alive(c));
+
+  TEST_ASSERT_FALSE(snapshot_load("snapshot_test.missing"));
+
+  // what a failed section falls back to: everything gone, nothing registered twice
+  const struct system_stats* stats;
+  uint32_t systems = scheduler_get_stats(&stats);
+  entity_manager_clear();
+  TEST_ASSERT_FALSE(entity_manager_is_alive(a));
+  TEST_ASSERT_EQUAL_UINT32(0, od->active);
+  TEST_ASSERT_EQUAL_UINT32(0, engines->active);
+  TEST_ASSERT_EQUAL_UINT32(0, entity_manager_get_particles()->active);
+  TEST_ASSERT_EQUAL_UINT32(systems, scheduler_get_stats(&stats));
+  messaging_clear();
+}
+
+#endif
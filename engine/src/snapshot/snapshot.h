@@ -0,0 +1,57 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/columns.h"
+
+//
+// World snapshots
+//
+// A snapshot is a single versioned binary file: a header, a section table and the section blobs (32-byte
+// aligned). Every module that owns world state writes its own sections; column sets are dumped column by
+// column for their active range only (tiled sets tile by tile), so loading is one copy from the mapped file
+// into the already reserved storage.
+//
+// Usage:
+//   snapshot_save("quick.snapshot")  - between ticks (after messaging_pump), any time the world is consistent
+//   snapshot_load("quick.snapshot")  - replaces the running world, modules must be initialized already
+//
+// Load fails and leaves the world untouched when the file is missing, truncated, or was written by another
+// version or build layout (e.g. OBJECTS_AOSOA on one side only). When the header checks out but a section
+// doesn't load, the world is emptied instead (systems stay registered, no map is loaded).
+//
+
+#define SNAPSHOT_MAGIC 0x53534B52u // "RKSS"
+#define SNAPSHOT_VERSION 7
+
+enum snapshot_section {
+  SNAPSHOT_SECTION_ENTITY_STATE = 0, // counts, type ranges, handle free list, bindings
+  SNAPSHOT_SECTION_OBJECTS_HOT,
+  SNAPSHOT_SECTION_OBJECTS_COLD,
+  SNAPSHOT_SECTION_HANDLES,
+  SNAPSHOT_SECTION_PARTS,
+  SNAPSHOT_SECTION_PARTICLES,
+  SNAPSHOT_SECTION_ENGINES,
+  SNAPSHOT_SECTION_FRAGMENTS,
+  SNAPSHOT_SECTION_MESSAGES, // pending messages, oldest first
+  SNAPSHOT_SECTION_PAYLOADS, // payload arena of the pending messages
+  SNAPSHOT_SECTION_PARTICLE_RING, // age buckets, PARTICLES_AGE_RING builds only
+  SNAPSHOT_SECTION_DEBRIS,
+
+  SNAPSHOT_SECTION_COUNT
+};
+
+typedef struct snapshot snapshot_t;
+
+bool snapshot_save(const char* path);
+bool snapshot_load(const char* path);
+
+// for the modules' save/load functions
+void snapshot_write(snapshot_t* snapshot, enum snapshot_section section, const void* data, size_t size);
+// extends the section the last write started, for sections gathered from several ranges
+void snapshot_append(snapshot_t* snapshot, enum snapshot_section section, const void* data, size_t size);
+void snapshot_write_columns(snapshot_t* snapshot, enum snapshot_section section, const column_set_t* set,
+                            uint32_t count);
+// NULL if the section is missing, *size receives its length
+const void* snapshot_read(snapshot_t* snapshot, enum snapshot_section section, size_t* size);
+// grows the set as needed and copies the columns in, returns false if the layout doesn't match the set
+bool snapshot_read_columns(snapshot_t* snapshot, enum snapshot_section section, column_set_t* set, uint32_t* count);
@@ -0,0 +1,73 @@
+//
+// Headless frame benchmark: the main loop with the null render backend and no window or GL context
+//
+// Loads map 0 and runs the fixed tick (physics, collisions, messaging, a periodic explosion like main.c) and
+// the render side (render prep, command list build, sort, submit to the null backend) for the given number of
+// frames, one tick per frame. The input phase is skipped, the test platform has no input. Prints the cycles
+// per frame (rdtsc) and what the null backend was given.
+//
+// Build: Tests configuration (platform.test.c is the platform layer)
+// Usage: engine.exe -framebench [frames]
+//
+
+#include <intrin.h>
+#include <stdio.h>
+
+#include "platform/platform.h"
+#include "entity/entity.h"
+#include "entity/fracture.h"
+#include "collisions/collisions.h"
+#include "physics/physics.h"
+#include "messaging/messaging.h"
+#include "scheduler/scheduler.h"
+#include "graphics/graphics.h"
+#include "graphics/render.h"
+#include "../generated/renderer.gen.h"
+
+#define EXPLOSION_TICKS 360
+
+int frame_bench(uint32_t frames) {
+  messaging_initialize();
+  scheduler_initialize();
+  entity_manager_initialize();
+  _generated_load_map_data(0);
+  physics_engine_initialize();
+  graphics_initialize(GRAPHICS_RENDERER_NULL);
+  collisions_engine_initialize();
+  scheduler_build();
+
+  messaging_send(RECIPIENT_ID_BROADCAST, CREATE_MESSAGE(MESSAGE_BROADCAST_SYSTEM_INITIALIZED, 0, 0));
+  messaging_pump();
+
+  uint64_t tick_cycles = 0;
+  uint64_t draw_cycles = 0;
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    uint64_t start = __rdtsc();
+    if (frame % EXPLOSION_TICKS == EXPLOSION_TICKS - 1) {
+      explode_entity(0);
+    }
+    scheduler_run(SYSTEM_PHASE_PRE_PHYSICS, SYSTEM_PHASE_COLLISION);
+    messaging_pump();
+
+    uint64_t mid = __rdtsc();
+    scheduler_run(SYSTEM_PHASE_RENDER_PREP, SYSTEM_PHASE_RENDER_PREP);
+    graphics_engine_draw();
+
+    uint64_t end = __rdtsc();
+    tick_cycles += mid - start;
+    draw_cycles += end - mid;
+  }
+
+  if (frames == 0) {
+    return 0;
+  }
+
+  const render_null_stats_t* stats = render_null_stats();
+  printf("frames %u: tick %llu, draw %llu cycles/frame\n", frames, (unsigned long long)(tick_cycles / frames),
+         (unsigned long long)(draw_cycles / frames));
+  printf("per frame: %u point batches (%u points), %u model runs (%u batches, %u models)\n",
+         stats->point_batches / frames, stats->points / frames, stats->model_runs / frames,
+         stats->model_batches / frames, stats->models / frames);
+  return 0;
+}
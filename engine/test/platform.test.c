@@ -1,4 +1,6 @@
 #include <Windows.h>
+#include <stdlib.h>
+#include <string.h>
 #include "unity.h"
 
 #pragma comment(lib, "opengl32.lib")
@@ -51,10 +53,70 @@ void* platform_retrieve_memory(size_t memory_size) {
   return _aligned_malloc(memory_size, 16);
 }
 
+void* platform_reserve_memory(size_t size) {
+  return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_READWRITE);
+}
+
+void platform_commit_memory(void* ptr, size_t size) {
+  if (size != 0) {
+    VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE);
+  }
+}
+
+const void* platform_map_file(const char* path, size_t* size) {
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+
+  LARGE_INTEGER file_size;
+  GetFileSizeEx(file, &file_size);
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    return NULL;
+  }
+
+  const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  *size = (size_t)file_size.QuadPart;
+  return view;
+}
+
+void* platform_create_mapped_file(const char* path, size_t size) {
+  HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, (DWORD)size, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    return NULL;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+  CloseHandle(mapping);
+  return view;
+}
+
+void platform_unmap_file(const void* view) {
+  UnmapViewOfFile(view);
+}
+
+// tests run single threaded
+void platform_parallel_for(void (*fn)(void* ctx, uint32_t index), void* ctx, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    fn(ctx, i);
+  }
+}
+
+void scheduler_initialize(void);
 void entity_manager_initialize(void);
 void collisions_engine_initialize(void);
 
 void setUp(void) {
+  scheduler_initialize();
   entity_manager_initialize();
   collisions_engine_initialize();
 }
@@ -64,22 +126,91 @@ void tearDown(void) {}
 
 
 void physics_test__parts_world_transform_rotations(void);
+void physics_test__parts_gather_parent_per_lane(void);
+void physics_test__parts_mounted_on_parts(void);
 void collision_test__no_duplicates(void);
 void collision_test__scattered_indices(void);
 void collision_test__respects_active_count(void);
 void collision_test__aligned_8_objects(void);
 void collision_test__unaligned_9_objects(void);
+void collision_test__more_pairs_than_particles(void);
+void messaging_test__payload_arena_reset(void);
+void messaging_test__overflow_drops_and_counts(void);
+void message_trace_test__record_and_histogram(void);
+void scheduler_test__waves_from_component_sets(void);
+void dispatch_stats_test__counts_per_type_and_code(void);
+void entity_test__despawn_keeps_handles_stable(void);
+void columns_test__growth_keeps_pointers(void);
+void columns_test__tiled_set_interleaves(void);
+void engine_test__components_follow_parts(void);
+void engine_test__thrust_sums_per_parent(void);
+void entity_test__objects_grouped_by_type(void);
+void entity_test__spawn_refused_when_full(void);
+void snapshot_test__round_trip(void);
+void particles_test__pack_keeps_survivors_in_order(void);
+void particles_test__emit_batch(void);
+void particles_test__full_storage_drops_excess(void);
+void fracture_test__explode_uses_cached_patterns(void);
+void fracture_test__arena_slots_and_runs(void);
+void fracture_test__explode_many_in_one_batch(void);
+void fracture_test__debris_cascades_to_depth_limit(void);
+void debris_test__gravity_contacts_and_pack(void);
+void camera_test__relocate_moves_debris(void);
+void lines_test__models_transform_into_batches(void);
+void instanced_test__instances_grouped_by_model(void);
+void render_test__radix_sort_is_stable(void);
+void render_test__frame_sorted_by_layer_and_model(void);
+void stars_test__chunks_cached_between_frames(void);
+#ifdef PARTICLES_AGE_RING
+void particles_test__ring_retires_buckets(void);
+#endif
+
+int frame_bench(uint32_t frames); // frame_bench.c
 
 int __cdecl main(int argc, char** argv) {
-  (void)argc;
-  (void)argv;
+  if (argc > 1 && strcmp(argv[1], "-framebench") == 0) {
+    return frame_bench(argc > 2 ? (uint32_t)atoi(argv[2]) : 1000);
+  }
 
   UNITY_BEGIN();
   RUN_TEST(physics_test__parts_world_transform_rotations);
+  RUN_TEST(physics_test__parts_gather_parent_per_lane);
+  RUN_TEST(physics_test__parts_mounted_on_parts);
   RUN_TEST(collision_test__no_duplicates);
   RUN_TEST(collision_test__scattered_indices);
   RUN_TEST(collision_test__respects_active_count);
   RUN_TEST(collision_test__aligned_8_objects);
   RUN_TEST(collision_test__unaligned_9_objects);
+  RUN_TEST(collision_test__more_pairs_than_particles);
+  RUN_TEST(messaging_test__payload_arena_reset);
+  RUN_TEST(messaging_test__overflow_drops_and_counts);
+  RUN_TEST(message_trace_test__record_and_histogram);
+  RUN_TEST(scheduler_test__waves_from_component_sets);
+  RUN_TEST(dispatch_stats_test__counts_per_type_and_code);
+  RUN_TEST(entity_test__despawn_keeps_handles_stable);
+  RUN_TEST(columns_test__growth_keeps_pointers);
+  RUN_TEST(columns_test__tiled_set_interleaves);
+  RUN_TEST(engine_test__components_follow_parts);
+  RUN_TEST(engine_test__thrust_sums_per_parent);
+  RUN_TEST(entity_test__objects_grouped_by_type);
+  RUN_TEST(entity_test__spawn_refused_when_full);
+  RUN_TEST(snapshot_test__round_trip);
+  RUN_TEST(particles_test__pack_keeps_survivors_in_order);
+  RUN_TEST(particles_test__emit_batch);
+  RUN_TEST(particles_test__full_storage_drops_excess);
+  RUN_TEST(fracture_test__explode_uses_cached_patterns);
+  RUN_TEST(fracture_test__arena_slots_and_runs);
+  RUN_TEST(fracture_test__explode_many_in_one_batch);
+  RUN_TEST(fracture_test__debris_cascades_to_depth_limit);
+  RUN_TEST(debris_test__gravity_contacts_and_pack);
+  RUN_TEST(camera_test__relocate_moves_debris);
+  RUN_TEST(lines_test__models_transform_into_batches);
+  RUN_TEST(instanced_test__instances_grouped_by_model);
+  RUN_TEST(render_test__radix_sort_is_stable);
+  RUN_TEST(render_test__frame_sorted_by_layer_and_model);
+  RUN_TEST(stars_test__chunks_cached_between_frames);
+#ifdef PARTICLES_AGE_RING
+  RUN_TEST(particles_test__ring_retires_buckets);
+#endif
   return UNITY_END();
 }
@@ -0,0 +1,271 @@
+//
+// Objects hot block layout benchmark: plain SoA vs. AoSoA tiles of 8 (see OBJECTS_AOSOA in entity/entity.h)
+//
+// Runs the Yoshida integration pass (thrust -> acceleration, 3 substeps) and the collision broadphase pass
+// (cull + gathered distance checks) over both layouts, with the engine's own loops (physics/yoshida.h,
+// collisions/broadphase.h). Each pass is timed with cold caches (rdtsc) and its
+// address stream is replayed through a simulated L1d / L2 (set associative, LRU) to count misses, so layouts
+// can be compared without access to hardware counters. Gravity is left out, it is O(n^2) and reads the same
+// three columns in both layouts.
+//
+// Build: cl /O2 /arch:AVX2 /I../src layout_bench.c
+// Usage: layout_bench [objects]
+//
+
+#include <immintrin.h>
+#include <intrin.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/core.h"
+#include "physics/yoshida.h"
+#include "collisions/broadphase.h"
+
+#define HOT_COLUMNS 11 // must match OBJECTS_HOT_COLUMNS
+#define COLLISION_SOURCES 256
+#define FLUSH_SIZE (64 * 1024 * 1024)
+
+enum hot_column { PX, PY, OX, OY, RADIUS, VX, VY, AX, AY, THRUST, MASS };
+
+struct layout {
+  const char* name;
+  uint32_t stride; // floats between tiles of one column
+  float* column[HOT_COLUMNS];
+};
+
+//
+// cache model
+//
+
+struct cache {
+  uint32_t sets;
+  uint32_t ways;
+  uint64_t* tags; // sets * ways, most recently used first
+  uint64_t misses;
+};
+
+static void _cache_init(struct cache* c, uint32_t size, uint32_t ways) {
+  c->ways = ways;
+  c->sets = size / 64 / ways;
+  c->tags = calloc((size_t)c->sets * ways, sizeof(uint64_t));
+  c->misses = 0;
+}
+
+static void _cache_reset(struct cache* c) {
+  memset(c->tags, 0, (size_t)c->sets * c->ways * sizeof(uint64_t));
+  c->misses = 0;
+}
+
+// returns true on hit, tag 0 marks an empty way (line numbers are offset by one)
+static int _cache_access(struct cache* c, uint64_t line) {
+  uint64_t tag = line + 1;
+  uint64_t* set = &c->tags[(line % c->sets) * c->ways];
+
+  uint32_t way = 0;
+  while (way < c->ways && set[way] != tag) {
+    way++;
+  }
+  int hit = way < c->ways;
+  if (!hit) {
+    c->misses++;
+    way = c->ways - 1;
+  }
+  memmove(&set[1], &set[0], way * sizeof(uint64_t));
+  set[0] = tag;
+  return hit;
+}
+
+static struct cache l1_, l2_;
+
+static void _touch(const void* p, size_t size) {
+  uint64_t first = (uintptr_t)p >> 6;
+  uint64_t last = ((uintptr_t)p + size - 1) >> 6;
+  for (uint64_t line = first; line <= last; line++) {
+    if (!_cache_access(&l1_, line)) {
+      _cache_access(&l2_, line);
+    }
+  }
+}
+
+//
+// passes, timed ones run the engine's loops, traced ones replay their column accesses through the cache model
+//
+
+static position_orientation_t _view(struct layout* l) {
+  position_orientation_t po = { l->column[PX], l->column[PY], l->column[OX], l->column[OY], l->column[RADIUS],
+                                l->stride };
+  return po;
+}
+
+static void _yoshida(struct layout* l, uint32_t active) {
+  static const float steps[3] = { YOSHIDA_C1, YOSHIDA_C2, YOSHIDA_C3 };
+  uint32_t end = tiled_index(l->stride, active);
+
+  for (int s = 0; s < 3; s++) {
+    yoshida_thrust_acceleration(l->column[THRUST], l->column[MASS], l->column[OX], l->column[OY], l->column[AX],
+                                l->column[AY], l->stride, end);
+    yoshida_step(l->column[PX], l->column[PY], l->column[VX], l->column[VY], l->column[AX], l->column[AY], l->stride,
+                 end, steps[s] * TICK_S, steps[s] * 0.5f * TICK_S);
+  }
+}
+
+static void _yoshida_trace(struct layout* l, uint32_t active) {
+  for (int s = 0; s < 3; s++) {
+    for (uint32_t i = 0; i < active; i += 8) {
+      uint32_t t = tiled_index(l->stride, i);
+      _touch(l->column[THRUST] + t, 32), _touch(l->column[MASS] + t, 32);
+      _touch(l->column[OX] + t, 32), _touch(l->column[OY] + t, 32);
+      _touch(l->column[AX] + t, 32), _touch(l->column[AY] + t, 32);
+    }
+    for (uint32_t i = 0; i < active; i += 8) {
+      uint32_t t = tiled_index(l->stride, i);
+      _touch(l->column[AX] + t, 32), _touch(l->column[AY] + t, 32);
+      _touch(l->column[VX] + t, 32), _touch(l->column[VY] + t, 32);
+      _touch(l->column[PX] + t, 32), _touch(l->column[PY] + t, 32);
+    }
+  }
+}
+
+// culled indices padded to 8 with zeros, returns their count
+static uint32_t _cull(struct layout* l, uint32_t active, uint32_t* culled) {
+  position_orientation_t po = _view(l);
+  uint32_t count = broadphase_cull(&po, 0, active, culled);
+  for (uint32_t k = count; k < ((count + 7) & ~7u); k++) {
+    culled[k] = 0;
+  }
+  return count;
+}
+
+static uint32_t _collisions(struct layout* l, uint32_t active, uint32_t* culled) {
+  position_orientation_t po = _view(l);
+  uint32_t count = _cull(l, active, culled);
+  uint32_t pairs = 0;
+  uint32_t sources = count < COLLISION_SOURCES ? count : COLLISION_SOURCES;
+
+  for (uint32_t s = 0; s < sources; s++) {
+    uint32_t src = tiled_index(l->stride, culled[s]);
+    __m256 px = _mm256_set1_ps(l->column[PX][src]);
+    __m256 py = _mm256_set1_ps(l->column[PY][src]);
+    __m256 pr = _mm256_set1_ps(l->column[RADIUS][src]);
+
+    for (uint32_t j = 0; j < count; j += 8) {
+      pairs += (uint32_t)__popcnt((uint32_t)broadphase_overlaps(px, py, pr, &po, &culled[j]));
+    }
+  }
+  return pairs;
+}
+
+static void _collisions_trace(struct layout* l, uint32_t active, uint32_t* culled) {
+  for (uint32_t i = 0; i < active; i += 8) {
+    uint32_t t = tiled_index(l->stride, i);
+    _touch(l->column[PX] + t, 32), _touch(l->column[PY] + t, 32);
+  }
+
+  uint32_t count = _cull(l, active, culled);
+  uint32_t sources = count < COLLISION_SOURCES ? count : COLLISION_SOURCES;
+
+  for (uint32_t s = 0; s < sources; s++) {
+    uint32_t src = tiled_index(l->stride, culled[s]);
+    _touch(l->column[PX] + src, 4), _touch(l->column[PY] + src, 4), _touch(l->column[RADIUS] + src, 4);
+
+    for (uint32_t j = 0; j < count; j += 8) {
+      _touch(&culled[j], 32);
+      for (uint32_t k = 0; k < 8; k++) {
+        uint32_t o = tiled_index(l->stride, culled[j + k]);
+        _touch(l->column[PX] + o, 4), _touch(l->column[PY] + o, 4), _touch(l->column[RADIUS] + o, 4);
+      }
+    }
+  }
+}
+
+//
+// setup & driver
+//
+
+static void _layout_fill(struct layout* l, uint32_t active) {
+  srand(1);
+  for (uint32_t i = 0; i < active; i++) {
+    uint32_t t = tiled_index(l->stride, i);
+    l->column[PX][t] = (float)(rand() % 4000) - 2000.0f;
+    l->column[PY][t] = (float)(rand() % 4000) - 2000.0f;
+    l->column[OX][t] = 1.0f;
+    l->column[OY][t] = 0.0f;
+    l->column[RADIUS][t] = 5.0f + (float)(rand() % 20);
+    l->column[VX][t] = l->column[VY][t] = 0.0f;
+    l->column[AX][t] = l->column[AY][t] = 0.0f;
+    l->column[THRUST][t] = (float)(rand() % 16);
+    l->column[MASS][t] = 1.0f + (float)(rand() % 100);
+  }
+}
+
+static void _layout_init(struct layout* l, const char* name, uint32_t capacity, int tiled) {
+  l->name = name;
+  l->stride = tiled ? 8 * HOT_COLUMNS : 8;
+  if (tiled) {
+    float* tiles = _aligned_malloc((size_t)capacity * HOT_COLUMNS * sizeof(float), 64);
+    for (int c = 0; c < HOT_COLUMNS; c++) {
+      l->column[c] = tiles + c * 8;
+    }
+  } else {
+    for (int c = 0; c < HOT_COLUMNS; c++) {
+      l->column[c] = _aligned_malloc((size_t)capacity * sizeof(float), 64);
+    }
+  }
+}
+
+static uint8_t* flush_;
+
+static void _flush_caches(void) {
+  for (size_t i = 0; i < FLUSH_SIZE; i += 64) {
+    flush_[i]++;
+  }
+}
+
+static void _run(struct layout* l, uint32_t active, uint32_t* culled) {
+  _layout_fill(l, active);
+
+  _flush_caches();
+  uint64_t start = __rdtsc();
+  _yoshida(l, active);
+  uint64_t yoshida_cycles = __rdtsc() - start;
+
+  _flush_caches();
+  start = __rdtsc();
+  uint32_t pairs = _collisions(l, active, culled);
+  uint64_t collision_cycles = __rdtsc() - start;
+
+  _cache_reset(&l1_), _cache_reset(&l2_);
+  _yoshida_trace(l, active);
+  uint64_t yoshida_l1 = l1_.misses, yoshida_l2 = l2_.misses;
+
+  _cache_reset(&l1_), _cache_reset(&l2_);
+  _collisions_trace(l, active, culled);
+
+  printf("%-6s %8u | yoshida %10llu cyc %9llu L1 %9llu L2 | collisions %10llu cyc %9llu L1 %9llu L2 (%u pairs)\n",
+         l->name, active, (unsigned long long)yoshida_cycles, (unsigned long long)yoshida_l1,
+         (unsigned long long)yoshida_l2, (unsigned long long)collision_cycles, (unsigned long long)l1_.misses,
+         (unsigned long long)l2_.misses, pairs);
+}
+
+int main(int argc, char** argv) {
+  uint32_t max_objects = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 65536;
+  max_objects = (max_objects + 7) & ~7u;
+
+  flush_ = calloc(FLUSH_SIZE, 1);
+  uint32_t* culled = _aligned_malloc((size_t)max_objects * sizeof(uint32_t) + 32, 64);
+  _cache_init(&l1_, 32 * 1024, 8);
+  _cache_init(&l2_, 1024 * 1024, 16);
+
+  struct layout soa, aosoa;
+  _layout_init(&soa, "SoA", max_objects, 0);
+  _layout_init(&aosoa, "AoSoA", max_objects, 1);
+
+  printf("simulated caches: L1d 32KB 8-way, L2 1MB 16-way, 64B lines; cycles measured with cold caches\n");
+  for (uint32_t active = 1024; active <= max_objects; active *= 4) {
+    _run(&soa, active, culled);
+    _run(&aosoa, active, culled);
+  }
+  return 0;
+}
@@ -0,0 +1,129 @@
+//
+// Offline summary of a message trace ring file (see messaging/trace.h)
+//
+// Build: cl /O2 /I..\src msgtrace_dump.c
+// Usage: msgtrace_dump [raketic.msgtrace]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "messaging/trace_format.h"
+
+#define MAX_CODES 65536
+#define MAX_TYPES 256
+
+struct code_summary {
+  uint64_t count;
+  uint64_t cycles;
+  uint32_t max_cycles;
+  uint32_t histogram[MESSAGE_TRACE_HISTOGRAM_BUCKETS];
+};
+
+static struct code_summary codes_[MAX_CODES];
+static uint64_t type_count_[MAX_TYPES];
+static uint64_t type_cycles_[MAX_TYPES];
+
+static void _print_histogram(const struct code_summary* cs) {
+  printf("      cycles  ");
+  for (uint32_t b = 0; b < MESSAGE_TRACE_HISTOGRAM_BUCKETS; b++) {
+    if (cs->histogram[b] != 0) {
+      printf(" 2^%u:%u", b, cs->histogram[b]);
+    }
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "raketic.msgtrace";
+
+  FILE* f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+
+  message_trace_header_t header;
+  if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != MESSAGE_TRACE_MAGIC ||
+      header.version != MESSAGE_TRACE_VERSION || header.record_size != sizeof(message_trace_record_t)) {
+    fprintf(stderr, "%s is not a version %d message trace\n", path, MESSAGE_TRACE_VERSION);
+    fclose(f);
+    return 1;
+  }
+
+  uint64_t available = header.written < header.capacity ? header.written : header.capacity;
+  uint32_t oldest = header.written < header.capacity ? 0 : (uint32_t)(header.written % header.capacity);
+
+  message_trace_record_t* records = malloc(sizeof(message_trace_record_t) * (size_t)available);
+  if (records == NULL) {
+    fclose(f);
+    return 1;
+  }
+
+  // unroll the ring: [oldest, capacity) followed by [0, oldest)
+  size_t tail = (size_t)(available - oldest);
+  fseek(f, (long)(sizeof(header) + (size_t)oldest * sizeof(message_trace_record_t)), SEEK_SET);
+  size_t read = fread(records, sizeof(message_trace_record_t), tail, f);
+  fseek(f, (long)sizeof(header), SEEK_SET);
+  read += fread(records + tail, sizeof(message_trace_record_t), oldest, f);
+  fclose(f);
+
+  uint32_t first_tick = read ? records[0].tick : 0;
+  uint32_t last_tick = first_tick;
+  uint32_t current_tick = first_tick;
+  uint32_t per_tick = 0;
+  uint32_t max_per_tick = 0;
+
+  for (size_t i = 0; i < read; i++) {
+    const message_trace_record_t* r = &records[i];
+    struct code_summary* cs = &codes_[r->code];
+
+    cs->count++;
+    cs->cycles += r->cycles;
+    if (r->cycles > cs->max_cycles) {
+      cs->max_cycles = r->cycles;
+    }
+    cs->histogram[message_trace_bucket(r->cycles)]++;
+
+    type_count_[r->recipient >> 24]++;
+    type_cycles_[r->recipient >> 24] += r->cycles;
+
+    if (r->tick != current_tick) {
+      current_tick = r->tick;
+      per_tick = 0;
+    }
+    if (++per_tick > max_per_tick) {
+      max_per_tick = per_tick;
+    }
+    last_tick = r->tick;
+  }
+
+  uint32_t ticks = read ? last_tick - first_tick + 1 : 0;
+  printf("%s: %llu records (%llu written total), ticks %u..%u\n", path, (unsigned long long)read,
+         (unsigned long long)header.written, first_tick, last_tick);
+  printf("messages per tick: avg %.1f, max %u\n\n", ticks ? (double)read / ticks : 0.0, max_per_tick);
+
+  printf("  code      count       cycles   avg cycles   max cycles\n");
+  for (uint32_t c = 0; c < MAX_CODES; c++) {
+    const struct code_summary* cs = &codes_[c];
+    if (cs->count == 0) {
+      continue;
+    }
+    printf("0x%04x %10llu %12llu %12.1f %12u\n", c, (unsigned long long)cs->count, (unsigned long long)cs->cycles,
+           (double)cs->cycles / cs->count, cs->max_cycles);
+    _print_histogram(cs);
+  }
+
+  printf("\n  type      count       cycles\n");
+  for (uint32_t t = 0; t < MAX_TYPES; t++) {
+    if (type_count_[t] == 0) {
+      continue;
+    }
+    printf("  0x%02x %10llu %12llu%s\n", t, (unsigned long long)type_count_[t], (unsigned long long)type_cycles_[t],
+           t == 0xFF ? "  (broadcast)" : "");
+  }
+
+  free(records);
+  return 0;
+}
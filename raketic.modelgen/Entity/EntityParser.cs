@@ -61,9 +61,51 @@ internal abstract record BaseEntityWithModelData
 
 internal record PartData : BaseEntityWithModelData
 {
-    public virtual void DumpPartData(StreamWriter w, string dataref)
+    // parts mounted on this part, slot names refer to the part's own model
+    public SlotData[] Slots { get; init; } = Array.Empty<SlotData>();
+
+    public virtual void DumpPartData(StreamWriter w, string partIdx)
     {
     }
+
+    public override IEnumerable<Model> AllModels
+    {
+        get
+        {
+            foreach (var model in base.AllModels)
+                yield return model;
+
+            foreach (var model in SlotData.AllModels(Slots))
+                yield return model;
+        }
+    }
+
+    public override BaseEntityWithModelData ReadFromTable(string key, LuaType type, Lua lua)
+    {
+        switch (key)
+        {
+            case "slots":
+                if (type != LuaType.Table)
+                    throw new InvalidOperationException($"Invalid type for 'slots' field in part definition, expected table but got {type}");
+
+                return this with { Slots = SlotData.ReadFromTable(lua) };
+            default:
+                return base.ReadFromTable(key, type, lua);
+        }
+    }
+
+    public override BaseEntityWithModelData ResolveModels(ModelContext modelContext, EntityContext entityContext)
+    {
+        var ret = (PartData)base.ResolveModels(modelContext, entityContext);
+
+        if (ret.Slots.Length == 0)
+            return ret;
+
+        if (ret.Model == null)
+            throw new InvalidOperationException("Part with slots must have a model to resolve the slot names against");
+
+        return ret with { Slots = SlotData.Resolve(ret.Slots, ret.Model, modelContext, entityContext) };
+    }
 }
 
 internal record EnginePartData : PartData
@@ -98,18 +140,17 @@ internal record EnginePartData : PartData
     {
         get
         {
-            if (Model != null)
-                yield return Model;
+            foreach (var model in base.AllModels)
+                yield return model;
 
             if (ParticleModel != null)
                 yield return ParticleModel;
         }
     }
 
-    public override void DumpPartData(StreamWriter w, string dataref)
+    public override void DumpPartData(StreamWriter w, string partIdx)
     {
-        w.WriteLine($"  ((struct engine_data*)({dataref}))->power = {Power / 100.0:0.0#######}f;");
-        w.WriteLine($"  ((struct engine_data*)({dataref}))->particle_model = {ParticleModel!.ModelConstantName};");
+        w.WriteLine($"  engine_attach({partIdx}, {Power / 100.0:0.0#######}f, {ParticleModel!.ModelConstantName});");
     }
 
     public override BaseEntityWithModelData ResolveModels(ModelContext modelContext, EntityContext entityContext)
@@ -176,34 +217,9 @@ internal record SlotData
     public int? SlotRef { get; init; }
     public int EntityRef { get; init; }
     public BaseEntityWithModelData? Entity { get; init; }
-}
-
-internal record EntityWithSlotsData : EntityData
-{
-    public SlotData[] Slots { get; init; } = Array.Empty<SlotData>();
-
-    public static new EntityWithSlotsData Empty { get; } = new EntityWithSlotsData();
-
-    public override IEnumerable<Model> AllModels
-    {
-        get
-        {
-            if (Model != null)
-                yield return Model;
-            foreach (var slot in Slots)
-            {
-                if (slot.Entity != null)
-                {
-                    foreach (var model in slot.Entity.AllModels)
-                    {
-                        yield return model;
-                    }
-                }
-            }
-        }
-    }
 
-    private static SlotData[] ReadSlotsFromTable(Lua lua)
+    // slots = { name = parts.x, other = parts.y { slots = { ... } } }, the table is on top of the stack
+    public static SlotData[] ReadFromTable(Lua lua)
     {
         var slots = new List<SlotData>();
 
@@ -228,28 +244,65 @@ internal record EntityWithSlotsData : EntityData
         return [.. slots];
     }
 
-    public override BaseEntityWithModelData ResolveModels(ModelContext modelContext, EntityContext entityContext)
+    public static SlotData[] Resolve(SlotData[] slots, Model model, ModelContext modelContext, EntityContext entityContext)
     {
-        var ret = (EntityWithSlotsData)base.ResolveModels(modelContext, entityContext);
+        return slots.Select(slot =>
+        {
+            var index = model.Slots.Index().FirstOrDefault(x => x.Item.Name == slot.SlotName);
+            if (index == default)
+                throw new InvalidOperationException($"Model '{model.FileName}' does not have a slot named '{slot.SlotName}'");
 
-        if (ret.Model != null)
+            var entity = entityContext[slot.EntityRef].ResolveModels(modelContext, entityContext);
+            if (entity is not PartData)
+                throw new InvalidOperationException($"Slot '{slot.SlotName}' of model '{model.FileName}' must hold a part");
+
+            return slot with { SlotRef = index.Index, Entity = entity };
+        }).ToArray();
+    }
+
+    public static IEnumerable<Model> AllModels(SlotData[] slots)
+    {
+        foreach (var slot in slots)
         {
-            var slots = ResolveSlots(ret.Slots, ret.Model, modelContext, entityContext);
-            return ret with { Slots = slots };
+            if (slot.Entity != null)
+            {
+                foreach (var model in slot.Entity.AllModels)
+                {
+                    yield return model;
+                }
+            }
         }
-        return ret;
     }
+}
 
-    private static SlotData[] ResolveSlots(SlotData[] slots, Model model, ModelContext modelContext, EntityContext entityContext)
+internal record EntityWithSlotsData : EntityData
+{
+    public SlotData[] Slots { get; init; } = Array.Empty<SlotData>();
+
+    public static new EntityWithSlotsData Empty { get; } = new EntityWithSlotsData();
+
+    public override IEnumerable<Model> AllModels
     {
-        return slots.Select(slot =>
+        get
         {
-            var index = model.Slots.Index().FirstOrDefault(x => x.Item.Name == slot.SlotName);
-            if (index == default)
-                throw new InvalidOperationException($"Model '{model.FileName}' does not have a slot named '{slot.SlotName}'");
+            if (Model != null)
+                yield return Model;
 
-            return slot with { SlotRef = index.Index, Entity = entityContext[slot.EntityRef].ResolveModels(modelContext, entityContext) };
-        }).ToArray();
+            foreach (var model in SlotData.AllModels(Slots))
+                yield return model;
+        }
+    }
+
+    public override BaseEntityWithModelData ResolveModels(ModelContext modelContext, EntityContext entityContext)
+    {
+        var ret = (EntityWithSlotsData)base.ResolveModels(modelContext, entityContext);
+
+        if (ret.Model != null)
+        {
+            var slots = SlotData.Resolve(ret.Slots, ret.Model, modelContext, entityContext);
+            return ret with { Slots = slots };
+        }
+        return ret;
     }
 
     public override BaseEntityWithModelData ReadFromTable(string key, LuaType type, Lua lua)
@@ -262,7 +315,7 @@ internal record EntityWithSlotsData : EntityData
 
                 return this with
                 {
-                    Slots = ReadSlotsFromTable(lua)
+                    Slots = SlotData.ReadFromTable(lua)
                 };
             default:
                 return base.ReadFromTable(key, type, lua);
@@ -18,8 +18,16 @@ internal class ModelWriter
 // Draw command types for fracture expansion
 typedef enum { CMD_LINE_LOOP = 0, CMD_LINE_STRIP = 1 } DrawCmdType;
 typedef struct { uint8_t type; uint8_t start; uint8_t count; } DrawCommand;
+
+// Per-command style for the batched renderer: RGBA packed as in color_t (0 = heat, drawn in the instance color),
+// hull = closed outline filled black under the lines, width = SVG stroke width in pixels
+typedef struct { uint32_t color; uint8_t hull; float width; } DrawStyle;
 ");
 
+        // Model count sizes the per-model fracture pattern cache
+        h.WriteLine($"#define MODEL_COUNT {models.Length}");
+        h.WriteLine();
+
         // Extern declarations for vertex arrays (defined in models.gen.c)
         foreach (var model in models)
         {
@@ -31,6 +39,7 @@ typedef struct { uint8_t type; uint8_t start; uint8_t count; } DrawCommand;
         h.WriteLine("extern const int8_t* _model_vertices[];");
         h.WriteLine("extern const DrawCommand* _model_commands[];");
         h.WriteLine("extern const uint8_t _model_command_counts[];");
+        h.WriteLine("extern const DrawStyle* _model_styles[];");
         h.WriteLine();
     }
 
@@ -58,6 +67,15 @@ typedef struct { uint8_t type; uint8_t start; uint8_t count; } DrawCommand;
             }
             w.WriteLine("};");
             w.WriteLine();
+
+            w.WriteLine($"static const DrawStyle _model_styles_{model.FileName}[] = {{");
+            foreach (var linestrip in model.LineStrips)
+            {
+                var hull = linestrip.Class == "hull" && linestrip.IsClosed ? 1 : 0;
+                w.WriteLine($"  {{0x{PackColor(linestrip):X8}u, {hull}, {linestrip.StrokeWidth:0.0##}f}},");
+            }
+            w.WriteLine("};");
+            w.WriteLine();
         }
 
         // Array of vertex pointers
@@ -86,7 +104,21 @@ typedef struct { uint8_t type; uint8_t start; uint8_t count; } DrawCommand;
         }
         w.WriteLine("};");
         w.WriteLine();
+
+        // Array of style array pointers (parallel to the commands)
+        w.WriteLine("const DrawStyle* _model_styles[] = {");
+        foreach (var model in models)
+        {
+            w.WriteLine($"  _model_styles_{model.FileName},");
+        }
+        w.WriteLine("};");
+        w.WriteLine();
     }
+
+    // color_t byte order (r, g, b, a) read as a little-endian uint32, heat strips take the instance color
+    private static uint PackColor(LineStrip linestrip) => linestrip.Class == "heat"
+        ? 0u
+        : linestrip.Color.R | (uint)linestrip.Color.G << 8 | (uint)linestrip.Color.B << 16 | (uint)linestrip.Color.A << 24;
     public int DumpModelData(StreamWriter w, Model model)
     {
         int points = 0; ;
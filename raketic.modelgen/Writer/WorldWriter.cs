@@ -106,45 +106,38 @@ void _generated_load_map_data(uint16_t index);
     private void WriteWorldContent(WorldsData world, int i)
     {
         _cWriter!.WriteLine($"static void _world_{world.WorldName}(struct objects_data* od, struct parts_data* pd) {{");
+        _cWriter!.WriteLine($"  entity_id_t new_id;");
         _cWriter!.WriteLine($"  uint32_t new_idx;");
         _cWriter!.WriteLine($"  uint32_t new_pidx;");
 
         foreach (EntityData entity in world.Entities)
         {
+            var parts = entity is EntityWithSlotsData withSlots ? FlattenSlots(withSlots) : [];
+
             _cWriter!.WriteLine();
-            _cWriter!.WriteLine($"  new_idx = od->active++;");
-            _cWriter!.WriteLine($"  od->type[new_idx] = {entity!.Type};");
+            _cWriter!.WriteLine($"  new_id = entity_manager_spawn_object({entity!.Type}, {parts.Count});");
+            _cWriter!.WriteLine($"  new_idx = entity_manager_object_index(new_id);");
             _cWriter!.WriteLine($"  od->model_idx[new_idx] = {entity.Model!.ModelConstantName};");
-            _cWriter!.WriteLine($"  od->position_orientation.position_x[new_idx] = {entity.Position?.X:0.0#######}f;");
-            _cWriter!.WriteLine($"  od->position_orientation.position_y[new_idx] = {entity.Position?.Y:0.0#######}f;");
-            _cWriter!.WriteLine($"  od->position_orientation.orientation_x[new_idx] = {Math.Cos(entity.Rotation ?? 0.0f):0.0#######}f;");
-            _cWriter!.WriteLine($"  od->position_orientation.orientation_y[new_idx] = {Math.Sin(entity.Rotation ?? 0.0f):0.0#######}f;");
-            _cWriter!.WriteLine($"  od->position_orientation.radius[new_idx] = {entity.Model!.GetRadius()};");
-            _cWriter!.WriteLine($"  od->mass[new_idx] = {entity.Mass!};");
-
-            if (entity is EntityWithSlotsData entityWithSlots)
+            _cWriter!.WriteLine($"  od->position_orientation.position_x[HOT_IDX(new_idx)] = {entity.Position?.X:0.0#######}f;");
+            _cWriter!.WriteLine($"  od->position_orientation.position_y[HOT_IDX(new_idx)] = {entity.Position?.Y:0.0#######}f;");
+            _cWriter!.WriteLine($"  od->position_orientation.orientation_x[HOT_IDX(new_idx)] = {Math.Cos(entity.Rotation ?? 0.0f):0.0#######}f;");
+            _cWriter!.WriteLine($"  od->position_orientation.orientation_y[HOT_IDX(new_idx)] = {Math.Sin(entity.Rotation ?? 0.0f):0.0#######}f;");
+            _cWriter!.WriteLine($"  od->position_orientation.radius[HOT_IDX(new_idx)] = {entity.Model!.GetRadius()};");
+            _cWriter!.WriteLine($"  od->mass[HOT_IDX(new_idx)] = {entity.Mass!};");
+
+            if (parts.Count > 0)
             {
-                var slotCount = entityWithSlots.Slots.Length;
-                var reservedSlots = slotCount + 7 & ~7;
-                var paddingSlots = reservedSlots - slotCount;
-
-                _cWriter!.WriteLine();
-                _cWriter!.WriteLine($"  _ASSERT(pd->active + {reservedSlots} < pd->capacity);");
-                _cWriter!.WriteLine($"  od->parts_start_idx[new_idx] = pd->active;");
-                _cWriter!.WriteLine($"  od->parts_count[new_idx] = {slotCount};");
-                _cWriter!.WriteLine();
-                _cWriter!.WriteLine($"  memset(&pd->model_idx[pd->active], -1, sizeof(uint16_t) * {reservedSlots});");
                 _cWriter!.WriteLine();
                 var w = _cWriter!;
+                var slotIdx = 0;
 
-                foreach (var slot in entityWithSlots.Slots)
+                // spawn reserved the block and set parent ids & defaults
+                foreach (var (slot, model, parentSlotIdx) in parts)
                 {
-                    var model = entityWithSlots.Model!;
                     var slotRef = slot.SlotRef!.Value;
                     var slotEntity = (PartData)slot.Entity!;
 
-                    w.WriteLine($"  new_pidx = pd->active++;");
-                    w.WriteLine($"  pd->parent_id[new_pidx] = OBJECT_ID_WITH_TYPE(new_idx, {entity!.Type}._);");
+                    w.WriteLine($"  new_pidx = od->parts_start_idx[new_idx] + {slotIdx++};");
                     w.WriteLine($"  pd->local_offset_x[new_pidx] = {model.Slots[slotRef].Position.X:0.0#######}f;");
                     w.WriteLine($"  pd->local_offset_y[new_pidx] = {model.Slots[slotRef].Position.Y:0.0#######}f;");
                     w.WriteLine($"  pd->model_idx[new_pidx] = {slotEntity.Model!.ModelConstantName};");
@@ -154,22 +147,22 @@ void _generated_load_map_data(uint16_t index);
                     w.WriteLine($"  pd->local_orientation_x[new_pidx] = 1.0f;"); // todo: ?!
                     w.WriteLine($"  pd->local_orientation_y[new_pidx] = 0.0f;");
 
-                    slotEntity.DumpPartData(w, "pd->data[new_pidx].data");
+                    if (parentSlotIdx >= 0)
+                        w.WriteLine($"  entity_manager_mount_part(new_pidx, od->parts_start_idx[new_idx] + {parentSlotIdx});");
+
+                    slotEntity.DumpPartData(w, "new_pidx");
 
                     w.WriteLine();
                 }
-
-
-                _cWriter!.WriteLine($"  pd->active += {paddingSlots};");
             }
 
             if (entity.SpawnId == world.ControlledEntitySpawnId)
             {
                 _cWriter!.WriteLine();
 
-                _cWriter!.WriteLine($"  debug_watch_set(OBJECT_ID_WITH_TYPE(new_idx, {entity!.Type}._));");
-                _cWriter!.WriteLine($"  controller_set_entity(OBJECT_ID_WITH_TYPE(new_idx, {entity!.Type}._));");
-                _cWriter!.WriteLine($"  camera_set_entity(OBJECT_ID_WITH_TYPE(new_idx, {entity!.Type}._));");
+                _cWriter!.WriteLine($"  debug_watch_set(new_id);");
+                _cWriter!.WriteLine($"  controller_set_entity(new_id);");
+                _cWriter!.WriteLine($"  camera_set_entity(new_id);");
                 _cWriter!.WriteLine();
             }
         }
@@ -178,6 +171,24 @@ void _generated_load_map_data(uint16_t index);
         _cWriter!.WriteLine();
     }
 
+    // the slot tree in level order (parents before children, as the parts transform expects), every part with
+    // the model its slot position comes from and the block index of the part it is mounted on (-1 = the object)
+    private static List<(SlotData Slot, Model Model, int ParentSlotIdx)> FlattenSlots(EntityWithSlotsData entity)
+    {
+        var parts = new List<(SlotData Slot, Model Model, int ParentSlotIdx)>();
+        foreach (var slot in entity.Slots)
+            parts.Add((slot, entity.Model!, -1));
+
+        for (var i = 0; i < parts.Count; i++)
+        {
+            var part = (PartData)parts[i].Slot.Entity!;
+            foreach (var slot in part.Slots)
+                parts.Add((slot, part.Model!, i));
+        }
+
+        return parts;
+    }
+
     private void WriteWorldHeaders(WorldsData world, int i)
     {
         _hWriter!.WriteLine($"#define WORLD_{world.WorldName.ToUpper()}_IDX ((uint16_t){i})");